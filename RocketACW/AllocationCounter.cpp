@@ -0,0 +1,73 @@
+#include "AllocationCounter.h"
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+#ifdef _DEBUG
+//each thread counts its own allocations, so no counter is shared between threads
+static thread_local size_t sAllocations = 0;
+
+/// <summary>
+/// Replaces the global operator new to count every allocation, array and nothrow new are built on top of it
+/// </summary>
+/// <param name="pSize"> the number of bytes to allocate </param>
+/// <returns> the allocated memory </returns>
+void* operator new(const size_t pSize)
+{
+	++sAllocations;
+	if (auto memory = malloc(pSize == 0 ? 1 : pSize))
+	{
+		return memory;
+	}
+	throw bad_alloc();
+}
+
+/// <summary>
+/// Frees memory allocated by the replaced operator new
+/// </summary>
+/// <param name="pMemory"> the memory to free </param>
+void operator delete(void* const pMemory) noexcept
+{
+	free(pMemory);
+}
+
+/// <summary>
+/// Frees memory allocated by the replaced operator new, the size is not needed
+/// </summary>
+/// <param name="pMemory"> the memory to free </param>
+void operator delete(void* const pMemory, const size_t) noexcept
+{
+	free(pMemory);
+}
+#endif
+
+/// <summary>
+/// Gets the number of allocations the calling thread has made since it started
+/// </summary>
+/// <returns> the allocation count, always zero in release builds </returns>
+const size_t AllocationCounter::Count()
+{
+#ifdef _DEBUG
+	return sAllocations;
+#else
+	return 0;
+#endif
+}
+
+/// <summary>
+/// Constructor which records the allocation count of the calling thread
+/// </summary>
+/// <param name="pGrowing"> whether the scope is about to grow a list past its largest size so far, which may allocate </param>
+AllocationFreeScope::AllocationFreeScope(const bool pGrowing) : mAllocations(AllocationCounter::Count()), mGrowing(pGrowing)
+{
+}
+
+/// <summary>
+/// Destructor which asserts that the calling thread has not allocated since the scope was opened, unless it was growing
+/// </summary>
+AllocationFreeScope::~AllocationFreeScope()
+{
+	assert(mGrowing || AllocationCounter::Count() == mAllocations);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+//Counts the heap allocations made by the calling thread - debug builds replace the global operator new to do the counting, release builds always read zero
+//The count is kept per thread so work on another thread, such as a benchmark, never shows up in the game's own counts
+class AllocationCounter
+{
+public:
+	static const size_t Count();
+};
+
+//Asserts in debug builds that the thread which opened it makes no allocation while it is alive
+//Opened around the paths which are meant never to allocate, so an allocation is caught where it is made rather than excused by anything else in the frame
+//A scope opened by a path which is about to grow a list past its largest size so far is told so, and lets that one growth through
+class AllocationFreeScope
+{
+	size_t mAllocations;
+	bool mGrowing;
+
+public:
+	explicit AllocationFreeScope(const bool pGrowing = false);
+	~AllocationFreeScope();
+
+	AllocationFreeScope& operator=(const AllocationFreeScope& pScope) = delete;
+	AllocationFreeScope(const AllocationFreeScope& pScope) = delete;
+};
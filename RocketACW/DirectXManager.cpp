@@ -1,8 +1,11 @@
 #include "DirectXManager.h"
 #include "Instance.h"
 #include "Result.h"
+#include "AllocationCounter.h"
 #include <winerror.h>
 #include <d3d11.h>
+#include <algorithm>
+#include <cassert>
 
 using namespace DirectX;
 using namespace std;
@@ -15,6 +18,7 @@ using namespace std;
 DirectXManager::DirectXManager(const HWND& pHWnd, AntTweakManager& pAwManager)
 {
 	mAwManager = &pAwManager;
+	mBlendedShapes.reserve(64);
 	if (FAILED(InitDevice(pHWnd)))
 	{
 		Cleanup();
@@ -41,14 +45,25 @@ void DirectXManager::Cleanup()
 		(get<1>(shader.second))->Release(); // delete vertex layout
 		(get<2>(shader.second))->Release(); // delete pixel shader
 	}
+	for (const auto& shader : mPackedShaderMap)
+	{
+		(get<0>(shader.second))->Release(); // delete vertex shader
+		(get<1>(shader.second))->Release(); // delete vertex layout
+		(get<2>(shader.second))->Release(); // delete pixel shader
+	}
 	for (const auto& geometry : mGeometryBufferMap)
 	{
 		(get<0>(geometry.second))->Release(); // delete vertex buffer
 		(get<1>(geometry.second))->Release(); // delete index buffer
 	}
+	for (const auto& mesh : mMeshBufferMap)
+	{
+		(get<0>(mesh.second))->Release(); // delete vertex buffer
+		(get<1>(mesh.second))->Release(); // delete index buffer
+	}
 	for (const auto& instance : mInstanceMap)
 	{
-		(instance.second)->Release();
+		(get<0>(instance.second))->Release();
 	}
 
 	//delete the remaining directx pointers
@@ -79,8 +94,9 @@ void DirectXManager::Cleanup()
 /// <param name="pEntryPoint"> name of function that is entry point to shader </param>
 /// <param name="pShaderModel"> version of shader </param>
 /// <param name="pBlobOut"> </param>
+/// <param name="pDefines"> null terminated list of macros defined while compiling, or nullptr for none </param>
 /// <returns> HRESULT of compiling the ahader</returns>
-HRESULT DirectXManager::CompileShaderFromFile(const WCHAR * const pFileName, const LPCSTR pEntryPoint, const LPCSTR pShaderModel, ID3DBlob** const pBlobOut)
+HRESULT DirectXManager::CompileShaderFromFile(const WCHAR * const pFileName, const LPCSTR pEntryPoint, const LPCSTR pShaderModel, ID3DBlob** const pBlobOut, const D3D_SHADER_MACRO * const pDefines)
 {
 	auto hr{ Result::OK };
 
@@ -99,7 +115,7 @@ HRESULT DirectXManager::CompileShaderFromFile(const WCHAR * const pFileName, con
 
 
 	ID3DBlob* errorBlob = nullptr;
-	hr = D3DCompileFromFile(pFileName, nullptr, nullptr, pEntryPoint, pShaderModel,
+	hr = D3DCompileFromFile(pFileName, pDefines, nullptr, pEntryPoint, pShaderModel,
 		dwShaderFlags, 0, pBlobOut, &errorBlob);
 	if (FAILED(hr))
 	{
@@ -384,6 +400,11 @@ HRESULT DirectXManager::InitDevice(const HWND& pHWnd)
 
 	mAwManager->Init(mDevice, width, height);
 
+	//Render Stats
+	mAwManager->AddBar("RenderStats");
+	mAwManager->AddVariable("RenderStats", "Instance Bytes Uploaded", mInstanceBytesUploaded, "group = Instancing");
+	mAwManager->AddVariable("RenderStats", "Instance Bytes Skipped", mInstanceBytesSkipped, "group = Instancing");
+
 	return hr;
 }
 
@@ -417,6 +438,47 @@ HRESULT DirectXManager::CreateConstantBuffers()
 	return hr;
 }
 
+/// <summary>
+/// creates a vertex buffer and index buffer holding the geometry of the given shape
+/// </summary>
+/// <param name="pShape"> the shape which will have its vertices loaded </param>
+/// <param name="pVertBuffer"> receives the vertex buffer </param>
+/// <param name="pIndBuffer"> receives the index buffer </param>
+/// <returns> the HRESULT of creating the buffers </returns>
+HRESULT DirectXManager::CreateGeometryBuffers(const Shape & pShape, ID3D11Buffer** const pVertBuffer, ID3D11Buffer** const pIndBuffer) const
+{
+	auto hr{ Result::OK };
+
+	//Create vertex buffer
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = pShape.Vertices().size() * sizeof(SimpleVertex);
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+	D3D11_SUBRESOURCE_DATA initData;
+	ZeroMemory(&initData, sizeof(initData));
+	initData.pSysMem = &(pShape.Vertices()[0]);
+	hr = mDevice->CreateBuffer(&bd, &initData, pVertBuffer);
+	if (FAILED(hr))
+		return hr;
+
+	//Create index buffer
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.ByteWidth = pShape.Indices().size() * sizeof(WORD);
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+	initData.pSysMem = &(pShape.Indices()[0]);
+	hr = mDevice->CreateBuffer(&bd, &initData, pIndBuffer);
+	if (FAILED(hr))
+	{
+		(*pVertBuffer)->Release();
+		*pVertBuffer = nullptr;
+	}
+
+	return hr;
+}
+
 /// <summary>
 /// creates the vertex buffer and index buffer for the given shape if they dont already exist
 /// </summary>
@@ -424,58 +486,74 @@ HRESULT DirectXManager::CreateConstantBuffers()
 /// <returns> the HRESULT of creating the vertex buffer </returns>
 HRESULT DirectXManager::LoadGeometryBuffers(const Shape & pShape)
 {
+	if (pShape.Geometry() == GeometryType::MESH)
+	{
+		return LoadMeshBuffers(pShape);
+	}
+
 	auto hr{ Result::OK };
 	auto it = mGeometryBufferMap.find(
 		pShape.Geometry());
-	if (it != mGeometryBufferMap.end())
-	{
-		// Set vertex buffer
-		const UINT stride = sizeof(SimpleVertex);
-		const UINT offset = 0;
-		mImmediateContext->IASetVertexBuffers(0, 1, &get<0>(it->second), &stride, &offset);
-
-		// Set index buffer
-		mImmediateContext->IASetIndexBuffer(get<1>(it->second), DXGI_FORMAT_R16_UINT, 0);
-	}
-	else
+	if (it == mGeometryBufferMap.end())
 	{
-		//Create vertex buffer
-		D3D11_BUFFER_DESC bd;
-		ZeroMemory(&bd, sizeof(bd));
-		bd.Usage = D3D11_USAGE_DEFAULT;
-		bd.ByteWidth = pShape.Vertices().size() * sizeof(SimpleVertex);
-		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-		D3D11_SUBRESOURCE_DATA initData;
-		ZeroMemory(&initData, sizeof(initData));
-		initData.pSysMem = &(pShape.Vertices()[0]);
 		ID3D11Buffer* VertBuffer = nullptr;
-		hr = mDevice->CreateBuffer(&bd, &initData, &VertBuffer);
+		ID3D11Buffer* IndBuffer = nullptr;
+		hr = CreateGeometryBuffers(pShape, &VertBuffer, &IndBuffer);
 		if (FAILED(hr))
 			return hr;
 
-		// Set vertex buffer
-		const UINT stride = sizeof(SimpleVertex);
-		const UINT offset = 0;
-		mImmediateContext->IASetVertexBuffers(0, 1, &VertBuffer, &stride, &offset);
+		it = mGeometryBufferMap.insert(pair<GeometryType, tuple<ID3D11Buffer*, ID3D11Buffer*>>(pShape.Geometry(), make_tuple(VertBuffer, IndBuffer))).first;
+		++mResourcesCreated;
+	}
 
-		//Create index buffer
-		bd.Usage = D3D11_USAGE_DEFAULT;
-		bd.ByteWidth = pShape.Indices().size() * sizeof(WORD);
-		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		bd.CPUAccessFlags = 0;
-		initData.pSysMem = &(pShape.Indices()[0]);
+	// Set vertex buffer
+	const UINT stride = sizeof(SimpleVertex);
+	const UINT offset = 0;
+	mImmediateContext->IASetVertexBuffers(0, 1, &get<0>(it->second), &stride, &offset);
+
+	// Set index buffer
+	mImmediateContext->IASetIndexBuffer(get<1>(it->second), DXGI_FORMAT_R16_UINT, 0);
+
+	return hr;
+}
+
+/// <summary>
+/// creates the vertex buffer and index buffer for a shape with its own mesh, they are rebuilt whenever the shapes mesh version changes
+/// </summary>
+/// <param name="pShape"> the shape which will have its vertices loaded </param>
+/// <returns> the HRESULT of creating the vertex buffer </returns>
+HRESULT DirectXManager::LoadMeshBuffers(const Shape & pShape)
+{
+	auto hr{ Result::OK };
+	auto it = mMeshBufferMap.find(pShape.Name());
+	if (it != mMeshBufferMap.end() && get<2>(it->second) != pShape.MeshVersion())
+	{
+		//the mesh has been rebuilt since it was uploaded so the old buffers are replaced
+		(get<0>(it->second))->Release();
+		(get<1>(it->second))->Release();
+		mMeshBufferMap.erase(it);
+		it = mMeshBufferMap.end();
+	}
+
+	if (it == mMeshBufferMap.end())
+	{
+		ID3D11Buffer* VertBuffer = nullptr;
 		ID3D11Buffer* IndBuffer = nullptr;
-		hr = mDevice->CreateBuffer(&bd, &initData, &IndBuffer);
+		hr = CreateGeometryBuffers(pShape, &VertBuffer, &IndBuffer);
 		if (FAILED(hr))
 			return hr;
 
-		// Set index buffer
-		mImmediateContext->IASetIndexBuffer(IndBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-		mGeometryBufferMap.insert(pair<GeometryType, tuple<ID3D11Buffer*, ID3D11Buffer*>>(pShape.Geometry(), make_tuple(VertBuffer, IndBuffer)));
+		it = mMeshBufferMap.insert(pair<string, tuple<ID3D11Buffer*, ID3D11Buffer*, unsigned int>>(pShape.Name(), make_tuple(VertBuffer, IndBuffer, pShape.MeshVersion()))).first;
+		++mResourcesCreated;
 	}
 
+	// Set vertex buffer
+	const UINT stride = sizeof(SimpleVertex);
+	const UINT offset = 0;
+	mImmediateContext->IASetVertexBuffers(0, 1, &get<0>(it->second), &stride, &offset);
+
+	// Set index buffer
+	mImmediateContext->IASetIndexBuffer(get<1>(it->second), DXGI_FORMAT_R16_UINT, 0);
 
 	return hr;
 }
@@ -504,6 +582,7 @@ HRESULT DirectXManager::LoadTextures(const Shape& pShape)
 			return hr;
 		mImmediateContext->PSSetShaderResources(0, 1, &diffTexRv);
 		mTexMap.insert(pair<wstring, ID3D11ShaderResourceView*>(pShape.DiffuseTexture(), diffTexRv));
+		++mResourcesCreated;
 	}
 
 	//normal map
@@ -520,6 +599,7 @@ HRESULT DirectXManager::LoadTextures(const Shape& pShape)
 			return hr;
 		mImmediateContext->PSSetShaderResources(0, 1, &normTexRv);
 		mTexMap.insert(pair<wstring, ID3D11ShaderResourceView*>(pShape.NormalMap(), normTexRv));
+		++mResourcesCreated;
 	}
 
 	//height map
@@ -537,6 +617,7 @@ HRESULT DirectXManager::LoadTextures(const Shape& pShape)
 			return hr;
 		mImmediateContext->PSSetShaderResources(0, 1, &heightTexRv);
 		mTexMap.insert(pair<wstring, ID3D11ShaderResourceView*>(pShape.HeightMap(), heightTexRv));
+		++mResourcesCreated;
 	}
 
 	return hr;
@@ -544,15 +625,20 @@ HRESULT DirectXManager::LoadTextures(const Shape& pShape)
 
 /// <summary>
 /// Loads the vertex shader, pixel/fragment shader and the input layout if they have not already been created
+/// Shapes with packed instances use a variant of the shader compiled with PACKED_INSTANCE defined and a layout reading 10:10:10:2 integers
+/// Particle shapes add the size and fade after the position of each instance, their shaders are written for them so no variant is needed
 /// </summary>
 /// <param name="pShape"> the shape which will have its shaders loaded </param>
 /// <returns> the result of creating the shaders </returns>
 HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 {
 	auto hr{ Result::OK };
-	auto it = mShaderMap.find(pShape.Shader());
+	auto& shaderMap = pShape.IsPacked() ? mPackedShaderMap : mShaderMap;
+	const D3D_SHADER_MACRO packedDefines[] = { { "PACKED_INSTANCE", "1" }, { nullptr, nullptr } };
+	const auto defines = pShape.IsPacked() ? packedDefines : nullptr;
+	auto it = shaderMap.find(pShape.Shader());
 
-	if (it != mShaderMap.end())
+	if (it != shaderMap.end())
 	{
 		//it->second = tuple
 
@@ -575,7 +661,7 @@ HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 	{
 		// Compile the vertex shader
 		ID3DBlob* VSBlob = nullptr;
-		hr = CompileShaderFromFile(pShape.Shader().c_str(), "VS", "vs_4_0", &VSBlob);
+		hr = CompileShaderFromFile(pShape.Shader().c_str(), "VS", "vs_4_0", &VSBlob, defines);
 		if (FAILED(hr))
 		{
 			MessageBox(nullptr,
@@ -603,9 +689,12 @@ HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 			{ "BINORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 48, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-			{ "INSTANCEPOS", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEPOS", 0, pShape.IsPacked() ? DXGI_FORMAT_R10G10B10A2_UINT : DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCEDATA", 0, pShape.Format() == InstanceFormat::PITCHED ? DXGI_FORMAT_R32_FLOAT : DXGI_FORMAT_R16G16_UNORM, 1, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
 		};
-		const auto numElements = ARRAYSIZE(layout);
+		//only particles, with their size and fade, and pitched instances, with their pitch, have data after the position
+		const auto hasData = pShape.Format() == InstanceFormat::PARTICLE || pShape.Format() == InstanceFormat::PITCHED;
+		const auto numElements = hasData ? ARRAYSIZE(layout) : ARRAYSIZE(layout) - 1;
 
 		// Create the input layout
 		ID3D11InputLayout* vertLayout = nullptr;
@@ -619,7 +708,7 @@ HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 		mImmediateContext->IASetInputLayout(vertLayout);
 
 		ID3DBlob* psBlob = nullptr;
-		hr = CompileShaderFromFile(pShape.Shader().c_str(), "PS", "ps_4_0", &psBlob);
+		hr = CompileShaderFromFile(pShape.Shader().c_str(), "PS", "ps_4_0", &psBlob, defines);
 		if (FAILED(hr))
 		{
 			MessageBox(nullptr,
@@ -639,7 +728,8 @@ HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 		mImmediateContext->PSSetConstantBuffers(1, 1, &mConstantBufferUniform);
 
 		//Add to the dictionary
-		mShaderMap.insert(pair<wstring, tuple<ID3D11VertexShader*, ID3D11InputLayout*, ID3D11PixelShader*>>(pShape.Shader(), make_tuple(vertShader, vertLayout, pixelShader)));
+		shaderMap.insert(pair<wstring, tuple<ID3D11VertexShader*, ID3D11InputLayout*, ID3D11PixelShader*>>(pShape.Shader(), make_tuple(vertShader, vertLayout, pixelShader)));
+		++mResourcesCreated;
 	}
 
 	return hr;
@@ -647,45 +737,182 @@ HRESULT DirectXManager::LoadShaders(const Shape & pShape)
 
 /// <summary>
 /// Loads the instance buffer from a map or creates a new one if one does not already exist
+/// Only the ranges of instances which changed since the last upload are sent, unchanged shapes upload nothing
 /// </summary>
 /// <param name="pShape"> the shape which will have its instance buffer loaded </param>
 HRESULT DirectXManager::LoadInstanceBuffers(const Shape & pShape)
 {
 	auto hr{ Result::OK };
-	const auto it = mInstanceMap.find(pShape.Name());
+	const auto bytes = static_cast<unsigned int>(pShape.InstanceCount()) * pShape.InstanceStride();
+	//a new buffer has room for everything the shape has reserved, so a shape which reserved its largest size up front is never reallocated
+	auto capacity = max(bytes, static_cast<unsigned int>(pShape.InstanceCapacity()) * pShape.InstanceStride());
+	auto it = mInstanceMap.find(pShape.Name());
 
-	if (it != mInstanceMap.end())
+	if (it != mInstanceMap.end() && bytes > get<2>(it->second))
 	{
-		// Set instance buffer
-		const UINT stride = sizeof(Instance);
-		const UINT offset = 0;
-		mImmediateContext->IASetVertexBuffers(1, 1, &it->second, &stride, &offset);
-		mImmediateContext->UpdateSubresource(it->second, 0, nullptr, &pShape.Instances()[0], 0, 0);
+		//the instances no longer fit so the buffer is replaced, growing geometrically so a growing shape is not reallocated every frame
+		capacity = max(bytes, get<2>(it->second) * 2);
+		(get<0>(it->second))->Release();
+		mInstanceMap.erase(it);
+		it = mInstanceMap.end();
 	}
-	else
+
+	if (it == mInstanceMap.end())
 	{
-		//Create new buffer
+		//Create new buffer, its contents are uploaded below
 		D3D11_BUFFER_DESC bd;
 		ZeroMemory(&bd, sizeof(bd));
 		bd.Usage = D3D11_USAGE_DEFAULT;
-		bd.ByteWidth = pShape.Instances().size() * sizeof(Instance);
+		bd.ByteWidth = capacity;
 		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 		bd.CPUAccessFlags = 0;
-		D3D11_SUBRESOURCE_DATA initData;
-		ZeroMemory(&initData, sizeof(initData));
-		initData.pSysMem = &(pShape.Instances()[0]);
 		ID3D11Buffer* instBuffer = nullptr;
-		hr = mDevice->CreateBuffer(&bd, &initData, &instBuffer);
+		hr = mDevice->CreateBuffer(&bd, nullptr, &instBuffer);
 		if (FAILED(hr))
 			return hr;
 
-		// Set instance buffer
-		const UINT stride = sizeof(Instance);
-		const UINT offset = 0;
-		mImmediateContext->IASetVertexBuffers(1, 1, &instBuffer, &stride, &offset);
+		//Add to the dictionary, version 0 is never handed out so everything is uploaded
+		it = mInstanceMap.insert(pair<string, tuple<ID3D11Buffer*, unsigned int, unsigned int, unsigned int>>(pShape.Name(), make_tuple(instBuffer, 0, capacity, pShape.BaseInstanceVersion()))).first;
+		++mResourcesCreated;
+	}
 
-		//Add to the dictionary
-		mInstanceMap.insert(pair<string, ID3D11Buffer*>(pShape.Name(), instBuffer));
+	if (get<1>(it->second) != pShape.InstanceVersion() || get<3>(it->second) != pShape.BaseInstanceVersion())
+	{
+		//a buffer last filled by a different shape with the same name has nothing in common with this one
+		const auto uploadedVersion = get<3>(it->second) == pShape.BaseInstanceVersion() ? get<1>(it->second) : 0;
+		const auto uploaded = UploadInstances(get<0>(it->second), pShape, uploadedVersion);
+		mInstanceBytesSkipped += bytes - uploaded;
+		get<1>(it->second) = pShape.InstanceVersion();
+		get<3>(it->second) = pShape.BaseInstanceVersion();
+	}
+	else
+	{
+		mInstanceBytesSkipped += bytes;
+	}
+
+	// Set instance buffer
+	const UINT stride = pShape.InstanceStride();
+	const UINT offset = 0;
+	mImmediateContext->IASetVertexBuffers(1, 1, &get<0>(it->second), &stride, &offset);
+
+	return hr;
+}
+
+/// <summary>
+/// Uploads the instances which have changed since the given version, overlapping dirty ranges are merged so nothing is sent twice
+/// </summary>
+/// <param name="pBuffer"> the instance buffer to update </param>
+/// <param name="pShape"> the shape which owns the instances </param>
+/// <param name="pUploadedVersion"> the instance version the buffer currently holds, older than the shapes base version to upload everything </param>
+/// <returns> the number of bytes uploaded </returns>
+unsigned int DirectXManager::UploadInstances(ID3D11Buffer* const pBuffer, const Shape & pShape, const unsigned int pUploadedVersion)
+{
+	const auto count = static_cast<unsigned int>(pShape.InstanceCount());
+	const auto stride = pShape.InstanceStride();
+	auto& ranges = mUploadRanges;
+	ranges.clear();
+	if (pUploadedVersion < pShape.BaseInstanceVersion())
+	{
+		ranges.emplace_back(0, count);
+	}
+	else
+	{
+		for (const auto& range : pShape.DirtyInstanceRanges())
+		{
+			//instances past the end have since been removed and are not drawn
+			if (range.mVersion > pUploadedVersion && range.mFirst < count)
+			{
+				ranges.emplace_back(range.mFirst, min(range.mLast, count));
+			}
+		}
+		sort(ranges.begin(), ranges.end());
+	}
+
+	unsigned int uploaded = 0;
+	for (size_t i = 0; i < ranges.size();)
+	{
+		auto first = ranges[i].first;
+		auto last = ranges[i].second;
+		for (++i; i < ranges.size() && ranges[i].first <= last; ++i)
+		{
+			last = max(last, ranges[i].second);
+		}
+		if (first == last)
+		{
+			continue;
+		}
+
+		const D3D11_BOX box{ first * stride, 0, 0, last * stride, 1, 1 };
+		mImmediateContext->UpdateSubresource(pBuffer, 0, &box, static_cast<const char*>(pShape.InstanceData()) + first * stride, 0, 0);
+		uploaded += (last - first) * stride;
+	}
+	mInstanceBytesUploaded += uploaded;
+
+	return uploaded;
+}
+
+/// <summary>
+/// Uploads anything the shape is missing and draws it with the state it asks for
+/// </summary>
+/// <param name="pGameObject">The gameobject the shape belongs to</param>
+/// <param name="pShape">The shape to draw</param>
+/// <param name="pConstantBuffer">The per frame constant buffer, the shape's world matrix is written into it</param>
+/// <returns>hresult</returns>
+HRESULT DirectXManager::DrawShape(const GameObject& pGameObject, const Shape& pShape, ConstantBuffer& pConstantBuffer)
+{
+	auto hr{ Result::OK };
+	hr = LoadGeometryBuffers(pShape);
+	if (FAILED(hr))
+		return hr;
+
+	hr = LoadTextures(pShape);
+	if (FAILED(hr))
+		return hr;
+
+	hr = LoadShaders(pShape);
+	if (FAILED(hr))
+		return hr;
+
+
+	//Get data from the pShape and set it in the constant buffer
+	XMFLOAT4X4 world{};
+	XMStoreFloat4x4(&world, XMMatrixIdentity() * XMLoadFloat4x4(pShape.Transform()) * XMLoadFloat4x4(pGameObject.Transform()));
+	XMStoreFloat4x4(&pConstantBuffer.mCbWorld, XMMatrixTranspose(XMLoadFloat4x4(&world)));
+
+	mImmediateContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &pConstantBuffer, 0, 0);
+
+	if (pShape.IsBlended())
+	{
+		float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const auto blendSample = 0xffffffff;
+		mImmediateContext->OMSetBlendState(mAlphaBlend, blendFactor, blendSample);
+		mImmediateContext->OMSetDepthStencilState(mDepthStencilState, 0);
+		//mImmediateContext->RSSetState(mNoCullRasterizerState);
+	}
+	else if (pShape.IsEnvironment())
+	{
+		mImmediateContext->OMSetDepthStencilState(mDepthStencilState, 0);
+		mImmediateContext->RSSetState(mNoCullRasterizerState);
+	}
+	else
+	{
+		const auto blendSample = 0xffffffff;
+		mImmediateContext->OMSetBlendState(nullptr, nullptr, blendSample);
+		mImmediateContext->OMSetDepthStencilState(nullptr, 0);
+		mImmediateContext->RSSetState(mDefaultRasterizerState);
+	}
+	
+	//check if the shape has instancing enabled
+	if (pShape.IsInstanced())
+	{
+		LoadInstanceBuffers(pShape);
+		//draw instances
+		mImmediateContext->DrawIndexedInstanced(pShape.Indices().size(), pShape.InstanceCount(), 0, 0, 0);
+	}
+	else
+	{
+		//draw the shape
+		mImmediateContext->DrawIndexed(pShape.Indices().size(), 0, 0);
 	}
 
 	return hr;
@@ -701,6 +928,8 @@ HRESULT DirectXManager::LoadInstanceBuffers(const Shape & pShape)
 HRESULT DirectXManager::Render(const std::vector<GameObject>& pGameObjects, const Camera * const pCam, const vector<Light> & pLights, const float pTime)
 {
 	auto hr{ Result::OK };
+	mInstanceBytesUploaded = 0;
+	mInstanceBytesSkipped = 0;
 	//
 	// Clear the back buffer
 	//
@@ -749,68 +978,58 @@ HRESULT DirectXManager::Render(const std::vector<GameObject>& pGameObjects, cons
 	mImmediateContext->UpdateSubresource(mConstantBufferUniform, 0, nullptr, &cbu, 0, 0);
 	mImmediateContext->PSSetSamplers(0, 1, &mTexSampler);
 
+	//opaque shapes are drawn as they come, blended shapes wait until everything they cover has been drawn and are then drawn back to front
+	const auto eye = XMLoadFloat4(&pCam->Eye());
+	const auto forward = XMLoadFloat4(&pCam->Forward());
+	mBlendedShapes.clear();
+
+	//once every buffer, texture and shader exists and the lists have reached their largest size, drawing the shapes must not touch the heap
+	const auto allocations = AllocationCounter::Count();
+	const auto resourcesCreated = mResourcesCreated;
+	const auto blendedCapacity = mBlendedShapes.capacity();
+	const auto rangeCapacity = mUploadRanges.capacity();
+
 	//Loop through each gameobject
 	for (const auto& gameObject : pGameObjects)
 	{
 		//Loop through each shape in the gameobject
-		for (const auto& shape : gameObject.Shapes())
+		const auto& shapes = gameObject.Shapes();
+		for (auto i = 0; i < static_cast<int>(shapes.size()); ++i)
 		{
-			hr = LoadGeometryBuffers(shape);
-			if (FAILED(hr))
-				return hr;
-
-			hr = LoadTextures(shape);
-			if (FAILED(hr))
-				return hr;
-
-			hr = LoadShaders(shape);
-			if (FAILED(hr))
-				return hr;
-
-
-			//Get data from the shape and set it in the constant buffer
-			XMFLOAT4X4 world{};
-			XMStoreFloat4x4(&world, XMMatrixIdentity() * XMLoadFloat4x4(shape.Transform()) * XMLoadFloat4x4(gameObject.Transform()));
-			XMStoreFloat4x4(&cb1.mCbWorld, XMMatrixTranspose(XMLoadFloat4x4(&world)));
-
-			mImmediateContext->UpdateSubresource(mConstantBuffer, 0, nullptr, &cb1, 0, 0);
+			const auto& shape = shapes[i];
+			//meshes built at runtime can be empty, e.g. a terrain chunk which has been blown away
+			if (shape.Indices().empty() || (shape.IsInstanced() && shape.InstanceCount() == 0))
+				continue;
 
 			if (shape.IsBlended())
 			{
-				float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-				const auto blendSample = 0xffffffff;
-				mImmediateContext->OMSetBlendState(mAlphaBlend, blendFactor, blendSample);
-				mImmediateContext->OMSetDepthStencilState(mDepthStencilState, 0);
-				//mImmediateContext->RSSetState(mNoCullRasterizerState);
-			}
-			else if (shape.IsEnvironment())
-			{
-				mImmediateContext->OMSetDepthStencilState(mDepthStencilState, 0);
-				mImmediateContext->RSSetState(mNoCullRasterizerState);
-			}
-			else
-			{
-				const auto blendSample = 0xffffffff;
-				mImmediateContext->OMSetBlendState(nullptr, nullptr, blendSample);
-				mImmediateContext->OMSetDepthStencilState(nullptr, 0);
-				mImmediateContext->RSSetState(mDefaultRasterizerState);
-			}
-			
-			//check if the shape has instancing enabled
-			if (!shape.Instances().empty())
-			{
-				LoadInstanceBuffers(shape);
-				//draw instances
-				mImmediateContext->DrawIndexedInstanced(shape.Indices().size(), shape.Instances().size(), 0, 0, 0);
-			}
-			else
-			{
-				//draw the shape
-				mImmediateContext->DrawIndexed(shape.Indices().size(), 0, 0);
+				//blended shapes are ordered by the depth of the middle of their box
+				XMFLOAT3 boundsMin{};
+				XMFLOAT3 boundsMax{};
+				gameObject.ShapeBounds(i, boundsMin, boundsMax);
+				const auto centre = (XMLoadFloat3(&boundsMin) + XMLoadFloat3(&boundsMax)) * 0.5f;
+				mBlendedShapes.emplace_back(XMVectorGetX(XMVector3Dot(centre - eye, forward)), &gameObject, &shape);
+				continue;
 			}
+
+			hr = DrawShape(gameObject, shape, cb1);
+			if (FAILED(hr))
+				return hr;
 		}
 	}
 
+	sort(mBlendedShapes.begin(), mBlendedShapes.end(), [](const tuple<float, const GameObject*, const Shape*>& pLhs, const tuple<float, const GameObject*, const Shape*>& pRhs)
+	{
+		return get<0>(pLhs) > get<0>(pRhs);
+	});
+	for (const auto& blended : mBlendedShapes)
+	{
+		hr = DrawShape(*get<1>(blended), *get<2>(blended), cb1);
+		if (FAILED(hr))
+			return hr;
+	}
+	assert(AllocationCounter::Count() == allocations || mResourcesCreated != resourcesCreated || mBlendedShapes.capacity() != blendedCapacity || mUploadRanges.capacity() != rangeCapacity);
+
 	mAwManager->DrawBars();
 	//
 	// Present our back buffer to our front buffer
@@ -30,8 +30,15 @@ class DirectXManager
 
 	std::map<std::wstring, ID3D11ShaderResourceView*> mTexMap; //	texture name - texture buffer
 	std::map<std::wstring, std::tuple<ID3D11VertexShader*, ID3D11InputLayout*, ID3D11PixelShader*>> mShaderMap; //	shader name - <Vertex Shader, Input Layout, Pixel Shader>
+	std::map<std::wstring, std::tuple<ID3D11VertexShader*, ID3D11InputLayout*, ID3D11PixelShader*>> mPackedShaderMap; //	shader name - <Vertex Shader, Input Layout, Pixel Shader> compiled for packed instances
 	std::map<GeometryType, std::tuple<ID3D11Buffer*, ID3D11Buffer*>> mGeometryBufferMap; //	geometry type - <Vertices, Indices>
-	std::map<std::string, ID3D11Buffer*> mInstanceMap; //	shape name - instance buffer
+	std::map<std::string, std::tuple<ID3D11Buffer*, ID3D11Buffer*, unsigned int>> mMeshBufferMap; //	shape name - <Vertices, Indices, Mesh Version>
+	std::map<std::string, std::tuple<ID3D11Buffer*, unsigned int, unsigned int, unsigned int>> mInstanceMap; //	shape name - <Instance Buffer, Instance Version, Capacity in bytes, Base Instance Version>
+	std::vector<std::pair<unsigned int, unsigned int>> mUploadRanges; //	reused by every upload so drawing does not allocate
+	std::vector<std::tuple<float, const GameObject*, const Shape*>> mBlendedShapes; //	<view depth, gameobject, shape> of the blended shapes waiting to be drawn back to front
+	int mInstanceBytesUploaded = 0;
+	unsigned int mResourcesCreated = 0; //	counts every buffer, texture and shader added to a map, drawing may only allocate while this grows
+	int mInstanceBytesSkipped = 0;
 
 	D3D_DRIVER_TYPE				mDriverType = D3D_DRIVER_TYPE_NULL;
 	D3D_FEATURE_LEVEL			mFeatureLevel = D3D_FEATURE_LEVEL_11_0;
@@ -54,13 +61,17 @@ class DirectXManager
 
 	AntTweakManager* mAwManager;
 
-	static HRESULT CompileShaderFromFile(const WCHAR * const pFileName, const LPCSTR pEntryPoint, const LPCSTR pShaderModel, ID3DBlob ** const pBlobOut);
+	static HRESULT CompileShaderFromFile(const WCHAR * const pFileName, const LPCSTR pEntryPoint, const LPCSTR pShaderModel, ID3DBlob ** const pBlobOut, const D3D_SHADER_MACRO * const pDefines = nullptr);
 	HRESULT InitDevice(const HWND& pHWnd);
 	HRESULT CreateConstantBuffers();
+	HRESULT CreateGeometryBuffers(const Shape& pShape, ID3D11Buffer** const pVertBuffer, ID3D11Buffer** const pIndBuffer) const;
 	HRESULT LoadGeometryBuffers(const Shape& pShape);
+	HRESULT LoadMeshBuffers(const Shape& pShape);
 	HRESULT LoadTextures(const Shape& pShape);
 	HRESULT LoadShaders(const Shape& pShape);
 	HRESULT LoadInstanceBuffers(const Shape& pShape);
+	unsigned int UploadInstances(ID3D11Buffer* const pBuffer, const Shape& pShape, const unsigned int pUploadedVersion);
+	HRESULT DrawShape(const GameObject& pGameObject, const Shape& pShape, ConstantBuffer& pConstantBuffer);
 
 public:
 
@@ -0,0 +1,8 @@
+#pragma once
+
+//Refers to an emitter in a ParticleEmitters pool - the generation changes whenever the slot is reused, so a handle kept past its emitter is ignored
+struct EmitterHandle
+{
+	int mSlot = -1;
+	unsigned int mGeneration = 0;
+};
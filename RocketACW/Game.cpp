@@ -1,4 +1,9 @@
 #include "Game.h"
+#include <chrono>
+#include "AllocationCounter.h"
+#include "TerrainBenchmark.h"
+#include "TerrainSnapshotWriter.h"
+#include "Result.h"
 
 using namespace DirectX;
 using namespace std;
@@ -19,6 +24,8 @@ Game::Game(const float pWidth, const float pHeight, AntTweakManager& pAwManager)
 
 	//Create the scene
 	CreateScene();
+	mCurrentState = { mRocket->Position(), mRocket->Rotation(), 0 };
+	mPreviousState = mCurrentState;
 
 	//World Stats
 	mAwManager->AddBar("WorldStats");
@@ -29,18 +36,57 @@ Game::Game(const float pWidth, const float pHeight, AntTweakManager& pAwManager)
 	mAwManager->AddVariable("WorldStats", "Cubes in Y", mTerrainY, "group = Terrain");
 	mAwManager->AddVariable("WorldStats", "Cubes in Z", mTerrainZ, "group = Terrain");
 	mAwManager->AddVariable("WorldStats", "Cube Count", mCubeCount, "group = Terrain");
+	mAwManager->AddVariable("WorldStats", "Visible Cubes", mVisibleCubeCount, "group = Terrain");
+	mAwManager->AddVariable("WorldStats", "Terrain Triangles", mTerrainTriangles, "group = Terrain");
+	mAwManager->AddWritableVariable("WorldStats", "Terrain Seed", mTerrainSeed, "group = Terrain");
+	mAwManager->AddWritableVariable("WorldStats", "Terrain Caves", mTerrainCaves, "group = Terrain min=0 max=1");
+	mAwManager->AddWritableVariable("WorldStats", "Terrain Storage", mTerrainStorage, "group = Terrain min=0 max=2");
+	mAwManager->AddVariable("WorldStats", "Terrain Memory KB", mTerrainMemory, "group = Terrain");
+	mAwManager->AddVariable("WorldStats", "Generation ms", mGenerationTime, "group = Terrain");
+	mAwManager->AddVariable("WorldStats", "Reset ms", mResetTime, "group = Terrain");
 
 	//Rocket
-	mAwManager->AddWritableVariable("WorldStats", "Rocket Thrust", mRocketSpeed, "group = Rocket step=0.1 min=0 max = 3");
+	mAwManager->AddWritableVariable("WorldStats", "Rocket Thrust", const_cast<float&>(mRocketFlight.Parameters().mThrust), "group = Rocket step=0.1 min=0 max = 5");
+	mAwManager->AddWritableVariable("WorldStats", "Rocket Drag", const_cast<float&>(mRocketFlight.Parameters().mDrag), "group = Rocket step=0.005 min=0 max = 0.2");
+	mAwManager->AddWritableVariable("WorldStats", "Gravity", const_cast<float&>(mRocketFlight.Parameters().mGravity), "group = Rocket step=0.1 min=0 max = 5");
+	mAwManager->AddVariable("WorldStats", "Rocket Mass", mRocketState.mMass, "group = Rocket");
 	mAwManager->AddVariable("WorldStats", "X Pos", const_cast<float&>(mRocket->Position().x), "group = Rocket");
 	mAwManager->AddVariable("WorldStats", "Y Pos", const_cast<float&>(mRocket->Position().y), "group = Rocket");
 	mAwManager->AddVariable("WorldStats", "Z Pos", const_cast<float&>(mRocket->Position().z), "group = Rocket");
+	mAwManager->AddVariable("WorldStats", "Broadphase Boxes", mBroadphaseBoxes, "group = Rocket");
+	mAwManager->AddVariable("WorldStats", "Altitude", mRocketAltitude, "group = Rocket");
+	mAwManager->AddVariable("WorldStats", "Impact X", mPredictedImpact.x, "group = Prediction");
+	mAwManager->AddVariable("WorldStats", "Impact Y", mPredictedImpact.y, "group = Prediction");
+	mAwManager->AddVariable("WorldStats", "Crater Cubes", mPredictedCrater, "group = Prediction");
+	mAwManager->AddVariable("WorldStats", "Prediction ms", mPredictionTime, "group = Prediction");
+	mAwManager->AddWritableVariable("WorldStats", "Prediction Budget ms", mPredictionBudget, "group = Prediction step=0.05 min=0.05 max=5");
+	mAwManager->AddWritableVariable("WorldStats", "Salvo Size", mSalvoSize, "group = Salvo min=1 max=10000");
+	mAwManager->AddWritableVariable("WorldStats", "Salvo Crater", mSalvoRadius, "group = Salvo step=0.5 min=0 max=10");
+	mAwManager->AddVariable("WorldStats", "Salvo Rockets", mSalvoCount, "group = Salvo");
+	mAwManager->AddVariable("WorldStats", "Cone Overlaps", mConeOverlaps, "group = Rocket");
+	mAwManager->AddWritableVariable("WorldStats", "Wind X", mWind.x, "group = Particles step=0.1 min=-10 max=10");
+	mAwManager->AddWritableVariable("WorldStats", "Wind Z", mWind.z, "group = Particles step=0.1 min=-10 max=10");
+	mAwManager->AddWritableVariable("WorldStats", "Engine Particles/s", mEngineRate, "group = Particles step=100 min=0 max=20000");
+	mAwManager->AddWritableVariable("WorldStats", "Explosion Particles", mExplosionParticleCount, "group = Particles min=0 max=16384");
+	mAwManager->AddWritableVariable("WorldStats", "Impact Particles", mImpactParticleCount, "group = Particles min=0 max=2000");
+	mAwManager->AddVariable("WorldStats", "Live Particles", mLiveParticles, "group = Particles");
+	mAwManager->AddVariable("WorldStats", "Live Emitters", mLiveEmitters, "group = Particles");
+	mAwManager->AddVariable("WorldStats", "Particle ms", mParticleTime, "group = Particles");
+	mAwManager->AddWritableVariable("WorldStats", "Debris Fraction", mDebrisFraction, "group = Debris step=0.05 min=0 max=1");
+	mAwManager->AddWritableVariable("WorldStats", "Debris Speed", mDebrisSpeed, "group = Debris step=0.5 min=0 max=30");
+	mAwManager->AddWritableVariable("WorldStats", "Debris Lifetime", mDebrisLifetime, "group = Debris step=0.5 min=0.5 max=20");
+	mAwManager->AddVariable("WorldStats", "Live Debris", mLiveDebris, "group = Debris");
+	mAwManager->AddVariable("WorldStats", "Debris ms", mDebrisTime, "group = Debris");
 
 	//Game Stats
 	mAwManager->AddBar("GameStats");
 	mAwManager->AddWritableVariable("GameStats", "Time Scale", mTimeScale, "step=0.1");
 	mAwManager->AddVariable("GameStats", "Time", mTime, "");
 	mAwManager->AddVariable("GameStats", "FPS", mFrameRate, "");
+	mAwManager->AddVariable("GameStats", "Frame Allocations", mFrameAllocations, "");
+	mAwManager->AddWritableVariable("GameStats", "Simulation Hz", mSimulationRate, "group = Simulation min=10 max=1000");
+	mAwManager->AddWritableVariable("GameStats", "Max Steps", mMaxSimulationSteps, "group = Simulation min=1 max=32");
+	mAwManager->AddVariable("GameStats", "Steps", mSimulationSteps, "group = Simulation");
 
 	//Camera
 	mAwManager->AddVariable("GameStats", "Screen Width", mWidth, "group = Camera");
@@ -68,6 +114,17 @@ Game::Game(const float pWidth, const float pHeight, AntTweakManager& pAwManager)
 	mAwManager->AddWritableVariable("GameStats", "EngineColour", const_cast<XMFLOAT4&>(mLights[2].Colour()), "group = Lights");
 }
 
+/// <summary>
+/// Destructor which waits for a terrain benchmark still running to finish writing its results
+/// </summary>
+Game::~Game()
+{
+	if (mBenchmark.joinable())
+	{
+		mBenchmark.join();
+	}
+}
+
 /// <summary>
 /// Creates the scene which the game will run
 /// </summary>
@@ -80,10 +137,12 @@ void Game::CreateScene()
 	mTerrainY = 20;
 	mTerrainZ = 20;
 	mTerrainScale = 1.5f;
-	mRocketSpeed = 1.0f;
 	mExplosionRadius = 5.0f;
 #endif
 
+	//a saved terrain replaces the generated one and brings its own size and scale, so it is loaded before anything is placed
+	const auto terrainLoaded = SUCCEEDED(LoadTerrain(false));
+
 	//reserving space for gameobjects so that memory only needs to be allocated once - better efficiency and avoid pointer invalidation
 	mGameObjects.reserve(10);
 	mLights.reserve(5);
@@ -91,36 +150,25 @@ void Game::CreateScene()
 	//						Scale						Rotate					Translate
 	GameObject env(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1));
 	env.AddShape(nullptr, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"desertSkybox.dds"), wstring(L""), wstring(L""), wstring(L"environmentShader.fx"), "EnvironmentMap", true, false, GeometryType::CUBE);
-	mGameObjects.emplace_back(env);
+	mGameObjects.emplace_back(move(env));
 
 	//launcher
 	//							Scale						Rotate					Translate
 	GameObject launcher(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(-(mTerrainScale*mTerrainX) * 4 / 10, 0, 0, 1));
 	launcher.AddShape(nullptr, XMFLOAT4(4, 2, 4, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, -0.5f, 0, 1), wstring(L"corrugated_metal.dds"), wstring(L""), wstring(L""), wstring(L"defaultShader.fx"), "LauncherBase", false, false, GeometryType::CUBE);
 	launcher.AddShape(nullptr, XMFLOAT4(0.2f, 4, 0.2f, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 2.5f, 0, 1), wstring(L"corrugated_metal.dds"), wstring(L""), wstring(L""), wstring(L"defaultShader.fx"), "LauncherPole", false, false, GeometryType::CUBE);
-	mGameObjects.emplace_back(launcher);
+	mGameObjects.emplace_back(move(launcher));
 
 	//Create Terrain (Instanced)
 	//							Scale												Rotate				Translate
 	GameObject terrain(XMFLOAT4(mTerrainScale, mTerrainScale, mTerrainScale, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(-(mTerrainScale*mTerrainX) / 2, -(mTerrainScale*mTerrainY), -(mTerrainScale*mTerrainZ) / 2, 1));
 
-	vector<Instance> instances;
-
-	for (auto x = 0; x < mTerrainX; ++x)
+	//Only the cubes on the surface of the occupancy grid are instanced, the shapes are added once the object is in place
+	if (!terrainLoaded)
 	{
-		for (auto y = 0; y < mTerrainY; ++y)
-		{
-			for (auto z = 0; z < mTerrainZ; ++z)
-			{
-				instances.emplace_back(Instance{ XMFLOAT3(x,y,z) });
-			}
-		}
+		GenerateTerrain();
 	}
-
-	//Instanced Cube
-	//									Scale			Rotate				Translate
-	terrain.AddShape(&instances, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"desert.dds"), wstring(L"desert_norm.dds"), wstring(L"desert_height.dds"), wstring(L"instanceParallaxShader.fx"), "TerrainCube", false, false, GeometryType::CUBE);
-	mGameObjects.emplace_back(terrain);
+	mGameObjects.emplace_back(move(terrain));
 
 	//Rocket object
 	//							Scale				Rotate				Translate
@@ -129,23 +177,71 @@ void Game::CreateScene()
 	rocket.AddShape(nullptr, XMFLOAT4(0.5f, 5, 0.5f, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"corrugated_metal.dds"), wstring(L"corrugated_metal_norm.dds"), wstring(L"corrugated_metal_height.dds"), wstring(L"parallaxShader.fx"), "RocketBody", false, false, GeometryType::CYLINDER);
 	//cone
 	rocket.AddShape(nullptr, XMFLOAT4(0.75f, 2, 0.75f, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 3, 0, 1), wstring(L"desertSkybox.dds"), wstring(L""), wstring(L""), wstring(L"chromeShader.fx"), "RocketCone", false, false, GeometryType::CONE);
-	
-	//Create particles
-	//Create instances
-	vector<Instance> engineParticles;
-	for (auto i = 0; i < 2000; ++i)
+	mGameObjects.emplace_back(move(rocket));
+
+	//Salvo - each rocket in flight is an instance of the one shape, so the whole salvo is a single draw
+	vector<Instance> salvoRockets;
+	GameObject salvo(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1));
+	salvo.AddShape(&salvoRockets, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"corrugated_metal.dds"), wstring(L""), wstring(L""), wstring(L"salvoShader.fx"), "SalvoRockets", false, false, GeometryType::CONE, InstanceFormat::PITCHED);
+	mGameObjects.emplace_back(move(salvo));
+
+	//Impact marker - a ring of small cubes the size of the crater, moved to the predicted impact while the rocket waits to launch
+	//each cube is dropped onto the ground below it by a ray, so the ring follows the shape of the terrain
+	for (auto i = 0; i < 32; ++i)
+	{
+		const auto angle = XM_2PI * i / 32;
+		mMarkerRing.emplace_back(Instance{ XMFLOAT3(cosf(angle) * mExplosionRadius / mMarkerScale, 0, sinf(angle) * mExplosionRadius / mMarkerScale) });
+	}
+	mMarkerInstances.reserve(mMarkerRing.size());
+	mMarkerRays.reserve(mMarkerRing.size());
+	mMarkerHits.reserve(mMarkerRing.size());
+	GameObject marker(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1));
+	marker.AddShape(&mNoInstances, XMFLOAT4(mMarkerScale, mMarkerScale, mMarkerScale, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"flame.dds"), wstring(L""), wstring(L""), wstring(L"instanceShader.fx"), "ImpactMarker", false, false, GeometryType::CUBE);
+	mGameObjects.emplace_back(move(marker));
+
+	//Particles - simulated on the CPU in world space, each emitter slot is drawn as one blended shape of camera facing quads
+	//a shape per slot gives every emitter its own instance buffer, named after the slot so a reused slot reuses the buffer
+	//the shapes are created with room for a full slot, so neither their storage nor their buffers on the GPU grow during play
+	const vector<Instance> smokeSlot(mSmokeEmitters.Capacity());
+	const vector<Instance> fireSlot(mFireEmitters.Capacity());
+	GameObject particles(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1));
+	for (auto i = 0; i < mSmokeEmitters.Slots(); ++i)
+	{
+		particles.AddShape(&smokeSlot, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"stones.dds"), wstring(L""), wstring(L""), wstring(L"particleShader.fx"), "SmokeEmitter" + to_string(i), false, true, GeometryType::QUAD, InstanceFormat::PARTICLE);
+	}
+	for (auto i = 0; i < mFireEmitters.Slots(); ++i)
 	{
-		engineParticles.emplace_back(Instance{ XMFLOAT3(0,0,i) });
+		particles.AddShape(&fireSlot, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"flame.dds"), wstring(L""), wstring(L""), wstring(L"particleShader.fx"), "FireEmitter" + to_string(i), false, true, GeometryType::QUAD, InstanceFormat::PARTICLE);
 	}
-	//Create object + shape
-	rocket.AddShape(&engineParticles, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"stones.dds"), wstring(L""), wstring(L""), wstring(L"engineParticleShader.fx"), "Particles", false, true, GeometryType::QUAD);
-	mGameObjects.emplace_back(rocket);
+	mGameObjects.emplace_back(move(particles));
+	mParticleInstances.reserve((max)(mSmokeEmitters.Capacity(), mFireEmitters.Capacity()));
+
+	//Debris - cubes thrown out of craters, simulated in grid space so the object follows the terrain and the whole ring is one draw
+	//							Scale												Rotate				Translate
+	const auto debrisSize = mVoxelDebris.Size();
+	const vector<Instance> debrisRing(mVoxelDebris.Capacity());
+	GameObject debris(XMFLOAT4(mTerrainScale, mTerrainScale, mTerrainScale, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(-(mTerrainScale*mTerrainX) / 2, -(mTerrainScale*mTerrainY), -(mTerrainScale*mTerrainZ) / 2, 1));
+	debris.AddShape(&debrisRing, XMFLOAT4(debrisSize, debrisSize, debrisSize, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"desert.dds"), wstring(L""), wstring(L""), wstring(L"instanceShader.fx"), "Debris", false, false, GeometryType::CUBE);
+	mGameObjects.emplace_back(move(debris));
+	mDebrisInstances.reserve(mVoxelDebris.Capacity());
 
 	//This pointer will be invalidated if the vector is ever reallocated (must not add over the capacity or the memory will be reallocated)
 	mEnvironment = &mGameObjects[0];
 	mLauncher = &mGameObjects[1];
 	mTerrain = &mGameObjects[2];
 	mRocket = &mGameObjects[3];
+	mSalvoObject = &mGameObjects[4];
+	mImpactMarker = &mGameObjects[5];
+	mParticles = &mGameObjects[6];
+	mDebris = &mGameObjects[7];
+
+	//every gameobject is indexed by its position in the scene, its boxes follow it from then on
+	for (auto i = 0; i < static_cast<int>(mGameObjects.size()); ++i)
+	{
+		mGameObjects[i].Register(mBroadphase, i);
+	}
+	mBroadphaseHits.reserve(64);
+	BuildTerrainShapes();
 
 	InitialiseCameras();
 }
@@ -244,6 +340,43 @@ void Game::HandleInput(const double& pDt)
 	{
 		mAwManager->ToggleVisible();
 	}
+	//g to switch the terrain between instanced cubes and greedy meshed chunks
+	if (mTracker.pressed.G)
+	{
+		mGreedyTerrain = !mGreedyTerrain;
+		BuildTerrainShapes();
+	}
+	//k saves the terrain as it stands, l loads the saved terrain back
+	if (mTracker.pressed.K)
+	{
+		SaveTerrain();
+	}
+	if (mTracker.pressed.L)
+	{
+		//the launcher, rocket and cameras were placed around the grid in play, so only a snapshot of the same grid is taken
+		if (SUCCEEDED(LoadTerrain(true)))
+		{
+			mVoxelDebris.Clear();
+			BuildTerrainShapes();
+		}
+	}
+	//b benchmarks the terrain stores at several sizes and writes the results to TerrainBenchmark.txt
+	//the benchmark runs in the background on its own copy of the generator, a press while one is running is ignored
+	if (mTracker.pressed.B && !mBenchmarking)
+	{
+		if (mBenchmark.joinable())
+		{
+			mBenchmark.join();
+		}
+		mBenchmarking = true;
+		mBenchmark = thread([this, generator = mTerrainGenerator]()
+		{
+			TerrainBenchmark benchmark(generator);
+			benchmark.Run({ XMINT3(64, 32, 64), XMINT3(128, 40, 128), XMINT3(256, 64, 256), XMINT3(512, 64, 512) });
+			benchmark.Write("TerrainBenchmark.txt");
+			mBenchmarking = false;
+		});
+	}
 	//Function keys F1 to F5 will select cameras C1 to C5, respectively 
 	if (state.F1)
 	{
@@ -286,10 +419,20 @@ void Game::HandleInput(const double& pDt)
 			}
 		}
 	}
+	//v launches a salvo from the launcher, spread across the depth of the terrain
+	if (mTracker.pressed.V)
+	{
+		mSalvo.Launch(XMFLOAT4(mLauncher->Position().x, 3, 0, 1), mSalvoSize, mTerrainScale * mTerrainZ * 0.8f, -0.7f, 0.0f);
+		mSalvoInstances.reserve(mSalvo.Count());
+		mSalvoImpacts.reserve(mSalvo.Count());
+	}
 	//Function key F11, to launch the rocket.
-	if (state.F11)
+	if (state.F11 && !mLaunch)
 	{
 		mLaunch = true;
+		mEngineEmitter = mSmokeEmitters.Spawn(mEngineSmoke);
+		mRocketState = mRocketFlight.Launch(mRocket->Position(), mRocket->Rotation().z);
+		mImpactMarker->SetShapeInstances(0, mNoInstances);
 	}
 	//Keys 't' / 'T' decrease / increase a factor that globally slows / speeds - up time - dependent effects
 	if (state.T)
@@ -306,7 +449,7 @@ void Game::HandleInput(const double& pDt)
 }
 
 /// <summary>
-/// Checks for collisions between the shape and the terrain
+/// Checks for collisions between the shape and the terrain - the shape is swept from where it was last frame so it cannot pass through the terrain at any time scale
 /// </summary>
 /// <param name="pShape"></param>
 void Game::CheckCollision(const Shape & pShape)
@@ -317,22 +460,51 @@ void Game::CheckCollision(const Shape & pShape)
 	XMFLOAT4X4 transform{};
 	XMStoreFloat4x4(&transform, XMLoadFloat4x4(pShape.Transform()) * XMLoadFloat4x4(mRocket->Transform()));
 	const auto conePosition = XMFLOAT4(transform._41, transform._42, transform._43, transform._44);
-	const auto terrain = mTerrain->Shapes()[0].Instances();
 
-	for (const auto& instance : terrain)
+	const auto previousPosition = mHasPreviousCone ? mPreviousCone : conePosition;
+	mPreviousCone = conePosition;
+	mHasPreviousCone = true;
+
+	//Move the path of the cone into grid space so only the cells along it are tested
+	VoxelHit hit{};
+	if (mVoxelTerrain.Store().SweepSphere(TerrainGridPosition(previousPosition), TerrainGridPosition(conePosition), (coneRadius + cubeRadius) / mTerrainScale, hit))
 	{
-		const auto cubePosition = XMVector3Transform(XMLoadFloat3(&instance.mPosition), XMLoadFloat4x4(mTerrain->Transform()));
-		XMFLOAT4 distance{};
-		XMStoreFloat4(&distance, XMVector4Length(XMLoadFloat4(&conePosition) - cubePosition));
-		if (distance.x < coneRadius + cubeRadius)
-		{
-			ResetRocket();
-			Explosion(transform);
-			return;
-		}
+		//the explosion is where the cone first touched the terrain, not where the frame left it
+		XMFLOAT4 impact{};
+		XMStoreFloat4(&impact, XMVectorLerp(XMLoadFloat4(&previousPosition), XMLoadFloat4(&conePosition), hit.mTime));
+		transform._41 = impact.x;
+		transform._42 = impact.y;
+		transform._43 = impact.z;
+		ResetRocket();
+		Explosion(transform);
 	}
 }
 
+/// <summary>
+/// Finds the transform from world space into the terrains grid space, where each cube sits on an integer coordinate
+/// </summary>
+/// <returns> the world to grid transform </returns>
+XMFLOAT4X4 Game::TerrainGridTransform() const
+{
+	const auto terrainTransform = XMLoadFloat4x4(mTerrain->Shapes()[0].Transform()) * XMLoadFloat4x4(mTerrain->Transform());
+	XMFLOAT4X4 gridTransform{};
+	XMStoreFloat4x4(&gridTransform, XMMatrixInverse(nullptr, terrainTransform));
+	return gridTransform;
+}
+
+/// <summary>
+/// Converts a world position into the terrains grid space, where each cube sits on an integer coordinate
+/// </summary>
+/// <param name="pWorldPosition"> the position in world space </param>
+/// <returns> the position in grid space </returns>
+XMFLOAT3 Game::TerrainGridPosition(const XMFLOAT4& pWorldPosition) const
+{
+	const auto gridTransform = TerrainGridTransform();
+	XMFLOAT3 gridPosition{};
+	XMStoreFloat3(&gridPosition, XMVector3TransformCoord(XMLoadFloat4(&pWorldPosition), XMLoadFloat4x4(&gridTransform)));
+	return gridPosition;
+}
+
 /// <summary>
 /// Delete the cubes in the explosion radius and create at light at the explosion location
 /// </summary>
@@ -355,43 +527,167 @@ void Game::Explosion(const XMFLOAT4X4& pTransform)
 		mAwManager->AddWritableVariable("GameStats", "ExplosionColour", const_cast<XMFLOAT4&>(mLights[3].Colour()), "group = Lights");
 	}
 
-	//Create particles
-		//Create instances
-	vector<Instance> instances;
-	for (auto i = 0; i < 2000; ++i)
+	//a fireball thrown up out of the crater, the particles fall back and settle on the ground
+	//every explosion has an emitter of its own, released straight away so its slot is free again once the fireball has died down
+	auto emitter = mFireEmitters.Spawn(mExplosionFire);
+	mFireEmitters.Emit(emitter, XMFLOAT3(conePosition.x, conePosition.y, conePosition.z), XMFLOAT3(0, 3, 0), 4.0f, mExplosionRadius * 0.3f, 4.0f, 1.5f, mExplosionParticleCount);
+	mFireEmitters.Release(emitter);
+
+	//Destroy terrain - carve the crater out of the grid, only the cubes around the crater are re-evaluated for visibility
+	//a share of the cubes are thrown out as debris first, while they are still in the grid
+	const auto crater = TerrainGridPosition(conePosition);
+	mVoxelDebris.Break(mVoxelTerrain.Store(), crater, mExplosionRadius / mTerrainScale, mDebrisFraction, mDebrisSpeed, mDebrisLifetime);
+	if (mVoxelTerrain.Carve(crater, mExplosionRadius / mTerrainScale) > 0)
 	{
-		instances.emplace_back(Instance{ XMFLOAT3(0,0,i) });
+		UpdateTerrainShapes();
 	}
-	//Create object + shape
-	GameObject particles(XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(conePosition.x, conePosition.y-3, conePosition.z, 1));
-	particles.AddShape(&instances, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"flame.dds"), wstring(L""), wstring(L""), wstring(L"explosionParticleShader.fx"), "Particles", false, true, GeometryType::QUAD);
-	mGameObjects.emplace_back(particles);
-	mParticleTimer = 10.0f;
+}
 
-	//Destroy terrain
-	vector<Instance> indexToRemove;
-	const auto terrain = mTerrain->Shapes()[0].Instances();
-	for (const auto& instance : terrain)
+/// <summary>
+/// Builds the voxel terrain from the current seed and settings, the same seed always gives the same terrain
+/// </summary>
+void Game::GenerateTerrain()
+{
+	const auto start = chrono::high_resolution_clock::now();
+
+	mTerrainGenerator.SetSeed(mTerrainSeed);
+	mTerrainGenerator.SetCaves(mTerrainCaves != 0, 1.0f / 12.0f, 0.7f);
+	mVoxelTerrain.SetStorage(static_cast<VoxelStorage>(mTerrainStorage));
+	mVoxelTerrain.Generate(mTerrainX, mTerrainY, mTerrainZ, mTerrainGenerator);
+	mBuiltSeed = mTerrainSeed;
+	mBuiltCaves = mTerrainCaves;
+	mBuiltStorage = mTerrainStorage;
+
+	mGenerationTime = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+/// <summary>
+/// Replaces the terrain shapes to match the current render mode, there is one shape per chunk - instanced cubes or a greedy mesh
+/// </summary>
+void Game::BuildTerrainShapes()
+{
+	mPredictor.Invalidate();
+	mTerrain->ClearShapes();
+	//instances are whole grid cells, so they pack into 4 bytes whenever the terrain fits in 10 bits per axis
+	const auto format = CanPackInstance(mTerrainX - 1, mTerrainY - 1, mTerrainZ - 1) ? InstanceFormat::PACKED : InstanceFormat::FLOAT3;
+	//									Scale			Rotate				Translate
+	for (auto i = 0; i < mVoxelTerrain.ChunkCount(); ++i)
 	{
-		const auto cubePosition = XMVector3Transform(XMLoadFloat3(&instance.mPosition), XMLoadFloat4x4(mTerrain->Transform()));
-		XMFLOAT4 distance{};
-		XMStoreFloat4(&distance, XMVector4Length(XMLoadFloat4(&conePosition) - cubePosition));
-		if (distance.x < mExplosionRadius)
+		if (mGreedyTerrain)
+		{
+			//Meshes start empty and are filled in by the update below
+			mTerrain->AddShape(nullptr, XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"desert.dds"), wstring(L"desert_norm.dds"), wstring(L"desert_height.dds"), wstring(L"parallaxShader.fx"), "TerrainMesh" + to_string(i), false, false, GeometryType::MESH);
+		}
+		else
+		{
+			mTerrain->AddShape(&mVoxelTerrain.ChunkInstances(i), XMFLOAT4(1, 1, 1, 1), XMFLOAT4(0, 0, 0, 1), XMFLOAT4(0, 0, 0, 1), wstring(L"desert.dds"), wstring(L"desert_norm.dds"), wstring(L"desert_height.dds"), wstring(L"instanceParallaxShader.fx"), "TerrainChunk" + to_string(i), false, false, GeometryType::CUBE, format);
+		}
+	}
+
+	if (mGreedyTerrain)
+	{
+		mVoxelTerrain.MarkAllChunksDirty();
+		UpdateTerrainShapes();
+	}
+	else
+	{
+		mVoxelTerrain.ClearDirtyChunks();
+	}
+}
+
+/// <summary>
+/// Pushes the chunks which have changed since the last update into their shapes, untouched chunks are not uploaded again
+/// </summary>
+void Game::UpdateTerrainShapes()
+{
+	mPredictor.Invalidate();
+	vector<SimpleVertex> vertices;
+	vector<WORD> indices;
+	XMINT3 minCell{};
+	XMINT3 maxCell{};
+	for (const auto& chunk : mVoxelTerrain.DirtyChunks())
+	{
+		if (mGreedyTerrain)
+		{
+			mVoxelTerrain.ChunkBounds(chunk, minCell, maxCell);
+			mMesher.BuildChunk(mVoxelTerrain.Store(), minCell, maxCell, vertices, indices);
+			mTerrain->SetShapeMesh(chunk, vertices, indices);
+		}
+		else
 		{
-			indexToRemove.push_back(instance);
+			mTerrain->SetShapeInstances(chunk, mVoxelTerrain.ChunkInstances(chunk));
 		}
 	}
-	mTerrain->RemoveInstancesFromShape(0, indexToRemove);
+	mVoxelTerrain.ClearDirtyChunks();
 }
 
 /// <summary>
-/// The game update loop
+/// Loads the saved terrain snapshot, taking its size and scale - the file is mapped so only the pages holding the occupancy are read
 /// </summary>
-/// <param name="pDt"> delta time used to update the scene </param>
+/// <param name="pKeepGrid"> whether the snapshot must have the size and scale of the terrain in play, because the scene has already been placed around it </param>
+/// <returns> Result::OK if the terrain was loaded, Result::FAIL if there is no valid snapshot or it does not fit the grid in play </returns>
+HRESULT Game::LoadTerrain(const bool pKeepGrid)
+{
+	const auto start = chrono::high_resolution_clock::now();
+
+	TerrainSnapshot snapshot;
+	const auto hr = snapshot.Open(L"Terrain.snapshot");
+	if (FAILED(hr))
+		return hr;
+
+	const auto& header = snapshot.Header();
+	if (pKeepGrid && (header.mSizeX != mTerrainX || header.mSizeY != mTerrainY || header.mSizeZ != mTerrainZ || header.mScale != mTerrainScale))
+		return Result::FAIL;
+	mTerrainX = header.mSizeX;
+	mTerrainY = header.mSizeY;
+	mTerrainZ = header.mSizeZ;
+	mTerrainScale = header.mScale;
+	mVoxelTerrain.SetStorage(static_cast<VoxelStorage>(mTerrainStorage));
+	mVoxelTerrain.Load(snapshot);
+	mBuiltSeed = mTerrainSeed;
+	mBuiltCaves = mTerrainCaves;
+	mBuiltStorage = mTerrainStorage;
+
+	mGenerationTime = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+	return hr;
+}
+
+/// <summary>
+/// Saves the terrain as it stands, craters included, to the terrain snapshot
+/// </summary>
+/// <returns> Result::OK if the snapshot was written, Result::FAIL otherwise </returns>
+HRESULT Game::SaveTerrain() const
+{
+	const auto& store = mVoxelTerrain.Store();
+	TerrainSnapshotWriter writer;
+	auto hr = writer.Open(L"Terrain.snapshot", store.SizeX(), store.SizeY(), store.SizeZ(), mTerrainScale, store.Count(), false);
+	if (FAILED(hr))
+		return hr;
+	hr = writer.WriteOccupancy(store);
+	if (FAILED(hr))
+		return hr;
+	return writer.Close();
+}
+
+/// <summary>
+/// The game update loop - the scene is simulated in fixed steps and drawn blended between the last two of them
+/// </summary>
+/// <param name="pDt"> delta time since the last frame </param>
 void Game::Update(const double& pDt)
 {
-	mCubeCount = mTerrain->Shapes()[0].Instances().size();
-	mTime += pDt;
+	//every allocation the main thread made since the last update, rendering included - only shown, the paths which must not allocate check themselves
+	const auto allocations = AllocationCounter::Count();
+	mFrameAllocations = static_cast<int>(allocations - mAllocations);
+	mAllocations = allocations;
+
+	mCubeCount = mVoxelTerrain.Store().Count();
+	mTerrainMemory = static_cast<int>(mVoxelTerrain.Store().MemoryBytes() / 1024);
+	mVisibleCubeCount = mVoxelTerrain.InstanceCount();
+	mTerrainTriangles = 0;
+	for (const auto& shape : mTerrain->Shapes())
+	{
+		mTerrainTriangles += shape.Indices().size() / 3 * (shape.IsInstanced() ? shape.InstanceCount() : 1);
+	}
 
 	//smooth framerate over the a sample of deltatimes
 	mAverageDt = 0;
@@ -408,28 +704,62 @@ void Game::Update(const double& pDt)
 	mAverageDt /= 50;
 	mFrameRate = 1 / mAverageDt;
 
-	if (mLaunch)
+	//the rocket was last drawn blended, put it back where the simulation left it before anything moves it
+	mRocket->SetTranslation(mCurrentState.mRocketTranslation);
+	mRocket->SetRotation(mCurrentState.mRocketRotation);
+	HandleInput(pDt);
+	mCurrentState.mRocketTranslation = mRocket->Position();
+	mCurrentState.mRocketRotation = mRocket->Rotation();
+
+	const auto step = 1.0 / (max)(mSimulationRate, 1);
+	if (!mLaunch)
 	{
-		//Launch upwards
-		XMFLOAT4 translation{};
-		XMStoreFloat4(&translation, XMLoadFloat4(&mRocket->Up()) * mRocketSpeed * mTimeScale * pDt);
-		mRocket->Translate(translation);
-		//Rotate on the z-axis to curve back to the ground
-		if (mRocket->Rotation().z > -(XM_PI * 8 / 10))
-		{
-			mRocket->Rotate(XMFLOAT4(0, 0, XMConvertToRadians(-2.5)*mTimeScale*pDt, 1));
-		}
-		else if (mRocket->Rotation().z > -XM_PI)
-		{
-			mRocket->Rotate(XMFLOAT4(0, 0, XMConvertToRadians(-1)*mTimeScale*pDt, 1));
-		}
+		PredictImpact(static_cast<float>(step * mTimeScale));
+	}
+
+	//step the simulation at a fixed rate, dropping the time of a frame too long to catch up on rather than falling further behind
+	mAccumulator += pDt;
+	mSimulationSteps = 0;
+	mParticleTime = 0;
+	mDebrisTime = 0;
+	while (mAccumulator >= step && mSimulationSteps < mMaxSimulationSteps)
+	{
+		mPreviousState = mCurrentState;
+		Simulate(step);
+		mCurrentState.mRocketTranslation = mRocket->Position();
+		mCurrentState.mRocketRotation = mRocket->Rotation();
+		mAccumulator -= step;
+		++mSimulationSteps;
 	}
+	if (mAccumulator >= step)
+	{
+		mAccumulator = fmod(mAccumulator, step);
+	}
+
+	//the height of the rocket above the ground below it, the grid is only scaled and moved so straight down in the world is straight down in the grid
+	RayHit ground{};
+	const auto groundRay = TerrainRay{ TerrainGridPosition(mRocket->Position()), XMFLOAT3(0, -1, 0), static_cast<float>(mTerrainY) * 4 };
+	mRocketAltitude = mVoxelTerrain.Store().Raycast(groundRay, ground) ? ground.mDistance * mTerrainScale : -1.0f;
+
+	//draw the scene the fraction of a step the accumulator holds past the last simulated state
+	const auto alpha = static_cast<float>(mAccumulator / step);
+	XMFLOAT4 translation{};
+	XMFLOAT4 rotation{};
+	XMStoreFloat4(&translation, XMVectorLerp(XMLoadFloat4(&mPreviousState.mRocketTranslation), XMLoadFloat4(&mCurrentState.mRocketTranslation), alpha));
+	XMStoreFloat4(&rotation, XMVectorLerp(XMLoadFloat4(&mPreviousState.mRocketRotation), XMLoadFloat4(&mCurrentState.mRocketRotation), alpha));
+	mRocket->SetTranslation(translation);
+	mRocket->SetRotation(rotation);
+	const auto dayAngle = mPreviousState.mDayAngle + (mCurrentState.mDayAngle - mPreviousState.mDayAngle) * alpha;
+	//Sun
+	mLights[0].SetOrbit(XMFLOAT4(0, 0, dayAngle, 1));
+	//Moon
+	mLights[1].SetOrbit(XMFLOAT4(0, 0, dayAngle, 1));
+
 	XMFLOAT4 enginePos{};
 	const auto rocketPos = mRocket->Position();
 	XMStoreFloat4(&enginePos, XMLoadFloat4(&rocketPos) - (XMLoadFloat4(&mRocket->Up()) * 5));
 	mLights[2].SetTranslation(enginePos);
 
-	HandleInput(pDt);
 	if (mActiveCamera->Name() == "RocketConeCam")
 	{
 		XMFLOAT4X4 transform{};
@@ -447,29 +777,275 @@ void Game::Update(const double& pDt)
 	{
 		mActiveCamera->LookAt(mRocket->Position());
 	}
+	//the salvo is blended between its last two steps like the rocket, each rocket pointing along its own pitch
+	if (mSalvo.Count() > 0 || mSalvoObject->Shapes()[0].InstanceCount() > 0)
+	{
+		{
+			const AllocationFreeScope allocationFree;
+			mSalvo.Instances(mSalvoInstances, alpha);
+		}
+		mSalvoObject->SetShapePitchedInstances(0, mSalvoInstances);
+	}
+	mSalvoCount = mSalvo.Count();
+	UpdateParticles();
+	UpdateDebris();
+	mBroadphaseBoxes = mBroadphase.Count();
+}
 
-	//Check collisions with the cone
-	const auto rocket = mRocket->Shapes();
-	for (const auto& shape : rocket)
+/// <summary>
+/// Predicts where the rocket will land if it is launched now, flying the same steps the launch would
+/// The prediction is worked on within a budget each frame and kept until the pitch, flight model or terrain changes, so a settled aim costs nothing
+/// </summary>
+/// <param name="pDt"> the scaled step the rocket will be flown with </param>
+void Game::PredictImpact(const float pDt)
+{
+	const auto launch = mRocketFlight.Launch(mRocket->Position(), mRocket->Rotation().z);
+	if (!mPredictor.Predicts(mRocketFlight.Parameters(), launch, pDt))
+	{
+		mPredictor.Start(mRocketFlight.Parameters(), launch, pDt, *mRocket->Shapes()[1].Transform());
+		mImpactMarker->SetShapeInstances(0, mNoInstances);
+		mPredictionTime = 0;
+	}
+	if (mPredictor.Finished())
+	{
+		return;
+	}
+
+	const auto start = chrono::high_resolution_clock::now();
+	const auto coneRadius = 0.5f;
+	const auto cubeRadius = mTerrainScale / 2;
+	if (mPredictor.Advance(mVoxelTerrain.Store(), TerrainGridTransform(), (coneRadius + cubeRadius) / mTerrainScale, -(mTerrainScale * mTerrainY) - 10, mPredictionBudget) && mPredictor.Hit())
+	{
+		const auto& impact = mPredictor.Impact();
+		mPredictedImpact = impact;
+		mPredictedCrater = mVoxelTerrain.Store().CountSphere(mPredictor.GridImpact(), mExplosionRadius / mTerrainScale);
+		DrapeMarker(impact);
+	}
+	mPredictionTime += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+/// <summary>
+/// Moves the impact marker to the impact and drops each of its cubes onto the terrain below, the rays all point down so they are cast as packets of four
+/// A cube with no terrain below it is left level with the impact
+/// </summary>
+/// <param name="pImpact"> the predicted impact in world space </param>
+void Game::DrapeMarker(const XMFLOAT3& pImpact)
+{
+	//rays start above the highest cell and reach past the lowest one
+	const auto height = static_cast<float>(mTerrainY);
+	mMarkerRays.clear();
+	for (const auto& cube : mMarkerRing)
+	{
+		const auto grid = TerrainGridPosition(XMFLOAT4(pImpact.x + cube.mPosition.x * mMarkerScale, pImpact.y, pImpact.z + cube.mPosition.z * mMarkerScale, 1));
+		mMarkerRays.emplace_back(TerrainRay{ XMFLOAT3(grid.x, height, grid.z), XMFLOAT3(0, -1, 0), height + 1 });
+	}
+	mVoxelTerrain.Store().Raycast(mMarkerRays, mMarkerHits);
+
+	const auto gridToWorld = XMLoadFloat4x4(mTerrain->Shapes()[0].Transform()) * XMLoadFloat4x4(mTerrain->Transform());
+	mMarkerInstances.clear();
+	for (size_t i = 0; i < mMarkerRing.size(); ++i)
 	{
-		if (shape.Name() == "RocketCone")
+		auto cube = mMarkerRing[i];
+		const auto& hit = mMarkerHits[i];
+		if (hit.mHit)
 		{
-			CheckCollision(shape);
+			//the top face of the cell which was hit
+			const auto top = XMVector3TransformCoord(XMVectorSet(static_cast<float>(hit.mCell.x), hit.mCell.y + 0.5f, static_cast<float>(hit.mCell.z), 1), gridToWorld);
+			cube.mPosition.y = (XMVectorGetY(top) - pImpact.y) / mMarkerScale;
 		}
+		mMarkerInstances.emplace_back(cube);
 	}
+	mImpactMarker->SetTranslation(XMFLOAT4(pImpact.x, pImpact.y, pImpact.z, 1));
+	mImpactMarker->SetShapeInstances(0, mMarkerInstances);
+}
 
-	if (mParticleTimer > 0)
+/// <summary>
+/// Advances everything time dependent by one fixed step, so the result does not depend on the framerate
+/// </summary>
+/// <param name="pDt"> the length of the step </param>
+void Game::Simulate(const double& pDt)
+{
+	mTime += pDt;
+
+	if (mLaunch)
 	{
-		mParticleTimer -= pDt * mTimeScale;
+		//the flight model runs in scaled time, the gameobject is only moved to where it says
+		{
+			const AllocationFreeScope allocationFree;
+			mRocketFlight.Step(mRocketState, static_cast<float>(pDt * mTimeScale));
+			EmitEngineParticles(static_cast<float>(pDt * mTimeScale));
+		}
+		//moving the gameobject moves its boxes in the broadphase, which may take more cells than they ever have and grow the links
+		mRocket->SetTranslation(XMFLOAT4(mRocketState.mPosition.x, mRocketState.mPosition.y, mRocketState.mPosition.z, 1));
+		mRocket->SetRotation(XMFLOAT4(0, 0, mRocketState.mPitch, 1));
 	}
-	if (mParticleTimer < 0 && mGameObjects.size() > 4)
+
+	//Check collisions with the cone
+	const auto& rocketShapes = mRocket->Shapes();
+	for (auto i = 0; i < static_cast<int>(rocketShapes.size()); ++i)
+	{
+		if (rocketShapes[i].Name() == "RocketCone")
+		{
+			CheckCollision(rocketShapes[i]);
+
+			//the broadphase has kept the cones box up to date, find the boxes of the other gameobjects it touches
+			const auto& cone = mBroadphase.Proxy(mRocket->ShapeProxy(i));
+			mBroadphase.Query(cone.mMin, cone.mMax, mBroadphaseHits);
+			mConeOverlaps = static_cast<int>(count_if(mBroadphaseHits.begin(), mBroadphaseHits.end(), [&](const int pProxy)
+			{
+				return mBroadphase.Proxy(pProxy).mOwner != cone.mOwner;
+			}));
+			break;
+		}
+	}
+
+	if (mSalvo.Count() > 0)
 	{
-		mGameObjects.pop_back();
+		const auto coneRadius = 0.5f;
+		const auto cubeRadius = mTerrainScale / 2;
+		{
+			//the impacts were reserved for the whole salvo when it was launched
+			const AllocationFreeScope allocationFree;
+			mSalvo.Step(static_cast<float>(pDt * mTimeScale));
+			mSalvo.Collide(mVoxelTerrain.Store(), TerrainGridTransform(), (coneRadius + cubeRadius) / mTerrainScale, -(mTerrainScale * mTerrainY) - 10, mSalvoImpacts);
+		}
+
+		//every crater from this step is carved before the terrain shapes are rebuilt once for all of them
+		const auto gridToWorld = XMLoadFloat4x4(mTerrain->Shapes()[0].Transform()) * XMLoadFloat4x4(mTerrain->Transform());
+		auto carved = 0;
+		for (const auto& impact : mSalvoImpacts)
+		{
+			mVoxelDebris.Break(mVoxelTerrain.Store(), impact, mSalvoRadius / mTerrainScale, mDebrisFraction, mDebrisSpeed, mDebrisLifetime);
+			carved += mVoxelTerrain.Carve(impact, mSalvoRadius / mTerrainScale);
+			XMFLOAT3 position{};
+			XMStoreFloat3(&position, XMVector3TransformCoord(XMLoadFloat3(&impact), gridToWorld));
+			//impacts share an emitter until it is full, then it is left to die down and another is taken
+			if (mFireEmitters.Room(mImpactEmitter) < mImpactParticleCount)
+			{
+				mFireEmitters.Release(mImpactEmitter);
+				mImpactEmitter = mFireEmitters.Spawn(mExplosionFire);
+			}
+			mFireEmitters.Emit(mImpactEmitter, position, XMFLOAT3(0, 2, 0), 2.0f, mSalvoRadius * 0.5f, 2.0f, 1.0f, mImpactParticleCount);
+		}
+		if (carved > 0)
+		{
+			UpdateTerrainShapes();
+		}
+		if (mSalvo.Count() == 0)
+		{
+			mFireEmitters.Release(mImpactEmitter);
+		}
 	}
 
+	StepParticles(static_cast<float>(pDt * mTimeScale));
+	StepDebris(static_cast<float>(pDt * mTimeScale));
 	DayNightCycle(pDt);
 }
 
+/// <summary>
+/// Emits smoke from the engine while it burns - from where the nozzle is at the end of this step, so the trail follows the path the rocket actually flew
+/// </summary>
+/// <param name="pDt"> the scaled length of the step </param>
+void Game::EmitEngineParticles(const float pDt)
+{
+	if (mRocketState.mMass <= mRocketFlight.Parameters().mDryMass)
+	{
+		return;
+	}
+	//the rate is carried between steps so a rate below one particle per step still emits
+	mEngineEmission += mEngineRate * pDt;
+	const auto count = static_cast<int>(mEngineEmission);
+	mEngineEmission -= count;
+
+	const auto exhaustSpeed = 2.0f;
+	const auto up = XMVectorSet(-sinf(mRocketState.mPitch), cosf(mRocketState.mPitch), 0, 0);
+	XMFLOAT3 nozzle{};
+	XMFLOAT3 velocity{};
+	XMStoreFloat3(&nozzle, XMLoadFloat3(&mRocketState.mPosition) - up * 3);
+	XMStoreFloat3(&velocity, XMLoadFloat3(&mRocketState.mVelocity) - up * exhaustSpeed);
+	mSmokeEmitters.Emit(mEngineEmitter, nozzle, velocity, 0.3f, 0.1f, 3.0f, 0.4f, count);
+}
+
+/// <summary>
+/// Moves every particle on by one step of the simulation, after this step's particles have been emitted
+/// </summary>
+/// <param name="pDt"> the scaled length of the step </param>
+void Game::StepParticles(const float pDt)
+{
+	const auto start = chrono::high_resolution_clock::now();
+	const AllocationFreeScope allocationFree;
+	mSmokeEmitters.Update(pDt, mWind, mWorkers);
+	mFireEmitters.Update(pDt, mWind, mWorkers);
+	mParticleTime += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+/// <summary>
+/// Hands the survivors of the frame's steps to their shapes to be drawn, so they are sorted and uploaded once however many steps ran
+/// </summary>
+void Game::UpdateParticles()
+{
+	const auto start = chrono::high_resolution_clock::now();
+	SetEmitterShapes(mSmokeEmitters, 0);
+	SetEmitterShapes(mFireEmitters, mSmokeEmitters.Slots());
+
+	mLiveParticles = mSmokeEmitters.Count() + mFireEmitters.Count();
+	mLiveEmitters = mSmokeEmitters.ActiveEmitters() + mFireEmitters.ActiveEmitters();
+	mParticleTime += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+/// <summary>
+/// Hands the particles of each emitter slot to the shape which draws it, slots which were empty and still are are skipped
+/// </summary>
+/// <param name="pEmitters"> the emitters to draw </param>
+/// <param name="pFirstShape"> the shape of the first slot, the shapes of the other slots follow it </param>
+void Game::SetEmitterShapes(const ParticleEmitters& pEmitters, const int pFirstShape)
+{
+	for (auto slot = 0; slot < pEmitters.Slots(); ++slot)
+	{
+		if (pEmitters.Count(slot) == 0 && mParticles->Shapes()[pFirstShape + slot].InstanceCount() == 0)
+		{
+			continue;
+		}
+		{
+			const AllocationFreeScope allocationFree;
+			pEmitters.Instances(slot, mParticleInstances, mWorkers);
+		}
+		mParticleSorter.Sort(mParticleInstances, mActiveCamera->Eye(), mActiveCamera->Forward(), mWorkers);
+		mParticles->SetShapeParticles(pFirstShape + slot, mParticleInstances);
+	}
+}
+
+/// <summary>
+/// Steps the crater debris against the terrain by one step of the simulation, after this step's craters have been carved
+/// </summary>
+/// <param name="pDt"> the time step, already scaled by the time scale </param>
+void Game::StepDebris(const float pDt)
+{
+	const auto start = chrono::high_resolution_clock::now();
+	const AllocationFreeScope allocationFree;
+	//the debris move in cells, so gravity is scaled down to the size of a cell
+	mVoxelDebris.Update(pDt, 9.81f / mTerrainScale, mVoxelTerrain.Store());
+	mDebrisTime += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
+/// <summary>
+/// Hands the living pieces to the debris shape once per frame, nothing is uploaded while there are none
+/// </summary>
+void Game::UpdateDebris()
+{
+	const auto start = chrono::high_resolution_clock::now();
+	if (mVoxelDebris.Count() > 0 || mDebris->Shapes()[0].InstanceCount() > 0)
+	{
+		{
+			const AllocationFreeScope allocationFree;
+			mVoxelDebris.Instances(mDebrisInstances);
+		}
+		mDebris->SetShapeInstances(0, mDebrisInstances);
+	}
+	mLiveDebris = static_cast<int>(mDebrisInstances.size());
+	mDebrisTime += chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+}
+
 /// <summary>
 /// Gets the list of gameobjects in the game for the renderer
 /// </summary>
@@ -503,14 +1079,21 @@ const float Game::ScaledTime() const
 }
 
 /// <summary>
-/// Reset the rocket to its starting position and prepare for another launch
+/// Reset the rocket to its starting position and prepare for another launch - the rocket jumps there rather than being blended back
 /// </summary>
 void Game::ResetRocket()
 {
 	mLaunch = false;
+	mHasPreviousCone = false;
+	//the trail is left to drift away, its slot is reused once the last of it has gone
+	mSmokeEmitters.Release(mEngineEmitter);
 	mRocket->ResetObject();
 	mRocket->Translate(XMFLOAT4(-(mTerrainScale*mTerrainX) * 4 / 10, 3, 0, 1));
 	mLauncher->SetShapeRotation(1, XMFLOAT4(0, 0, 0, 1));
+	mCurrentState.mRocketTranslation = mRocket->Position();
+	mCurrentState.mRocketRotation = mRocket->Rotation();
+	mPreviousState.mRocketTranslation = mCurrentState.mRocketTranslation;
+	mPreviousState.mRocketRotation = mCurrentState.mRocketRotation;
 }
 
 /// <summary>
@@ -575,15 +1158,13 @@ void Game::InitialiseCameras()
 }
 
 /// <summary>
-/// Orbit the lights to create a day + night cycle
+/// Advance the orbit of the lights to create a day + night cycle
 /// </summary>
 /// <param name="pDt">delta time used to move the lights </param>
 void Game::DayNightCycle(const float pDt)
 {
-	//Sun
-	mLights[0].Orbit(XMFLOAT4(0, 0, -0.05f * mTimeScale * pDt, 1));
-	//Moon
-	mLights[1].Orbit(XMFLOAT4(0, 0, -0.05f * mTimeScale * pDt, 1));
+	//the sun and moon share an orbit, they are moved to it when the scene is drawn
+	mCurrentState.mDayAngle -= 0.05f * mTimeScale * pDt;
 }
 
 /// <summary>
@@ -592,21 +1173,30 @@ void Game::DayNightCycle(const float pDt)
 void Game::ResetGame()
 {
 	ResetRocket();
+	mSalvo.Clear();
+	mSmokeEmitters.Clear();
+	mFireEmitters.Clear();
+	mVoxelDebris.Clear();
+	mEngineEmitter = EmitterHandle{};
+	mImpactEmitter = EmitterHandle{};
+	mEngineEmission = 0;
 
-	vector<Instance> instances;
-	for (auto x = 0; x < mTerrainX; ++x)
+	//the terrain is only built again when its settings have changed, otherwise the craters are undone from the pristine copy
+	const auto start = chrono::high_resolution_clock::now();
+	if (mTerrainSeed != mBuiltSeed || mTerrainCaves != mBuiltCaves || mTerrainStorage != mBuiltStorage)
 	{
-		for (auto y = 0; y < mTerrainY; ++y)
-		{
-			for (auto z = 0; z < mTerrainZ; ++z)
-			{
-				instances.emplace_back(Instance{ XMFLOAT3(x,y,z) });
-			}
-		}
+		GenerateTerrain();
+	}
+	else
+	{
+		mVoxelTerrain.Reset();
 	}
-	mTerrain->SetShapeInstances(0, instances);
+	UpdateTerrainShapes();
+	mResetTime = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
 	mLights.clear();
 	InitialiseLights();
+	mCurrentState.mDayAngle = 0;
+	mPreviousState.mDayAngle = 0;
 	mCameras.clear();
 	InitialiseCameras();
 	mTimeScale = 5.0f;
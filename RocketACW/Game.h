@@ -1,13 +1,27 @@
 #pragma once
 #include <vector>
+#include <thread>
+#include <atomic>
 #include "GameObject.h"
 #include "Light.h"
 #include "Camera.h"
 #include <Keyboard.h>
 #include "AntTweakManager.h"
+#include "VoxelTerrain.h"
+#include "GreedyMesher.h"
+#include "TerrainGenerator.h"
+#include "SimulationState.h"
+#include "RocketFlight.h"
+#include "Salvo.h"
+#include "ImpactPredictor.h"
+#include "ParticleEmitters.h"
+#include "WorkerPool.h"
+#include "ParticleSorter.h"
+#include "VoxelDebris.h"
 
 class Game
 {
+	SpatialHash mBroadphase;	//declared before the gameobjects so it outlives them, they unregister from it as they are destroyed
 	std::vector<GameObject> mGameObjects;
 	std::vector<Light> mLights;
 	std::vector<Camera> mCameras;
@@ -25,25 +39,117 @@ class Game
 	GameObject* mTerrain = nullptr;
 	GameObject* mSun = nullptr;
 	GameObject* mMoon = nullptr;
+	GameObject* mSalvoObject = nullptr;
+	GameObject* mImpactMarker = nullptr;
+	GameObject* mParticles = nullptr;
+	GameObject* mDebris = nullptr;
+	std::vector<int> mBroadphaseHits;
+	int mBroadphaseBoxes = 0;
+	int mConeOverlaps = 0;
+	VoxelTerrain mVoxelTerrain;
+	TerrainGenerator mTerrainGenerator;
+	std::thread mBenchmark;	//the terrain benchmark runs on a thread of its own so the window keeps responding
+	std::atomic<bool> mBenchmarking{ false };
+	int mTerrainSeed = 1;
+	int mTerrainCaves = 0;
+	int mTerrainStorage = 0;
+	int mTerrainMemory = 0;
+	float mGenerationTime = 0;
+	float mResetTime = 0;
+	int mBuiltSeed = 0;
+	int mBuiltCaves = 0;
+	int mBuiltStorage = 0;
+	GreedyMesher mMesher;
+	bool mGreedyTerrain = false;
 	float mTerrainScale = 1;
 	int mTerrainX = 120;
 	int mTerrainY = 40;
 	int mTerrainZ = 40;
 	int mCubeCount = 0;
+	int mVisibleCubeCount = 0;
+	int mTerrainTriangles = 0;
 	float mWidth;
 	float mHeight;
 	float mTime = 0;
 	float mAverageDt = 0;
 	std::vector<float> mDeltaTimeSamples;
 	float mFrameRate = 0;
-	float mRocketSpeed = 2;
+	RocketFlight mRocketFlight;
+	RocketState mRocketState{};
+	Salvo mSalvo;
+	std::vector<PitchedInstance> mSalvoInstances;
+	std::vector<DirectX::XMFLOAT3> mSalvoImpacts;
+	int mSalvoSize = 500;
+	int mSalvoCount = 0;
+	float mSalvoRadius = 2.0f;
+	ImpactPredictor mPredictor;
+	std::vector<Instance> mMarkerRing;
+	std::vector<Instance> mMarkerInstances;
+	std::vector<TerrainRay> mMarkerRays;
+	std::vector<RayHit> mMarkerHits;
+	float mMarkerScale = 0.5f;
+	std::vector<Instance> mNoInstances;
+	DirectX::XMFLOAT3 mPredictedImpact{};
+	int mPredictedCrater = 0;
+	float mPredictionTime = 0;
+	float mPredictionBudget = 0.5f;
+	float mRocketAltitude = 0;
 	float mExplosionRadius = 7.0f;
-	float mParticleTimer = 0.0f;
+	WorkerPool mWorkers;
+	ParticleSorter mParticleSorter{ 32768, mWorkers.Threads() };
+	ParticleEmitters mSmokeEmitters{ 4, 32768 };
+	ParticleEmitters mFireEmitters{ 16, 16384 };
+	EmitterHandle mEngineEmitter;
+	EmitterHandle mImpactEmitter;
+	ParticleParameters mEngineSmoke{ DirectX::XMFLOAT3(0, 0.4f, 0), DirectX::XMFLOAT3(0, 0, 0), 0.8f, 0, 0.2f, 0.6f };
+	ParticleParameters mExplosionFire{ DirectX::XMFLOAT3(0, -1.5f, 0), DirectX::XMFLOAT3(0, 0, 0), 0.6f, 0, 0.3f, 0.3f };
+	std::vector<ParticleInstance> mParticleInstances;
+	DirectX::XMFLOAT3 mWind{ 1, 0, 0 };
+	float mEngineRate = 1500;
+	float mEngineEmission = 0;
+	int mExplosionParticleCount = 12000;
+	int mImpactParticleCount = 200;
+	int mLiveParticles = 0;
+	int mLiveEmitters = 0;
+	float mParticleTime = 0;
+	VoxelDebris mVoxelDebris{ 4096, 0.5f };
+	std::vector<Instance> mDebrisInstances;
+	float mDebrisFraction = 0.25f;
+	float mDebrisSpeed = 6.0f;
+	float mDebrisLifetime = 3.0f;
+	int mLiveDebris = 0;
+	float mDebrisTime = 0;
+	int mSimulationRate = 120;
+	int mMaxSimulationSteps = 8;
+	int mSimulationSteps = 0;
+	double mAccumulator = 0;
+	SimulationState mPreviousState{};
+	SimulationState mCurrentState{};
+	DirectX::XMFLOAT4 mPreviousCone{};
+	bool mHasPreviousCone = false;
+	size_t mAllocations = 0;
+	int mFrameAllocations = 0;
 
 	void CreateScene();
 	void HandleInput(const double& pDt);
+	void Simulate(const double& pDt);
+	void PredictImpact(const float pDt);
+	void DrapeMarker(const DirectX::XMFLOAT3& pImpact);
 	void CheckCollision(const Shape& pShape);
+	DirectX::XMFLOAT4X4 TerrainGridTransform() const;
+	DirectX::XMFLOAT3 TerrainGridPosition(const DirectX::XMFLOAT4& pWorldPosition) const;
+	void GenerateTerrain();
+	HRESULT LoadTerrain(const bool pKeepGrid);
+	HRESULT SaveTerrain() const;
+	void BuildTerrainShapes();
+	void UpdateTerrainShapes();
 	void Explosion(const DirectX::XMFLOAT4X4& pTransform); 
+	void EmitEngineParticles(const float pDt);
+	void StepParticles(const float pDt);
+	void UpdateParticles();
+	void SetEmitterShapes(const ParticleEmitters& pEmitters, const int pFirstShape);
+	void StepDebris(const float pDt);
+	void UpdateDebris();
 	void ResetRocket();
 	void InitialiseLights();
 	void InitialiseCameras();
@@ -52,7 +158,7 @@ class Game
 
 public:
 	Game(const float pWidth, const float pHeight, AntTweakManager& pAwManager);
-	~Game() = default;
+	~Game();
 
 	Game& operator=(const Game& pGame) = delete;
 	Game(const Game& pGame) = delete;
@@ -1,4 +1,5 @@
 #include "GameObject.h"
+#include <utility>
 
 using namespace DirectX;
 using namespace std;
@@ -12,9 +13,50 @@ GameObject::GameObject(const XMFLOAT4& pScale, const XMFLOAT4&pRotation, const X
 }
 
 /// <summary>
-/// destructor for the gameobject
+/// destructor for the gameobject, its shapes are taken out of the broadphase so no box outlives the object it belongs to
 /// </summary>
-GameObject::~GameObject() = default;
+GameObject::~GameObject()
+{
+	Unregister();
+}
+
+/// <summary>
+/// Move constructor, the boxes in the broadphase now belong to this object and the moved from object is left unregistered
+/// </summary>
+/// <param name="pGameObject"> the gameobject to move from </param>
+GameObject::GameObject(GameObject&& pGameObject) noexcept : mTransform(pGameObject.mTransform), mScale(pGameObject.mScale), mRotation(pGameObject.mRotation),
+	mTranslation(pGameObject.mTranslation), mShapes(move(pGameObject.mShapes)), mForward(pGameObject.mForward), mUp(pGameObject.mUp), mRight(pGameObject.mRight),
+	mPosition(pGameObject.mPosition), mBroadphase(exchange(pGameObject.mBroadphase, nullptr)), mOwner(exchange(pGameObject.mOwner, -1)), mProxies(move(pGameObject.mProxies))
+{
+	pGameObject.mProxies.clear();
+}
+
+/// <summary>
+/// Move assignment, the boxes this object held are removed first and the boxes of the other object are taken over
+/// </summary>
+/// <param name="pGameObject"> the gameobject to move from </param>
+/// <returns> this gameobject </returns>
+GameObject& GameObject::operator=(GameObject&& pGameObject) noexcept
+{
+	if (this != &pGameObject)
+	{
+		Unregister();
+		mTransform = pGameObject.mTransform;
+		mScale = pGameObject.mScale;
+		mRotation = pGameObject.mRotation;
+		mTranslation = pGameObject.mTranslation;
+		mShapes = move(pGameObject.mShapes);
+		mForward = pGameObject.mForward;
+		mUp = pGameObject.mUp;
+		mRight = pGameObject.mRight;
+		mPosition = pGameObject.mPosition;
+		mBroadphase = exchange(pGameObject.mBroadphase, nullptr);
+		mOwner = exchange(pGameObject.mOwner, -1);
+		mProxies = move(pGameObject.mProxies);
+		pGameObject.mProxies.clear();
+	}
+	return *this;
+}
 
 /// <summary>
 /// Translate the gameobject by the given translation
@@ -36,6 +78,16 @@ void GameObject::SetTranslation(const DirectX::XMFLOAT4 & pTranslation)
 	SetTransform();
 }
 
+/// <summary>
+/// Sets the rotation of the gameobject
+/// </summary>
+/// <param name="pRotation"> the rotation to give the gameobject on each axis </param>
+void GameObject::SetRotation(const DirectX::XMFLOAT4 & pRotation)
+{
+	XMStoreFloat4(&mRotation, XMLoadFloat4(&pRotation));
+	SetTransform();
+}
+
 /// <summary>
 /// Accessor for the rotation of the gameobject
 /// </summary>
@@ -99,6 +151,7 @@ const std::vector<Shape> & GameObject::Shapes() const
 /// <param name="pGeometryType"> The type of geometry which the shape uses </param>
 /// <param name="pEnvironment"> The flag to show if this is a skybox </param>
 /// <param name="pBlended"> The flag to show if this shape should be alpha blended </param>
+/// <param name="pInstanceFormat"> How the instances are stored and sent to the GPU </param>
 void GameObject::AddShape(const vector<Instance> * const pInstances,
 	const XMFLOAT4& pScale,
 	const XMFLOAT4& pRotation,
@@ -110,9 +163,14 @@ void GameObject::AddShape(const vector<Instance> * const pInstances,
 	const string& pName,
 	const bool& pEnvironment,
 	const bool& pBlended,
-	const GeometryType& pGeometryType )
+	const GeometryType& pGeometryType,
+	const InstanceFormat& pInstanceFormat)
 {
-	mShapes.emplace_back(pInstances, pScale, pRotation, pTranslation, pDiffuseTex, pNormalMap, pHeightMap, pShader, pName, pEnvironment, pBlended, pGeometryType);
+	mShapes.emplace_back(pInstances, pScale, pRotation, pTranslation, pDiffuseTex, pNormalMap, pHeightMap, pShader, pName, pEnvironment, pBlended, pGeometryType, pInstanceFormat);
+	if (mBroadphase)
+	{
+		mProxies.push_back(AddProxy(static_cast<int>(mShapes.size()) - 1));
+	}
 }
 
 /// <summary>
@@ -170,6 +228,7 @@ void GameObject::ResetObject()
 void GameObject::RotateShape(const int & pIndex, const DirectX::XMFLOAT4 & pRotation)
 {
 	mShapes[pIndex].Rotate(pRotation);
+	UpdateBounds(pIndex);
 }
 
 /// <summary>
@@ -180,6 +239,7 @@ void GameObject::RotateShape(const int & pIndex, const DirectX::XMFLOAT4 & pRota
 void GameObject::SetShapeRotation(const int & pIndex, const DirectX::XMFLOAT4 & pRotation)
 {
 	mShapes[pIndex].SetRotation(pRotation);
+	UpdateBounds(pIndex);
 }
 
 /// <summary>
@@ -187,9 +247,23 @@ void GameObject::SetShapeRotation(const int & pIndex, const DirectX::XMFLOAT4 &
 /// </summary>
 /// <param name="pIndex"> the index of the shape to remove instances of </param>
 /// <param name="pInstances"> the list of instances to remove </param>
-void GameObject::RemoveInstancesFromShape(const int & pIndex, const std::vector<Instance>& pInstances)
+/// <param name="pMode"> whether the order of the remaining instances must be kept </param>
+void GameObject::RemoveInstancesFromShape(const int & pIndex, const std::vector<Instance>& pInstances, const RemovalMode pMode)
 {
-	mShapes[pIndex].RemoveInstances(pInstances);
+	mShapes[pIndex].RemoveInstances(pInstances, pMode);
+	UpdateBounds(pIndex);
+}
+
+/// <summary>
+/// Remove instances from the given shape by their grid keys
+/// </summary>
+/// <param name="pIndex"> the index of the shape to remove instances of </param>
+/// <param name="pKeys"> the keys of the instances to remove </param>
+/// <param name="pMode"> whether the order of the remaining instances must be kept </param>
+void GameObject::RemoveInstancesFromShape(const int & pIndex, const std::vector<uint64_t>& pKeys, const RemovalMode pMode)
+{
+	mShapes[pIndex].RemoveInstances(pKeys, pMode);
+	UpdateBounds(pIndex);
 }
 
 /// <summary>
@@ -200,6 +274,184 @@ void GameObject::RemoveInstancesFromShape(const int & pIndex, const std::vector<
 void GameObject::SetShapeInstances(const int & pIndex, const std::vector<Instance>& pInstances)
 {
 	mShapes[pIndex].SetInstances(pInstances);
+	UpdateBounds(pIndex);
+}
+
+/// <summary>
+/// Set the particles of a given PARTICLE shape
+/// </summary>
+/// <param name="pIndex"> the index of the shape which will have its particles set </param>
+/// <param name="pInstances"> the particles to set in the given shape </param>
+void GameObject::SetShapeParticles(const int & pIndex, const std::vector<ParticleInstance>& pInstances)
+{
+	mShapes[pIndex].SetParticleInstances(pInstances);
+	UpdateBounds(pIndex);
+}
+
+/// <summary>
+/// Set the instances of a given PITCHED shape
+/// </summary>
+/// <param name="pIndex"> the index of the shape which will have its instances set </param>
+/// <param name="pInstances"> the instances to set in the given shape </param>
+void GameObject::SetShapePitchedInstances(const int & pIndex, const std::vector<PitchedInstance>& pInstances)
+{
+	mShapes[pIndex].SetPitchedInstances(pInstances);
+	UpdateBounds(pIndex);
+}
+
+/// <summary>
+/// Set the vertices and indices of a given MESH shape
+/// </summary>
+/// <param name="pIndex"> the index of the shape which will have its mesh set </param>
+/// <param name="pVertices"> the vertices to set in the given shape </param>
+/// <param name="pIndices"> the indices to set in the given shape </param>
+void GameObject::SetShapeMesh(const int & pIndex, const std::vector<SimpleVertex>& pVertices, const std::vector<WORD>& pIndices)
+{
+	mShapes[pIndex].SetMesh(pVertices, pIndices);
+	UpdateBounds(pIndex);
+}
+
+/// <summary>
+/// Removes every shape from the gameobject
+/// </summary>
+void GameObject::ClearShapes()
+{
+	if (mBroadphase)
+	{
+		for (const auto proxy : mProxies)
+		{
+			if (proxy >= 0)
+			{
+				mBroadphase->Remove(proxy);
+			}
+		}
+	}
+	mProxies.clear();
+	mShapes.clear();
+}
+
+/// <summary>
+/// Adds the shapes of the gameobject to a broadphase, from then on moving the gameobject or changing a shape moves its boxes
+/// Environment maps and blended particles are not indexed, they are placed by their shaders so their boxes mean nothing
+/// </summary>
+/// <param name="pBroadphase"> the broadphase to add the shapes to, it must outlive the registration </param>
+/// <param name="pOwner"> the owner recorded in the broadphase for every shape, e.g. the index of the gameobject </param>
+void GameObject::Register(SpatialHash& pBroadphase, const int pOwner)
+{
+	Unregister();
+	mBroadphase = &pBroadphase;
+	mOwner = pOwner;
+	for (auto i = 0; i < static_cast<int>(mShapes.size()); ++i)
+	{
+		mProxies.push_back(AddProxy(i));
+	}
+}
+
+/// <summary>
+/// Removes the shapes of the gameobject from its broadphase
+/// </summary>
+void GameObject::Unregister()
+{
+	if (!mBroadphase)
+	{
+		return;
+	}
+	for (const auto proxy : mProxies)
+	{
+		if (proxy >= 0)
+		{
+			mBroadphase->Remove(proxy);
+		}
+	}
+	mProxies.clear();
+	mBroadphase = nullptr;
+	mOwner = -1;
+}
+
+/// <summary>
+/// Adds a shape to the broadphase if it is indexed
+/// </summary>
+/// <param name="pIndex"> the index of the shape </param>
+/// <returns> the proxy of the shape, or -1 if it is not indexed </returns>
+int GameObject::AddProxy(const int pIndex)
+{
+	const auto& shape = mShapes[pIndex];
+	if (shape.IsEnvironment() || shape.IsBlended())
+	{
+		return -1;
+	}
+	XMFLOAT3 boundsMin{};
+	XMFLOAT3 boundsMax{};
+	ShapeBounds(pIndex, boundsMin, boundsMax);
+	return mBroadphase->Insert(boundsMin, boundsMax, mOwner, pIndex);
+}
+
+/// <summary>
+/// Moves the box of a shape in the broadphase after the shape or the gameobject has changed
+/// </summary>
+/// <param name="pIndex"> the index of the shape </param>
+void GameObject::UpdateBounds(const int pIndex)
+{
+	if (!mBroadphase || mProxies[pIndex] < 0)
+	{
+		return;
+	}
+	XMFLOAT3 boundsMin{};
+	XMFLOAT3 boundsMax{};
+	ShapeBounds(pIndex, boundsMin, boundsMax);
+	mBroadphase->Update(mProxies[pIndex], boundsMin, boundsMax);
+}
+
+/// <summary>
+/// Moves the boxes of every shape in the broadphase after the gameobject has moved
+/// </summary>
+void GameObject::UpdateBounds()
+{
+	if (!mBroadphase)
+	{
+		return;
+	}
+	for (auto i = 0; i < static_cast<int>(mShapes.size()); ++i)
+	{
+		UpdateBounds(i);
+	}
+}
+
+/// <summary>
+/// Finds the world space box around a shape - its box is moved by the shape and gameobject transforms and the result boxed again
+/// </summary>
+/// <param name="pIndex"> the index of the shape </param>
+/// <param name="pMin"> the minimum corner of the world box, above the maximum if the shape is empty </param>
+/// <param name="pMax"> the maximum corner of the world box </param>
+void GameObject::ShapeBounds(const int pIndex, XMFLOAT3& pMin, XMFLOAT3& pMax) const
+{
+	const auto& shape = mShapes[pIndex];
+	pMin = shape.BoundsMin();
+	pMax = shape.BoundsMax();
+	if (pMin.x > pMax.x)
+	{
+		return;
+	}
+
+	const auto transform = XMLoadFloat4x4(shape.Transform()) * XMLoadFloat4x4(&mTransform);
+	const auto centre = (XMLoadFloat3(&pMin) + XMLoadFloat3(&pMax)) * 0.5f;
+	const auto extent = (XMLoadFloat3(&pMax) - XMLoadFloat3(&pMin)) * 0.5f;
+	const auto worldCentre = XMVector3TransformCoord(centre, transform);
+	const auto worldExtent = XMVectorAbs(transform.r[0]) * XMVectorSplatX(extent) +
+		XMVectorAbs(transform.r[1]) * XMVectorSplatY(extent) +
+		XMVectorAbs(transform.r[2]) * XMVectorSplatZ(extent);
+	XMStoreFloat3(&pMin, worldCentre - worldExtent);
+	XMStoreFloat3(&pMax, worldCentre + worldExtent);
+}
+
+/// <summary>
+/// Gets the broadphase proxy of a shape
+/// </summary>
+/// <param name="pIndex"> the index of the shape </param>
+/// <returns> the proxy, or -1 if the shape is not indexed or the gameobject is not registered </returns>
+const int GameObject::ShapeProxy(const int pIndex) const
+{
+	return pIndex < static_cast<int>(mProxies.size()) ? mProxies[pIndex] : -1;
 }
 
 /// <summary>
@@ -226,6 +478,8 @@ void GameObject::SetTransform()
 	XMStoreFloat4(&mForward, XMVector4Normalize(XMLoadFloat4(&forward)));
 	//Position
 	mPosition = XMFLOAT4(mTransform._41, mTransform._42, mTransform._43, 1);
+
+	UpdateBounds();
 }
 
 
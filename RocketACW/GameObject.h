@@ -1,5 +1,6 @@
 #pragma once
 #include "Shape.h"
+#include "SpatialHash.h"
 
 class GameObject
 {
@@ -12,17 +13,31 @@ class GameObject
 	DirectX::XMFLOAT4 mUp{};
 	DirectX::XMFLOAT4 mRight{};
 	DirectX::XMFLOAT4 mPosition{};
+	SpatialHash* mBroadphase = nullptr;
+	int mOwner = -1;
+	std::vector<int> mProxies;	//one per shape, -1 for shapes which are not indexed
 
 	void SetTransform();
+	int AddProxy(const int pIndex);
+	void UpdateBounds(const int pIndex);
+	void UpdateBounds();
 
 public:
 	GameObject(const DirectX::XMFLOAT4& pScale, const DirectX::XMFLOAT4&pRotation, const DirectX::XMFLOAT4& pTranslation);
 	~GameObject();
 
+	//a gameobject owns its shapes and its boxes in the broadphase, so it is moved into the scene rather than copied
+	//the boxes move with it and the object left behind is unregistered, so destroying it cannot remove them
+	GameObject& operator=(const GameObject& pGameObject) = delete;
+	GameObject(const GameObject& pGameObject) = delete;
+	GameObject& operator=(GameObject&& pGameObject) noexcept;
+	GameObject(GameObject&& pGameObject) noexcept;
+
 	void Scale(const DirectX::XMFLOAT4& pScale);
 	void Rotate(const DirectX::XMFLOAT4& pRotation);
 	void Translate(const DirectX::XMFLOAT4& pTranslation);
 	void SetTranslation(const DirectX::XMFLOAT4& pTranslation);
+	void SetRotation(const DirectX::XMFLOAT4& pRotation);
 
 	const DirectX::XMFLOAT4& Rotation() const;
 
@@ -41,7 +56,8 @@ public:
 		const std::string& pName,
 		const bool& pEnvironment,
 		const bool& pBlended,
-		const GeometryType& pGeometryType);
+		const GeometryType& pGeometryType,
+		const InstanceFormat& pInstanceFormat = InstanceFormat::FLOAT3);
 	const DirectX::XMFLOAT4X4 * const Transform() const;
 	const DirectX::XMFLOAT4& Forward() const;
 	const DirectX::XMFLOAT4& Up() const;
@@ -50,7 +66,24 @@ public:
 
 	void RotateShape(const int& pIndex, const DirectX::XMFLOAT4 & pRotation);
 	void SetShapeRotation(const int& pIndex, const DirectX::XMFLOAT4 & pRotation);
-	void RemoveInstancesFromShape(const int& pIndex, const std::vector<Instance> & pInstances);
+	void RemoveInstancesFromShape(const int& pIndex, const std::vector<Instance> & pInstances, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER);
+	void RemoveInstancesFromShape(const int& pIndex, const std::vector<uint64_t> & pKeys, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER);
+
+	template <typename Predicate>
+	void RemoveInstancesFromShapeIf(const int& pIndex, Predicate pPredicate, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER)
+	{
+		mShapes[pIndex].RemoveInstancesIf(pPredicate, pMode);
+		UpdateBounds(pIndex);
+	}
 	void SetShapeInstances(const int& pIndex, const std::vector<Instance> & pInstances);
+	void SetShapeParticles(const int& pIndex, const std::vector<ParticleInstance> & pInstances);
+	void SetShapePitchedInstances(const int& pIndex, const std::vector<PitchedInstance> & pInstances);
+	void SetShapeMesh(const int& pIndex, const std::vector<SimpleVertex> & pVertices, const std::vector<WORD> & pIndices);
+	void ClearShapes();
+
+	void Register(SpatialHash& pBroadphase, const int pOwner);
+	void Unregister();
+	void ShapeBounds(const int pIndex, DirectX::XMFLOAT3& pMin, DirectX::XMFLOAT3& pMax) const;
+	const int ShapeProxy(const int pIndex) const;
 };
 
@@ -4,5 +4,6 @@ enum class GeometryType
 	CUBE,
 	CYLINDER,
 	CONE,
-	QUAD
+	QUAD,
+	MESH	//vertices and indices are supplied by the owner with SetMesh
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "GreedyMesher.h"
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Appends a quad lying on the plane perpendicular to the axis, with tangents along the quads texture axes
+/// </summary>
+/// <param name="pAxis"> the axis the face points along (0 = x, 1 = y, 2 = z) </param>
+/// <param name="pSign"> +1 if the face points along the positive axis, -1 otherwise </param>
+/// <param name="pPlane"> the position of the face on its axis </param>
+/// <param name="pU0"> the lower corner on the first in-plane axis </param>
+/// <param name="pV0"> the lower corner on the second in-plane axis </param>
+/// <param name="pU1"> the upper corner on the first in-plane axis </param>
+/// <param name="pV1"> the upper corner on the second in-plane axis </param>
+/// <param name="pVertices"> the vertex list to append to </param>
+/// <param name="pIndices"> the index list to append to </param>
+void GreedyMesher::AddQuad(const int pAxis, const int pSign, const float pPlane, const float pU0, const float pV0, const float pU1, const float pV1,
+	vector<SimpleVertex>& pVertices, vector<WORD>& pIndices) const
+{
+	const auto u = (pAxis + 1) % 3;
+	const auto v = (pAxis + 2) % 3;
+
+	float normal[3] = { 0, 0, 0 };
+	float tangent[3] = { 0, 0, 0 };
+	float binormal[3] = { 0, 0, 0 };
+	normal[pAxis] = static_cast<float>(pSign);
+	//flip the tangent on negative faces so that tangent x binormal always equals the normal
+	tangent[u] = static_cast<float>(pSign);
+	binormal[v] = 1.0f;
+
+	const float corners[4][2] = { { pU0, pV0 }, { pU1, pV0 }, { pU1, pV1 }, { pU0, pV1 } };
+	const auto first = static_cast<WORD>(pVertices.size());
+	for (const auto& corner : corners)
+	{
+		float position[3]{};
+		position[pAxis] = pPlane;
+		position[u] = corner[0];
+		position[v] = corner[1];
+		//texture coordinates are in cube units so the wrapped texture tiles once per cube, as it does on the instanced cubes
+		pVertices.emplace_back(SimpleVertex{ XMFLOAT3(position[0], position[1], position[2]),
+			XMFLOAT3(normal[0], normal[1], normal[2]),
+			XMFLOAT3(tangent[0], tangent[1], tangent[2]),
+			XMFLOAT3(binormal[0], binormal[1], binormal[2]),
+			XMFLOAT2(pSign * corner[0], corner[1]) });
+	}
+
+	//wind the triangles so that the face is front facing when viewed from the side the normal points to
+	if (pSign > 0)
+	{
+		const WORD indices[6] = { 0, 1, 2, 0, 2, 3 };
+		for (const auto index : indices)
+		{
+			pIndices.push_back(first + index);
+		}
+	}
+	else
+	{
+		const WORD indices[6] = { 0, 2, 1, 0, 3, 2 };
+		for (const auto index : indices)
+		{
+			pIndices.push_back(first + index);
+		}
+	}
+}
+
+/// <summary>
+/// Builds the mesh for the cells between pMin and pMax (inclusive), faces against solid cells in neighbouring chunks are skipped
+/// </summary>
+/// <param name="pGrid"> the occupancy store to mesh </param>
+/// <param name="pMin"> the lowest cell of the chunk </param>
+/// <param name="pMax"> the highest cell of the chunk </param>
+/// <param name="pVertices"> receives the vertices of the mesh, in grid space </param>
+/// <param name="pIndices"> receives the indices of the mesh </param>
+void GreedyMesher::BuildChunk(const VoxelStore& pGrid, const XMINT3& pMin, const XMINT3& pMax, vector<SimpleVertex>& pVertices, vector<WORD>& pIndices)
+{
+	pVertices.clear();
+	pIndices.clear();
+
+	const int min[3] = { pMin.x, pMin.y, pMin.z };
+	const int size[3] = { pMax.x - pMin.x + 1, pMax.y - pMin.y + 1, pMax.z - pMin.z + 1 };
+
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto u = (axis + 1) % 3;
+		const auto v = (axis + 2) % 3;
+		mMask.assign(size[u] * size[v], false);
+
+		for (auto sign = -1; sign <= 1; sign += 2)
+		{
+			for (auto slice = 0; slice < size[axis]; ++slice)
+			{
+				//mark every cell in the slice with an uncovered face in this direction
+				int cell[3]{};
+				cell[axis] = min[axis] + slice;
+				for (auto j = 0; j < size[v]; ++j)
+				{
+					for (auto i = 0; i < size[u]; ++i)
+					{
+						cell[u] = min[u] + i;
+						cell[v] = min[v] + j;
+						int neighbour[3] = { cell[0], cell[1], cell[2] };
+						neighbour[axis] += sign;
+						mMask[i + j * size[u]] = pGrid.IsSolid(cell[0], cell[1], cell[2]) && !pGrid.IsSolid(neighbour[0], neighbour[1], neighbour[2]);
+					}
+				}
+
+				//merge the marked faces into rectangles, widest first then as tall as the width allows
+				const auto plane = cell[axis] + sign * 0.5f;
+				for (auto j = 0; j < size[v]; ++j)
+				{
+					for (auto i = 0; i < size[u];)
+					{
+						if (!mMask[i + j * size[u]])
+						{
+							++i;
+							continue;
+						}
+						auto width = 1;
+						while (i + width < size[u] && mMask[i + width + j * size[u]])
+						{
+							++width;
+						}
+						auto height = 1;
+						auto rowFilled = true;
+						while (j + height < size[v] && rowFilled)
+						{
+							for (auto k = 0; k < width; ++k)
+							{
+								if (!mMask[i + k + (j + height) * size[u]])
+								{
+									rowFilled = false;
+									break;
+								}
+							}
+							if (rowFilled)
+							{
+								++height;
+							}
+						}
+						for (auto h = 0; h < height; ++h)
+						{
+							fill_n(mMask.begin() + i + (j + h) * size[u], width, false);
+						}
+
+						AddQuad(axis, sign, plane,
+							min[u] + i - 0.5f, min[v] + j - 0.5f,
+							min[u] + i + width - 0.5f, min[v] + j + height - 0.5f,
+							pVertices, pIndices);
+						i += width;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include "windows.h"
+#include "SimpleVertex.h"
+#include "VoxelStore.h"
+
+//Builds merged-face meshes for a block of the voxel grid, each visible face run is collapsed into a single quad
+class GreedyMesher
+{
+	std::vector<bool> mMask;
+
+	void AddQuad(const int pAxis, const int pSign, const float pPlane, const float pU0, const float pV0, const float pU1, const float pV1,
+		std::vector<SimpleVertex>& pVertices, std::vector<WORD>& pIndices) const;
+
+public:
+	GreedyMesher() = default;
+	~GreedyMesher() = default;
+
+	void BuildChunk(const VoxelStore& pGrid, const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax,
+		std::vector<SimpleVertex>& pVertices, std::vector<WORD>& pIndices);
+};
@@ -0,0 +1,157 @@
+#include "ImpactPredictor.h"
+#include <chrono>
+#include <cstring>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Finds the world position of the cone for the current state of the flight
+/// </summary>
+/// <returns> the position of the cone in world space </returns>
+XMFLOAT3 ImpactPredictor::ConePosition() const
+{
+	const auto rocketTransform = XMMatrixRotationZ(mState.mPitch) * XMMatrixTranslation(mState.mPosition.x, mState.mPosition.y, mState.mPosition.z);
+	XMFLOAT3 cone{};
+	XMStoreFloat3(&cone, XMVector3TransformCoord(XMVectorZero(), XMLoadFloat4x4(&mConeTransform) * rocketTransform));
+	return cone;
+}
+
+/// <summary>
+/// Checks whether the prediction was started for the same launch, so it can be reused
+/// </summary>
+/// <param name="pParameters"> the flight parameters the rocket will fly with </param>
+/// <param name="pLaunch"> the state the rocket will be launched from </param>
+/// <param name="pDt"> the step the rocket will be flown with </param>
+/// <returns> true if the prediction, finished or not, is for this launch </returns>
+const bool ImpactPredictor::Predicts(const RocketParameters& pParameters, const RocketState& pLaunch, const float pDt) const
+{
+	return mStarted && mDt == pDt &&
+		memcmp(&mFlight.Parameters(), &pParameters, sizeof(RocketParameters)) == 0 &&
+		memcmp(&mLaunch, &pLaunch, sizeof(RocketState)) == 0;
+}
+
+/// <summary>
+/// Starts a new prediction, nothing is flown until it is advanced
+/// </summary>
+/// <param name="pParameters"> the flight parameters the rocket will fly with </param>
+/// <param name="pLaunch"> the state the rocket will be launched from </param>
+/// <param name="pDt"> the step the rocket will be flown with, the same step gives the same path </param>
+/// <param name="pConeTransform"> the transform of the cone shape on the rocket </param>
+void ImpactPredictor::Start(const RocketParameters& pParameters, const RocketState& pLaunch, const float pDt, const XMFLOAT4X4& pConeTransform)
+{
+	mFlight.SetParameters(pParameters);
+	mLaunch = pLaunch;
+	mState = pLaunch;
+	mDt = pDt;
+	mConeTransform = pConeTransform;
+	mCone = ConePosition();
+	mSteps = 0;
+	mStarted = true;
+	mFinished = false;
+	mHit = false;
+}
+
+/// <summary>
+/// Drops the prediction so the next launch is predicted again, used when the terrain has changed under it
+/// </summary>
+void ImpactPredictor::Invalidate()
+{
+	mStarted = false;
+	mFinished = false;
+	mHit = false;
+}
+
+/// <summary>
+/// Flies the prediction on until it hits the terrain, falls below the floor, or the time budget is spent
+/// </summary>
+/// <param name="pStore"> the terrain to collide with </param>
+/// <param name="pWorldToGrid"> the transform from world space into the grid </param>
+/// <param name="pRadius"> the radius of the cone in grid cells </param>
+/// <param name="pFloor"> the height in world space below which the rocket is lost </param>
+/// <param name="pBudget"> the time in milliseconds this call may spend </param>
+/// <returns> true once the prediction is finished </returns>
+const bool ImpactPredictor::Advance(const VoxelStore& pStore, const XMFLOAT4X4& pWorldToGrid, const float pRadius, const float pFloor, const float pBudget)
+{
+	if (!mStarted || mFinished)
+	{
+		return mFinished;
+	}
+
+	const auto start = chrono::high_resolution_clock::now();
+	const auto worldToGrid = XMLoadFloat4x4(&pWorldToGrid);
+	do
+	{
+		//the clock is only read between slices of steps, a step is far cheaper than reading it
+		for (auto i = 0; i < 32 && !mFinished; ++i)
+		{
+			const auto from = mCone;
+			mFlight.Step(mState, mDt);
+			mCone = ConePosition();
+			++mSteps;
+
+			XMFLOAT3 gridFrom{};
+			XMFLOAT3 gridTo{};
+			XMStoreFloat3(&gridFrom, XMVector3TransformCoord(XMLoadFloat3(&from), worldToGrid));
+			XMStoreFloat3(&gridTo, XMVector3TransformCoord(XMLoadFloat3(&mCone), worldToGrid));
+			VoxelHit hit{};
+			if (pStore.SweepSphere(gridFrom, gridTo, pRadius, hit))
+			{
+				XMStoreFloat3(&mImpact, XMVectorLerp(XMLoadFloat3(&from), XMLoadFloat3(&mCone), hit.mTime));
+				XMStoreFloat3(&mGridImpact, XMVectorLerp(XMLoadFloat3(&gridFrom), XMLoadFloat3(&gridTo), hit.mTime));
+				mHit = true;
+				mFinished = true;
+			}
+			else if (mCone.y < pFloor || mSteps >= MAX_STEPS)
+			{
+				mFinished = true;
+			}
+		}
+	} while (!mFinished && chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count() < pBudget);
+	return mFinished;
+}
+
+/// <summary>
+/// Accessor for whether the prediction has finished
+/// </summary>
+/// <returns> true if the rocket has been flown until it hit or was lost </returns>
+const bool ImpactPredictor::Finished() const
+{
+	return mFinished;
+}
+
+/// <summary>
+/// Accessor for whether the predicted flight hits the terrain
+/// </summary>
+/// <returns> true if the finished prediction hit the terrain </returns>
+const bool ImpactPredictor::Hit() const
+{
+	return mHit;
+}
+
+/// <summary>
+/// Accessor for the predicted impact point
+/// </summary>
+/// <returns> where the cone first touches the terrain, in world space </returns>
+const XMFLOAT3& ImpactPredictor::Impact() const
+{
+	return mImpact;
+}
+
+/// <summary>
+/// Accessor for the predicted impact point in the terrains grid
+/// </summary>
+/// <returns> where the cone first touches the terrain, in grid space </returns>
+const XMFLOAT3& ImpactPredictor::GridImpact() const
+{
+	return mGridImpact;
+}
+
+/// <summary>
+/// Accessor for the number of steps flown so far
+/// </summary>
+/// <returns> the number of steps </returns>
+const int ImpactPredictor::Steps() const
+{
+	return mSteps;
+}
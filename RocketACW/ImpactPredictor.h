@@ -0,0 +1,41 @@
+#pragma once
+#include <directxmath.h>
+#include "RocketFlight.h"
+#include "VoxelStore.h"
+
+//Predicts where a rocket will hit the terrain by flying the flight model ahead of it and sweeping each step through the grid
+//The prediction is worked on a slice at a time within a time budget and kept until the launch, the flight model or the terrain changes
+class ImpactPredictor
+{
+	RocketFlight mFlight;
+	RocketState mLaunch{};
+	RocketState mState{};
+	DirectX::XMFLOAT4X4 mConeTransform{};	//where the cone sits on the rocket, the part of the rocket which collides
+	DirectX::XMFLOAT3 mCone{};				//the cone at the end of the last step
+	DirectX::XMFLOAT3 mImpact{};
+	DirectX::XMFLOAT3 mGridImpact{};
+	float mDt = 0;
+	int mSteps = 0;
+	bool mStarted = false;
+	bool mFinished = false;
+	bool mHit = false;
+
+	DirectX::XMFLOAT3 ConePosition() const;
+
+public:
+	static const int MAX_STEPS = 1 << 16;
+
+	ImpactPredictor() = default;
+	~ImpactPredictor() = default;
+
+	const bool Predicts(const RocketParameters& pParameters, const RocketState& pLaunch, const float pDt) const;
+	void Start(const RocketParameters& pParameters, const RocketState& pLaunch, const float pDt, const DirectX::XMFLOAT4X4& pConeTransform);
+	void Invalidate();
+	const bool Advance(const VoxelStore& pStore, const DirectX::XMFLOAT4X4& pWorldToGrid, const float pRadius, const float pFloor, const float pBudget);
+
+	const bool Finished() const;
+	const bool Hit() const;
+	const DirectX::XMFLOAT3& Impact() const;
+	const DirectX::XMFLOAT3& GridImpact() const;
+	const int Steps() const;
+};
@@ -1,11 +1,30 @@
 #pragma once
 #include <directxmath.h>
+#include <cstdint>
+#include <cmath>
 
 struct Instance
 {
 	DirectX::XMFLOAT3 mPosition;
 };
 
+//Packs the integer grid coordinate of an instance into a single key (21 bits per axis)
+inline uint64_t InstanceKey(const int pX, const int pY, const int pZ)
+{
+	const auto bias = 1 << 20;
+	const auto mask = (1ull << 21) - 1;
+	return ((static_cast<uint64_t>(pX + bias) & mask) << 42) |
+		((static_cast<uint64_t>(pY + bias) & mask) << 21) |
+		(static_cast<uint64_t>(pZ + bias) & mask);
+}
+
+inline uint64_t InstanceKey(const Instance& pInstance)
+{
+	return InstanceKey(static_cast<int>(std::lround(pInstance.mPosition.x)),
+		static_cast<int>(std::lround(pInstance.mPosition.y)),
+		static_cast<int>(std::lround(pInstance.mPosition.z)));
+}
+
 inline bool operator==(const Instance& pLhs, const Instance& pRhs)
 {
 	return (abs(pLhs.mPosition.x - pRhs.mPosition.x) < std::numeric_limits<float>::epsilon() &&
@@ -0,0 +1,9 @@
+#pragma once
+//How the instances of a shape are stored and sent to the GPU
+enum class InstanceFormat
+{
+	FLOAT3,	//three floats, 12 bytes - any position
+	PACKED,	//10:10:10:2 unsigned integers, 4 bytes - whole grid coordinates from 0 to 1023 only
+	PARTICLE,	//three floats and two 16 bit unsigned normalised values, 16 bytes - a world position with a size and fade for billboards
+	PITCHED		//four floats, 16 bytes - any position with a rotation about the z axis
+};
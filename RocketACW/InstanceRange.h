@@ -0,0 +1,9 @@
+#pragma once
+
+//A run of instances [mFirst, mLast) which was modified in the given instance version
+struct InstanceRange
+{
+	unsigned int mFirst;
+	unsigned int mLast;
+	unsigned int mVersion;
+};
@@ -64,6 +64,16 @@ void Light::Orbit(const DirectX::XMFLOAT4 & pRotation)
 	SetTransform();
 }
 
+/// <summary>
+/// Sets the orbit rotation for the light outright rather than adding to it
+/// </summary>
+/// <param name="pRotation"> the rotation of the light in its orbit </param>
+void Light::SetOrbit(const DirectX::XMFLOAT4 & pRotation)
+{
+	mOrbit = pRotation;
+	SetTransform();
+}
+
 /// <summary>
 /// Used to offset the light by an amount to orbit
 /// </summary>
@@ -25,6 +25,7 @@ public:
 	void Translate(const DirectX::XMFLOAT4& pTranslation);
 	void Rotate(const DirectX::XMFLOAT4& pRotation);
 	void Orbit(const DirectX::XMFLOAT4& pRotation);
+	void SetOrbit(const DirectX::XMFLOAT4& pRotation);
 	void OrbitTranslate(const DirectX::XMFLOAT4& pTranslation);
 	void Scale(const DirectX::XMFLOAT4& pScale);
 	void SetTranslation(const DirectX::XMFLOAT4& pTranslation);
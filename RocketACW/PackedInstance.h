@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include "Instance.h"
+
+//An instance on the integer grid packed into the layout of DXGI_FORMAT_R10G10B10A2_UINT - x in the lowest 10 bits, then y, then z, the top 2 bits are unused
+struct PackedInstance
+{
+	uint32_t mPacked;
+};
+
+constexpr int PACKED_INSTANCE_BITS = 10;
+constexpr int PACKED_INSTANCE_MAX = (1 << PACKED_INSTANCE_BITS) - 1;
+
+//Checks the grid coordinate fits in 10 bits per axis
+constexpr bool CanPackInstance(const int pX, const int pY, const int pZ)
+{
+	return pX >= 0 && pX <= PACKED_INSTANCE_MAX && pY >= 0 && pY <= PACKED_INSTANCE_MAX && pZ >= 0 && pZ <= PACKED_INSTANCE_MAX;
+}
+
+constexpr PackedInstance PackInstance(const int pX, const int pY, const int pZ)
+{
+	return PackedInstance{ (static_cast<uint32_t>(pX) & PACKED_INSTANCE_MAX) |
+		((static_cast<uint32_t>(pY) & PACKED_INSTANCE_MAX) << PACKED_INSTANCE_BITS) |
+		((static_cast<uint32_t>(pZ) & PACKED_INSTANCE_MAX) << (PACKED_INSTANCE_BITS * 2)) };
+}
+
+constexpr int PackedX(const PackedInstance pInstance)
+{
+	return static_cast<int>(pInstance.mPacked & PACKED_INSTANCE_MAX);
+}
+
+constexpr int PackedY(const PackedInstance pInstance)
+{
+	return static_cast<int>((pInstance.mPacked >> PACKED_INSTANCE_BITS) & PACKED_INSTANCE_MAX);
+}
+
+constexpr int PackedZ(const PackedInstance pInstance)
+{
+	return static_cast<int>((pInstance.mPacked >> (PACKED_INSTANCE_BITS * 2)) & PACKED_INSTANCE_MAX);
+}
+
+//Rounds half away from zero like lround, written out so packing a position can be checked at compile time
+constexpr int RoundToCell(const float pCoordinate)
+{
+	return static_cast<int>(pCoordinate < 0 ? pCoordinate - 0.5f : pCoordinate + 0.5f);
+}
+
+//Rounds the position to the nearest grid cell, positions outside 0 to 1023 wrap so check them with CanPackInstance first
+constexpr PackedInstance PackInstance(const Instance& pInstance)
+{
+	return PackInstance(RoundToCell(pInstance.mPosition.x), RoundToCell(pInstance.mPosition.y), RoundToCell(pInstance.mPosition.z));
+}
+
+constexpr Instance UnpackInstance(const PackedInstance pInstance)
+{
+	return Instance{ DirectX::XMFLOAT3(static_cast<float>(PackedX(pInstance)), static_cast<float>(PackedY(pInstance)), static_cast<float>(PackedZ(pInstance))) };
+}
+
+static_assert(sizeof(PackedInstance) * 3 == sizeof(Instance), "a packed instance must be a third of the size of an instance");
+static_assert(PackInstance(0, 0, 0).mPacked == 0, "the origin packs to zero");
+static_assert(PackInstance(1, 2, 3).mPacked == (1u | (2u << 10) | (3u << 20)), "x is packed lowest, matching the red channel");
+static_assert(PackedX(PackInstance(1023, 0, 0)) == 1023 && PackedY(PackInstance(0, 1023, 0)) == 1023 && PackedZ(PackInstance(0, 0, 1023)) == 1023, "every axis keeps its full 10 bits");
+static_assert(PackedX(PackInstance(17, 513, 1000)) == 17 && PackedY(PackInstance(17, 513, 1000)) == 513 && PackedZ(PackInstance(17, 513, 1000)) == 1000, "pack and unpack round trip");
+static_assert(PackInstance(1023, 1023, 1023).mPacked >> 30 == 0, "the alpha bits are never written");
+static_assert(CanPackInstance(1023, 0, 1023) && !CanPackInstance(1024, 0, 0) && !CanPackInstance(0, -1, 0), "only 0 to 1023 can be packed");
+static_assert(RoundToCell(0.49f) == 0 && RoundToCell(0.5f) == 1 && RoundToCell(-0.49f) == 0 && RoundToCell(-0.5f) == -1 && RoundToCell(1022.5f) == 1023, "positions round half away from zero like lround");
+static_assert(PackInstance(Instance{ DirectX::XMFLOAT3(0, 0, 0) }).mPacked == 0 && PackInstance(Instance{ DirectX::XMFLOAT3(-0.4f, 0.3f, 0.49f) }).mPacked == 0, "positions round to the origin cell");
+static_assert(PackInstance(Instance{ DirectX::XMFLOAT3(1023, 1023, 1023) }).mPacked == PackInstance(1023, 1023, 1023).mPacked &&
+	PackInstance(Instance{ DirectX::XMFLOAT3(1022.6f, 1023.4f, 1022.5f) }).mPacked == PackInstance(1023, 1023, 1023).mPacked, "positions round to the last cell");
+static_assert(UnpackInstance(PackInstance(0, 0, 0)).mPosition.x == 0 && UnpackInstance(PackInstance(0, 0, 0)).mPosition.y == 0 && UnpackInstance(PackInstance(0, 0, 0)).mPosition.z == 0, "the origin unpacks to the origin");
+static_assert(UnpackInstance(PackInstance(1023, 0, 1023)).mPosition.x == 1023 && UnpackInstance(PackInstance(1023, 0, 1023)).mPosition.y == 0 && UnpackInstance(PackInstance(0, 1023, 0)).mPosition.y == 1023 &&
+	UnpackInstance(PackInstance(1023, 0, 1023)).mPosition.z == 1023, "the last cell on every axis unpacks unchanged");
+static_assert(PackInstance(UnpackInstance(PackInstance(17, 513, 1000))).mPacked == PackInstance(17, 513, 1000).mPacked &&
+	PackInstance(UnpackInstance(PackInstance(1023, 1023, 1023))).mPacked == PackInstance(1023, 1023, 1023).mPacked, "an instance survives unpacking and packing again");
@@ -0,0 +1,44 @@
+#pragma once
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+//Splits [0, pCount) into one contiguous block per thread and runs pBody(begin, end) on each block
+//The calling thread takes the last block, pThreads <= 0 uses one thread per hardware core
+template <typename Body>
+void ParallelFor(const int pCount, Body pBody, int pThreads = 0)
+{
+	if (pThreads <= 0)
+	{
+		pThreads = static_cast<int>((std::max)(1u, std::thread::hardware_concurrency()));
+	}
+	pThreads = (std::min)(pThreads, pCount);
+	if (pThreads <= 1)
+	{
+		if (pCount > 0)
+		{
+			pBody(0, pCount);
+		}
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(pThreads - 1);
+	const auto block = (pCount + pThreads - 1) / pThreads;
+	for (auto begin = 0; begin < pCount; begin += block)
+	{
+		const auto end = (std::min)(begin + block, pCount);
+		if (end == pCount)
+		{
+			pBody(begin, end);
+		}
+		else
+		{
+			workers.emplace_back([&pBody, begin, end]() { pBody(begin, end); });
+		}
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
@@ -0,0 +1,213 @@
+#include "ParticleEmitters.h"
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor which allocates every slot and its particle pool up front
+/// </summary>
+/// <param name="pSlots"> the most emitters which can be alive at once </param>
+/// <param name="pCapacity"> the most particles each emitter can hold </param>
+ParticleEmitters::ParticleEmitters(const int pSlots, const int pCapacity) : mCapacity(pCapacity)
+{
+	mPools.reserve(pSlots);
+	for (auto i = 0; i < pSlots; ++i)
+	{
+		mPools.emplace_back(pCapacity);
+	}
+	mParameters.resize(pSlots);
+	mGenerations.resize(pSlots, 0);
+	mActive.resize(pSlots, false);
+	mReleased.resize(pSlots, false);
+	//the slots are handed out lowest first
+	mFreeSlots.reserve(pSlots);
+	for (auto i = pSlots - 1; i >= 0; --i)
+	{
+		mFreeSlots.push_back(i);
+	}
+}
+
+/// <summary>
+/// Takes a free slot for a new emitter
+/// </summary>
+/// <param name="pParameters"> how the particles of the emitter move </param>
+/// <returns> the handle of the emitter, invalid if every slot is in use </returns>
+const EmitterHandle ParticleEmitters::Spawn(const ParticleParameters& pParameters)
+{
+	if (mFreeSlots.empty())
+	{
+		return EmitterHandle{};
+	}
+	const auto slot = mFreeSlots.back();
+	mFreeSlots.pop_back();
+	mParameters[slot] = pParameters;
+	mActive[slot] = true;
+	mReleased[slot] = false;
+	return EmitterHandle{ slot, mGenerations[slot] };
+}
+
+/// <summary>
+/// Emits a burst of particles through an emitter, see ParticlePool::Emit
+/// </summary>
+/// <param name="pHandle"> the emitter to emit through </param>
+/// <param name="pPosition"> the centre of the burst </param>
+/// <param name="pVelocity"> the velocity every particle starts with </param>
+/// <param name="pSpread"> the largest speed added in a random direction </param>
+/// <param name="pRadius"> the radius of the sphere the particles start in </param>
+/// <param name="pLifetime"> the average time a particle lives for </param>
+/// <param name="pSize"> the average size of a particle </param>
+/// <param name="pCount"> the number of particles to emit </param>
+/// <returns> the number of particles emitted, 0 if the handle is no longer valid </returns>
+const int ParticleEmitters::Emit(const EmitterHandle& pHandle, const XMFLOAT3& pPosition, const XMFLOAT3& pVelocity, const float pSpread, const float pRadius, const float pLifetime, const float pSize, const int pCount)
+{
+	if (!IsValid(pHandle))
+	{
+		return 0;
+	}
+	return mPools[pHandle.mSlot].Emit(pPosition, pVelocity, pSpread, pRadius, pLifetime, pSize, pCount);
+}
+
+/// <summary>
+/// Stops emitting through an emitter, its particles live out their lifetimes before the slot is reused
+/// </summary>
+/// <param name="pHandle"> the emitter to release, it is made invalid </param>
+void ParticleEmitters::Release(EmitterHandle& pHandle)
+{
+	if (IsValid(pHandle))
+	{
+		mReleased[pHandle.mSlot] = true;
+	}
+	pHandle = EmitterHandle{};
+}
+
+/// <summary>
+/// Checks whether a handle still refers to an emitter which has not been released
+/// </summary>
+/// <param name="pHandle"> the handle to check </param>
+/// <returns> true if particles can be emitted through the handle </returns>
+const bool ParticleEmitters::IsValid(const EmitterHandle& pHandle) const
+{
+	return pHandle.mSlot >= 0 && pHandle.mSlot < Slots() && mActive[pHandle.mSlot] && !mReleased[pHandle.mSlot] && mGenerations[pHandle.mSlot] == pHandle.mGeneration;
+}
+
+/// <summary>
+/// Gets how many more particles an emitter can hold
+/// </summary>
+/// <param name="pHandle"> the emitter </param>
+/// <returns> the free space in the emitters pool, 0 if the handle is no longer valid </returns>
+const int ParticleEmitters::Room(const EmitterHandle& pHandle) const
+{
+	return IsValid(pHandle) ? mCapacity - mPools[pHandle.mSlot].Count() : 0;
+}
+
+/// <summary>
+/// Moves the particles of every live emitter on and reclaims the released emitters which have emptied
+/// </summary>
+/// <param name="pDt"> the time to move the particles over </param>
+/// <param name="pWind"> the velocity of the air, shared by every emitter </param>
+/// <param name="pWorkers"> the threads a big pool is shared out between </param>
+void ParticleEmitters::Update(const float pDt, const XMFLOAT3& pWind, WorkerPool& pWorkers)
+{
+	for (auto slot = 0; slot < Slots(); ++slot)
+	{
+		if (!mActive[slot])
+		{
+			continue;
+		}
+		mParameters[slot].mWind = pWind;
+		mPools[slot].Update(pDt, mParameters[slot], pWorkers);
+		if (mReleased[slot] && mPools[slot].Count() == 0)
+		{
+			Reclaim(slot);
+		}
+	}
+}
+
+/// <summary>
+/// Puts a slot back on the free list, handles to its last emitter no longer match it
+/// </summary>
+/// <param name="pSlot"> the slot to reclaim </param>
+void ParticleEmitters::Reclaim(const int pSlot)
+{
+	mPools[pSlot].Clear();
+	mActive[pSlot] = false;
+	mReleased[pSlot] = false;
+	++mGenerations[pSlot];
+	mFreeSlots.push_back(pSlot);
+}
+
+/// <summary>
+/// Writes the particles of one slot as instances for the billboard shader
+/// </summary>
+/// <param name="pSlot"> the slot to write </param>
+/// <param name="pInstances"> filled with one instance per particle, reserve the capacity of a slot to never allocate </param>
+/// <param name="pWorkers"> the threads a big pool is shared out between </param>
+void ParticleEmitters::Instances(const int pSlot, vector<ParticleInstance>& pInstances, WorkerPool& pWorkers) const
+{
+	mPools[pSlot].Instances(pInstances, pWorkers);
+}
+
+/// <summary>
+/// Removes every emitter and particle, handles to them are no longer valid
+/// </summary>
+void ParticleEmitters::Clear()
+{
+	for (auto slot = 0; slot < Slots(); ++slot)
+	{
+		if (mActive[slot])
+		{
+			Reclaim(slot);
+		}
+	}
+}
+
+/// <summary>
+/// Accessor for the number of emitter slots
+/// </summary>
+/// <returns> the most emitters which can be alive at once </returns>
+const int ParticleEmitters::Slots() const
+{
+	return static_cast<int>(mPools.size());
+}
+
+/// <summary>
+/// Accessor for the size of the pool of each slot
+/// </summary>
+/// <returns> the most particles one emitter can hold </returns>
+const int ParticleEmitters::Capacity() const
+{
+	return mCapacity;
+}
+
+/// <summary>
+/// Gets the number of live particles in one slot
+/// </summary>
+/// <param name="pSlot"> the slot </param>
+/// <returns> the number of live particles </returns>
+const int ParticleEmitters::Count(const int pSlot) const
+{
+	return mPools[pSlot].Count();
+}
+
+/// <summary>
+/// Gets the number of live particles in every slot
+/// </summary>
+/// <returns> the total number of live particles </returns>
+const int ParticleEmitters::Count() const
+{
+	auto count = 0;
+	for (const auto& pool : mPools)
+	{
+		count += pool.Count();
+	}
+	return count;
+}
+
+/// <summary>
+/// Gets the number of slots in use, released emitters with particles left included
+/// </summary>
+/// <returns> the number of live emitters </returns>
+const int ParticleEmitters::ActiveEmitters() const
+{
+	return Slots() - static_cast<int>(mFreeSlots.size());
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include "ParticlePool.h"
+#include "EmitterHandle.h"
+
+//A fixed set of emitter slots, each with its own preallocated particle pool, so spawning an emitter is taking a slot off a free list and never allocates
+//Each slot is drawn through its own shape, so every emitter has its own instance buffer on the GPU
+//An emitter is released once nothing more will be emitted through it, its slot goes back on the free list when its last particle dies
+class ParticleEmitters
+{
+	std::vector<ParticlePool> mPools;
+	std::vector<ParticleParameters> mParameters;
+	std::vector<unsigned int> mGenerations;
+	std::vector<bool> mActive;		//spawned and not yet reclaimed
+	std::vector<bool> mReleased;	//no more particles will be emitted, reclaimed once empty
+	std::vector<int> mFreeSlots;
+	int mCapacity;
+
+	void Reclaim(const int pSlot);
+
+public:
+	ParticleEmitters(const int pSlots, const int pCapacity);
+	~ParticleEmitters() = default;
+
+	ParticleEmitters& operator=(const ParticleEmitters& pEmitters) = delete;
+	ParticleEmitters(const ParticleEmitters& pEmitters) = delete;
+
+	const EmitterHandle Spawn(const ParticleParameters& pParameters);
+	const int Emit(const EmitterHandle& pHandle, const DirectX::XMFLOAT3& pPosition, const DirectX::XMFLOAT3& pVelocity, const float pSpread, const float pRadius, const float pLifetime, const float pSize, const int pCount);
+	void Release(EmitterHandle& pHandle);
+	const bool IsValid(const EmitterHandle& pHandle) const;
+	const int Room(const EmitterHandle& pHandle) const;
+	void Update(const float pDt, const DirectX::XMFLOAT3& pWind, WorkerPool& pWorkers);
+	void Instances(const int pSlot, std::vector<ParticleInstance>& pInstances, WorkerPool& pWorkers) const;
+	void Clear();
+
+	const int Slots() const;
+	const int Capacity() const;
+	const int Count(const int pSlot) const;
+	const int Count() const;
+	const int ActiveEmitters() const;
+};
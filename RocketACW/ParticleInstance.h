@@ -0,0 +1,21 @@
+#pragma once
+#include <directxmath.h>
+#include <cstdint>
+#include <algorithm>
+
+//A particle as it is sent to the GPU, 16 bytes - its world position, then its size and fade as two 16 bit unsigned normalised values in the layout of DXGI_FORMAT_R16G16_UNORM
+struct ParticleInstance
+{
+	DirectX::XMFLOAT3 mPosition;
+	uint32_t mSizeFade;
+};
+
+constexpr float PARTICLE_MAX_SIZE = 8.0f;	//the size of a particle with a packed size of 1, larger particles are clamped to it
+
+//Packs a size between 0 and PARTICLE_MAX_SIZE and a fade between 0 and 1 into the low and high 16 bits
+inline uint32_t PackSizeFade(const float pSize, const float pFade)
+{
+	const auto size = static_cast<uint32_t>((std::min)((std::max)(pSize / PARTICLE_MAX_SIZE, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	const auto fade = static_cast<uint32_t>((std::min)((std::max)(pFade, 0.0f), 1.0f) * 65535.0f + 0.5f);
+	return size | (fade << 16);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <directxmath.h>
+#include <cfloat>
+
+//How the particles of a pool move once emitted, in world units and simulated seconds
+struct ParticleParameters
+{
+	DirectX::XMFLOAT3 mAcceleration{ 0, -1, 0 };	//gravity, or buoyancy for smoke which rises
+	DirectX::XMFLOAT3 mWind{ 0, 0, 0 };			//the velocity of the air the particles are dragged towards
+	float mDrag = 0.5f;							//the fraction of the difference from the wind lost per second
+	float mFloor = -FLT_MAX;						//particles bounce off the plane at this height
+	float mRestitution = 0.3f;					//the fraction of the speed into the floor kept after a bounce
+	float mGrowth = 0.0f;						//the size gained per second
+};
@@ -0,0 +1,218 @@
+#include "ParticlePool.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor which allocates every array at its full size up front
+/// </summary>
+/// <param name="pCapacity"> the most particles which can be alive at once </param>
+ParticlePool::ParticlePool(const int pCapacity) : mCapacity(pCapacity)
+{
+	const auto lanes = static_cast<size_t>((pCapacity + 3) & ~3);
+	for (auto* array : { &mX, &mY, &mZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mAge, &mSize })
+	{
+		array->resize(lanes, 0.0f);
+	}
+	//the unused lanes are given a lifetime so the fade never divides by zero
+	mLifetime.resize(lanes, 1.0f);
+}
+
+/// <summary>
+/// Gets the next number from the pools own xorshift generator, so emitting is repeatable and never shares state between threads
+/// </summary>
+/// <returns> a number in [0, 1) </returns>
+const float ParticlePool::Random()
+{
+	mSeed ^= mSeed << 13;
+	mSeed ^= mSeed >> 17;
+	mSeed ^= mSeed << 5;
+	return static_cast<float>(mSeed >> 8) * (1.0f / 16777216.0f);
+}
+
+/// <summary>
+/// Emits a burst of particles around a point, each with a random direction added to the given velocity
+/// Particles which do not fit in the pool are dropped
+/// </summary>
+/// <param name="pPosition"> the centre of the burst </param>
+/// <param name="pVelocity"> the velocity every particle starts with </param>
+/// <param name="pSpread"> the largest speed added in a random direction </param>
+/// <param name="pRadius"> the radius of the sphere the particles start in </param>
+/// <param name="pLifetime"> the average time a particle lives for </param>
+/// <param name="pSize"> the average size of a particle </param>
+/// <param name="pCount"> the number of particles to emit </param>
+/// <returns> the number of particles emitted </returns>
+const int ParticlePool::Emit(const XMFLOAT3& pPosition, const XMFLOAT3& pVelocity, const float pSpread, const float pRadius, const float pLifetime, const float pSize, const int pCount)
+{
+	const auto count = (min)(pCount, mCapacity - mCount);
+	for (auto i = 0; i < count; ++i)
+	{
+		//a uniformly random direction, from a height on the unit sphere and an angle around it
+		const auto height = Random() * 2 - 1;
+		const auto angle = Random() * XM_2PI;
+		const auto ring = sqrtf(1 - height * height);
+		const auto directionX = ring * cosf(angle);
+		const auto directionY = height;
+		const auto directionZ = ring * sinf(angle);
+		const auto offset = pRadius * Random();
+		const auto speed = pSpread * Random();
+
+		const auto particle = mCount++;
+		mX[particle] = pPosition.x + directionX * offset;
+		mY[particle] = pPosition.y + directionY * offset;
+		mZ[particle] = pPosition.z + directionZ * offset;
+		mVelocityX[particle] = pVelocity.x + directionX * speed;
+		mVelocityY[particle] = pVelocity.y + directionY * speed;
+		mVelocityZ[particle] = pVelocity.z + directionZ * speed;
+		mAge[particle] = 0;
+		mLifetime[particle] = pLifetime * (0.75f + 0.5f * Random());
+		mSize[particle] = pSize * (0.75f + 0.5f * Random());
+	}
+	return count;
+}
+
+/// <summary>
+/// Integrates a run of particles four at a time - dragged towards the wind, accelerated, moved and bounced off the floor
+/// </summary>
+/// <param name="pBegin"> the first group of four particles </param>
+/// <param name="pEnd"> one past the last group of four particles </param>
+/// <param name="pDt"> the time to integrate over </param>
+/// <param name="pParameters"> how the particles move </param>
+void ParticlePool::Integrate(const int pBegin, const int pEnd, const float pDt, const ParticleParameters& pParameters)
+{
+	const auto dt = XMVectorReplicate(pDt);
+	//the drag is limited so a long step can only take the particles to the wind, never past it
+	const auto drag = XMVectorReplicate((min)(pParameters.mDrag * pDt, 1.0f));
+	const auto windX = XMVectorReplicate(pParameters.mWind.x);
+	const auto windY = XMVectorReplicate(pParameters.mWind.y);
+	const auto windZ = XMVectorReplicate(pParameters.mWind.z);
+	const auto accelerationX = XMVectorReplicate(pParameters.mAcceleration.x * pDt);
+	const auto accelerationY = XMVectorReplicate(pParameters.mAcceleration.y * pDt);
+	const auto accelerationZ = XMVectorReplicate(pParameters.mAcceleration.z * pDt);
+	const auto floor = XMVectorReplicate(pParameters.mFloor);
+	const auto restitution = XMVectorReplicate(-pParameters.mRestitution);
+	const auto growth = XMVectorReplicate(pParameters.mGrowth * pDt);
+	const auto zero = XMVectorZero();
+
+	for (auto group = pBegin; group < pEnd; ++group)
+	{
+		const auto i = group * 4;
+		auto x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mX[i]));
+		auto y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mY[i]));
+		auto z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mZ[i]));
+		auto velocityX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityX[i]));
+		auto velocityY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityY[i]));
+		auto velocityZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityZ[i]));
+		const auto age = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mAge[i]));
+		const auto size = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mSize[i]));
+
+		//the velocity is updated first and then moves the particle, which keeps the bounce stable
+		velocityX = XMVectorMultiplyAdd(windX - velocityX, drag, velocityX + accelerationX);
+		velocityY = XMVectorMultiplyAdd(windY - velocityY, drag, velocityY + accelerationY);
+		velocityZ = XMVectorMultiplyAdd(windZ - velocityZ, drag, velocityZ + accelerationZ);
+		x = XMVectorMultiplyAdd(velocityX, dt, x);
+		y = XMVectorMultiplyAdd(velocityY, dt, y);
+		z = XMVectorMultiplyAdd(velocityZ, dt, z);
+
+		//particles which have sunk through the floor are put back on it, and thrown back up if they were still falling
+		const auto below = XMVectorLess(y, floor);
+		const auto falling = XMVectorAndInt(below, XMVectorLess(velocityY, zero));
+		y = XMVectorSelect(y, floor, below);
+		velocityY = XMVectorSelect(velocityY, velocityY * restitution, falling);
+
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mX[i]), x);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mY[i]), y);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mZ[i]), z);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityX[i]), velocityX);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityY[i]), velocityY);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityZ[i]), velocityZ);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mAge[i]), age + dt);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mSize[i]), size + growth);
+	}
+}
+
+/// <summary>
+/// Moves every particle on and removes the particles which have outlived their lifetime
+/// </summary>
+/// <param name="pDt"> the time to move the particles over </param>
+/// <param name="pParameters"> how the particles move </param>
+/// <param name="pWorkers"> the threads a big pool is shared out between </param>
+void ParticlePool::Update(const float pDt, const ParticleParameters& pParameters, WorkerPool& pWorkers)
+{
+	pWorkers.For((mCount + 3) / 4, GRAIN, [this, pDt, &pParameters](const int pBegin, const int pEnd)
+	{
+		Integrate(pBegin, pEnd, pDt, pParameters);
+	});
+
+	for (auto i = 0; i < mCount;)
+	{
+		if (mAge[i] >= mLifetime[i])
+		{
+			RemoveParticle(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+/// <summary>
+/// Removes a particle by moving the last particle into its place
+/// </summary>
+/// <param name="pIndex"> the particle to remove </param>
+void ParticlePool::RemoveParticle(const int pIndex)
+{
+	const auto last = --mCount;
+	for (auto* array : { &mX, &mY, &mZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mAge, &mLifetime, &mSize })
+	{
+		(*array)[pIndex] = (*array)[last];
+	}
+}
+
+/// <summary>
+/// Writes every particle as a compact instance for the billboard shader, fading out over its lifetime
+/// </summary>
+/// <param name="pInstances"> filled with one instance per particle, reserve the capacity of the pool to never allocate </param>
+/// <param name="pWorkers"> the threads a big pool is shared out between </param>
+void ParticlePool::Instances(vector<ParticleInstance>& pInstances, WorkerPool& pWorkers) const
+{
+	pInstances.resize(mCount);
+	auto* const instances = pInstances.data();
+	pWorkers.For(mCount, GRAIN * 4, [this, instances](const int pBegin, const int pEnd)
+	{
+		for (auto i = pBegin; i < pEnd; ++i)
+		{
+			instances[i].mPosition = XMFLOAT3(mX[i], mY[i], mZ[i]);
+			instances[i].mSizeFade = PackSizeFade(mSize[i], 1 - mAge[i] / mLifetime[i]);
+		}
+	});
+}
+
+/// <summary>
+/// Removes every particle, the arrays keep their memory
+/// </summary>
+void ParticlePool::Clear()
+{
+	mCount = 0;
+}
+
+/// <summary>
+/// Accessor for the number of live particles
+/// </summary>
+/// <returns> the number of live particles </returns>
+const int ParticlePool::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Accessor for the most particles the pool can hold
+/// </summary>
+/// <returns> the capacity of the pool </returns>
+const int ParticlePool::Capacity() const
+{
+	return mCapacity;
+}
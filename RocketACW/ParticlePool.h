@@ -0,0 +1,44 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include "ParticleParameters.h"
+#include "ParticleInstance.h"
+#include "WorkerPool.h"
+
+//Particles stored as structure of arrays in a pool of fixed capacity, so emitting and updating never allocate
+//Four particles are integrated by each SIMD instruction and big pools are shared out between worker threads
+//The arrays are padded to a multiple of four, the lanes past the last particle are integrated but never read
+class ParticlePool
+{
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<float> mZ;
+	std::vector<float> mVelocityX;
+	std::vector<float> mVelocityY;
+	std::vector<float> mVelocityZ;
+	std::vector<float> mAge;
+	std::vector<float> mLifetime;
+	std::vector<float> mSize;
+	int mCount = 0;
+	int mCapacity = 0;
+	uint32_t mSeed = 0x9e3779b9u;
+
+	const float Random();
+	void Integrate(const int pBegin, const int pEnd, const float pDt, const ParticleParameters& pParameters);
+	void RemoveParticle(const int pIndex);
+
+public:
+	static const int GRAIN = 1024;	//the groups of four particles in each block given to a worker
+
+	explicit ParticlePool(const int pCapacity);
+	~ParticlePool() = default;
+
+	const int Emit(const DirectX::XMFLOAT3& pPosition, const DirectX::XMFLOAT3& pVelocity, const float pSpread, const float pRadius, const float pLifetime, const float pSize, const int pCount);
+	void Update(const float pDt, const ParticleParameters& pParameters, WorkerPool& pWorkers);
+	void Instances(std::vector<ParticleInstance>& pInstances, WorkerPool& pWorkers) const;
+	void Clear();
+
+	const int Count() const;
+	const int Capacity() const;
+};
@@ -0,0 +1,147 @@
+#include "ParticleSorter.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor which reserves the scratch space for sorting a number of particles, so sorting that many never allocates
+/// </summary>
+/// <param name="pCapacity"> the most particles which will be sorted at once </param>
+/// <param name="pThreads"> the number of threads in the worker pool the sorts will be shared out between </param>
+ParticleSorter::ParticleSorter(const int pCapacity, const int pThreads)
+{
+	mKeys.reserve(pCapacity);
+	mScratchKeys.reserve(pCapacity);
+	mScratch.reserve(pCapacity);
+	mDepths.reserve(pCapacity);
+	mBlockNearest.reserve(pThreads);
+	mBlockFurthest.reserve(pThreads);
+	mCounts.reserve(static_cast<size_t>(pThreads) * RADIX);
+}
+
+/// <summary>
+/// Sorts particles so the furthest from the camera comes first and the nearest last, particles at the same depth keep their order
+/// </summary>
+/// <param name="pInstances"> the particles to sort, in place </param>
+/// <param name="pEye"> the position of the camera </param>
+/// <param name="pForward"> the direction the camera looks in </param>
+/// <param name="pWorkers"> the threads the sort is shared out between </param>
+void ParticleSorter::Sort(vector<ParticleInstance>& pInstances, const XMFLOAT4& pEye, const XMFLOAT4& pForward, WorkerPool& pWorkers)
+{
+	const auto count = static_cast<int>(pInstances.size());
+	if (count < 2)
+	{
+		return;
+	}
+	mKeys.resize(count);
+	mScratchKeys.resize(count);
+	mScratch.resize(count);
+	mDepths.resize(count);
+
+	const auto blocks = (max)(1, (min)(pWorkers.Threads(), count / MIN_BLOCK));
+	const auto blockSize = (count + blocks - 1) / blocks;
+	mBlockNearest.resize(blocks);
+	mBlockFurthest.resize(blocks);
+	mCounts.resize(static_cast<size_t>(blocks) * RADIX);
+
+	//the depth of each particle along the view, and the range they cover
+	const auto eye = XMLoadFloat4(&pEye);
+	const auto forward = XMVector3Normalize(XMLoadFloat4(&pForward));
+	auto* const instances = pInstances.data();
+	pWorkers.For(blocks, 1, [&](const int pBegin, const int pEnd)
+	{
+		for (auto block = pBegin; block < pEnd; ++block)
+		{
+			auto nearest = FLT_MAX;
+			auto furthest = -FLT_MAX;
+			const auto last = (min)(count, (block + 1) * blockSize);
+			for (auto i = block * blockSize; i < last; ++i)
+			{
+				const auto depth = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&instances[i].mPosition) - eye, forward));
+				mDepths[i] = depth;
+				nearest = (min)(nearest, depth);
+				furthest = (max)(furthest, depth);
+			}
+			mBlockNearest[block] = nearest;
+			mBlockFurthest[block] = furthest;
+		}
+	});
+	const auto nearest = *min_element(mBlockNearest.begin(), mBlockNearest.end());
+	const auto furthest = *max_element(mBlockFurthest.begin(), mBlockFurthest.end());
+	if (furthest <= nearest)
+	{
+		return;
+	}
+
+	//the furthest particle gets key 0 so an ascending sort draws back to front
+	const auto scale = 65535.0f / (furthest - nearest);
+	pWorkers.For(count, MIN_BLOCK, [&](const int pBegin, const int pEnd)
+	{
+		for (auto i = pBegin; i < pEnd; ++i)
+		{
+			mKeys[i] = static_cast<uint16_t>((furthest - mDepths[i]) * scale);
+		}
+	});
+
+	Pass(blocks, blockSize, 0, mKeys.data(), instances, mScratchKeys.data(), mScratch.data(), pWorkers);
+	Pass(blocks, blockSize, 8, mScratchKeys.data(), mScratch.data(), mKeys.data(), instances, pWorkers);
+}
+
+/// <summary>
+/// Sorts the particles stably on one byte of their keys
+/// </summary>
+/// <param name="pBlocks"> the number of blocks the particles are split into </param>
+/// <param name="pBlockSize"> the number of particles in every block but the last </param>
+/// <param name="pShift"> the position of the byte in the keys </param>
+/// <param name="pKeys"> the keys to sort by </param>
+/// <param name="pInstances"> the particles to sort </param>
+/// <param name="pKeysOut"> filled with the sorted keys </param>
+/// <param name="pInstancesOut"> filled with the sorted particles </param>
+/// <param name="pWorkers"> the threads the pass is shared out between </param>
+void ParticleSorter::Pass(const int pBlocks, const int pBlockSize, const int pShift, const uint16_t* const pKeys, const ParticleInstance* const pInstances, uint16_t* const pKeysOut, ParticleInstance* const pInstancesOut, WorkerPool& pWorkers)
+{
+	const auto count = static_cast<int>(mKeys.size());
+	auto* const counts = mCounts.data();
+	fill(mCounts.begin(), mCounts.end(), 0);
+	pWorkers.For(pBlocks, 1, [&](const int pBegin, const int pEnd)
+	{
+		for (auto block = pBegin; block < pEnd; ++block)
+		{
+			auto* const blockCounts = counts + block * RADIX;
+			const auto last = (min)(count, (block + 1) * pBlockSize);
+			for (auto i = block * pBlockSize; i < last; ++i)
+			{
+				++blockCounts[(pKeys[i] >> pShift) & (RADIX - 1)];
+			}
+		}
+	});
+
+	//each digit starts after every smaller digit, and within a digit each block starts after the blocks before it
+	auto offset = 0;
+	for (auto digit = 0; digit < RADIX; ++digit)
+	{
+		for (auto block = 0; block < pBlocks; ++block)
+		{
+			const auto digitCount = counts[block * RADIX + digit];
+			counts[block * RADIX + digit] = offset;
+			offset += digitCount;
+		}
+	}
+
+	pWorkers.For(pBlocks, 1, [&](const int pBegin, const int pEnd)
+	{
+		for (auto block = pBegin; block < pEnd; ++block)
+		{
+			auto* const blockOffsets = counts + block * RADIX;
+			const auto last = (min)(count, (block + 1) * pBlockSize);
+			for (auto i = block * pBlockSize; i < last; ++i)
+			{
+				const auto destination = blockOffsets[(pKeys[i] >> pShift) & (RADIX - 1)]++;
+				pKeysOut[destination] = pKeys[i];
+				pInstancesOut[destination] = pInstances[i];
+			}
+		}
+	});
+}
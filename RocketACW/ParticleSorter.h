@@ -0,0 +1,31 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include "ParticleInstance.h"
+#include "WorkerPool.h"
+
+//Sorts particles back to front for alpha blending with a least significant digit radix sort on their depth along the view
+//Depths are quantised to 16 bit keys between the nearest and furthest particle and sorted a byte at a time, two stable passes
+//Each pass is shared out between the worker threads - every block counts its own digits, the counts are summed in order so each block knows where its particles go, then every block scatters its particles at once
+class ParticleSorter
+{
+	static const int RADIX = 256;
+	static const int MIN_BLOCK = 8192;	//smaller blocks cost more in counting than they save
+
+	std::vector<uint16_t> mKeys;
+	std::vector<uint16_t> mScratchKeys;
+	std::vector<ParticleInstance> mScratch;
+	std::vector<float> mDepths;
+	std::vector<float> mBlockNearest;
+	std::vector<float> mBlockFurthest;
+	std::vector<int> mCounts;			//RADIX counts for each block, turned into the offset each block writes its digits from
+
+	void Pass(const int pBlocks, const int pBlockSize, const int pShift, const uint16_t* const pKeys, const ParticleInstance* const pInstances, uint16_t* const pKeysOut, ParticleInstance* const pInstancesOut, WorkerPool& pWorkers);
+
+public:
+	ParticleSorter(const int pCapacity, const int pThreads);
+	~ParticleSorter() = default;
+
+	void Sort(std::vector<ParticleInstance>& pInstances, const DirectX::XMFLOAT4& pEye, const DirectX::XMFLOAT4& pForward, WorkerPool& pWorkers);
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include <directxmath.h>
+
+//An instance turned about the z axis as it is sent to the GPU, 16 bytes - its position, then its pitch in radians, the same angle a gameobject is rotated by in z
+struct PitchedInstance
+{
+	DirectX::XMFLOAT3 mPosition;
+	float mPitch;
+};
+
+static_assert(sizeof(PitchedInstance) == 16, "a pitched instance is read by the input layout as a float3 followed by a float");
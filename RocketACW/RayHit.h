@@ -0,0 +1,11 @@
+#pragma once
+#include <directxmath.h>
+
+//The first solid cell a terrain ray enters
+struct RayHit
+{
+	DirectX::XMINT3 mCell;
+	DirectX::XMINT3 mNormal;	//the face the ray entered the cell through, zero if the ray started inside it
+	float mDistance;			//in grid cells along the ray
+	bool mHit;
+};
@@ -0,0 +1,7 @@
+#pragma once
+//How an instance list is compacted after removing entries
+enum class RemovalMode
+{
+	PRESERVE_ORDER,	//shift the survivors down, keeping their order
+	SWAP_AND_POP	//move the last instance into each hole, order is not kept
+};
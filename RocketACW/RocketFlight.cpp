@@ -0,0 +1,144 @@
+#include "RocketFlight.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for the flight model
+/// </summary>
+/// <param name="pParameters"> the thrust, masses, drag and gravity to fly with </param>
+RocketFlight::RocketFlight(const RocketParameters& pParameters) : mParameters(pParameters)
+{
+}
+
+/// <summary>
+/// Finds how fast each part of the state is changing - thrust only acts while there is fuel above the dry mass
+/// </summary>
+/// <param name="pState"> the state to find the rate of change of </param>
+/// <returns> the rate of change of the state </returns>
+RocketFlight::RocketRate RocketFlight::Rate(const RocketState& pState) const
+{
+	const auto burning = pState.mMass > mParameters.mDryMass;
+	const auto thrust = burning ? mParameters.mThrust : 0.0f;
+	const auto& velocity = pState.mVelocity;
+	const auto drag = mParameters.mDrag * sqrtf(velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+	const auto inverseMass = 1.0f / pState.mMass;
+
+	//the rockets up vector after rotating about z by its pitch
+	const auto upX = -sinf(pState.mPitch);
+	const auto upY = cosf(pState.mPitch);
+
+	RocketRate rate{};
+	rate.mVelocity[0] = velocity.x;
+	rate.mVelocity[1] = velocity.y;
+	rate.mVelocity[2] = velocity.z;
+	rate.mAcceleration[0] = (thrust * upX - drag * velocity.x) * inverseMass;
+	rate.mAcceleration[1] = (thrust * upY - drag * velocity.y) * inverseMass - mParameters.mGravity;
+	rate.mAcceleration[2] = -drag * velocity.z * inverseMass;
+	rate.mMassRate = burning ? -mParameters.mBurnRate : 0.0f;
+	rate.mPitchRate = burning ? mParameters.mPitchRate : 0.0f;
+	return rate;
+}
+
+/// <summary>
+/// Moves a state along a rate of change for the given time
+/// </summary>
+/// <param name="pState"> the state to start from </param>
+/// <param name="pRate"> the rate of change to follow </param>
+/// <param name="pDt"> the time to follow it for </param>
+/// <returns> the moved state </returns>
+RocketState RocketFlight::Advance(const RocketState& pState, const RocketRate& pRate, const float pDt)
+{
+	RocketState state{};
+	state.mPosition = XMFLOAT3(pState.mPosition.x + pRate.mVelocity[0] * pDt, pState.mPosition.y + pRate.mVelocity[1] * pDt, pState.mPosition.z + pRate.mVelocity[2] * pDt);
+	state.mVelocity = XMFLOAT3(pState.mVelocity.x + pRate.mAcceleration[0] * pDt, pState.mVelocity.y + pRate.mAcceleration[1] * pDt, pState.mVelocity.z + pRate.mAcceleration[2] * pDt);
+	state.mMass = pState.mMass + pRate.mMassRate * pDt;
+	state.mPitch = pState.mPitch + pRate.mPitchRate * pDt;
+	return state;
+}
+
+/// <summary>
+/// Creates the state of a rocket sat on its launcher with a full tank
+/// </summary>
+/// <param name="pPosition"> the position of the rocket </param>
+/// <param name="pPitch"> the pitch of the launcher </param>
+/// <returns> the state to fly the rocket from </returns>
+RocketState RocketFlight::Launch(const XMFLOAT4& pPosition, const float pPitch) const
+{
+	RocketState state{};
+	state.mPosition = XMFLOAT3(pPosition.x, pPosition.y, pPosition.z);
+	state.mVelocity = XMFLOAT3(0, 0, 0);
+	state.mMass = mParameters.mDryMass + mParameters.mFuelMass;
+	state.mPitch = pPitch;
+	return state;
+}
+
+/// <summary>
+/// Steps a rocket forward with fourth order Runge-Kutta
+/// </summary>
+/// <param name="pState"> the rocket to step </param>
+/// <param name="pDt"> the length of the step in simulated seconds </param>
+void RocketFlight::Step(RocketState& pState, const float pDt) const
+{
+	const auto k1 = Rate(pState);
+	const auto k2 = Rate(Advance(pState, k1, pDt * 0.5f));
+	const auto k3 = Rate(Advance(pState, k2, pDt * 0.5f));
+	const auto k4 = Rate(Advance(pState, k3, pDt));
+
+	RocketRate rate{};
+	for (auto i = 0; i < 3; ++i)
+	{
+		rate.mVelocity[i] = (k1.mVelocity[i] + 2 * (k2.mVelocity[i] + k3.mVelocity[i]) + k4.mVelocity[i]) / 6;
+		rate.mAcceleration[i] = (k1.mAcceleration[i] + 2 * (k2.mAcceleration[i] + k3.mAcceleration[i]) + k4.mAcceleration[i]) / 6;
+	}
+	rate.mMassRate = (k1.mMassRate + 2 * (k2.mMassRate + k3.mMassRate) + k4.mMassRate) / 6;
+	rate.mPitchRate = (k1.mPitchRate + 2 * (k2.mPitchRate + k3.mPitchRate) + k4.mPitchRate) / 6;
+	pState = Advance(pState, rate, pDt);
+
+	//a step that burns out part way through must not leave the rocket lighter than it is built
+	if (pState.mMass < mParameters.mDryMass)
+	{
+		pState.mMass = mParameters.mDryMass;
+	}
+	//without thrust the rocket turns to face the way it is moving
+	if (pState.mMass <= mParameters.mDryMass)
+	{
+		const auto& velocity = pState.mVelocity;
+		if (velocity.x * velocity.x + velocity.y * velocity.y > 1e-6f)
+		{
+			pState.mPitch = atan2f(-velocity.x, velocity.y);
+		}
+	}
+}
+
+/// <summary>
+/// Steps every rocket in a batch forward by the same time
+/// </summary>
+/// <param name="pStates"> the rockets to step </param>
+/// <param name="pDt"> the length of the step in simulated seconds </param>
+void RocketFlight::Step(vector<RocketState>& pStates, const float pDt) const
+{
+	for (auto& state : pStates)
+	{
+		Step(state, pDt);
+	}
+}
+
+/// <summary>
+/// Accessor for the constants of the flight model
+/// </summary>
+/// <returns> the flight parameters </returns>
+const RocketParameters& RocketFlight::Parameters() const
+{
+	return mParameters;
+}
+
+/// <summary>
+/// Sets the constants of the flight model
+/// </summary>
+/// <param name="pParameters"> the flight parameters </param>
+void RocketFlight::SetParameters(const RocketParameters& pParameters)
+{
+	mParameters = pParameters;
+}
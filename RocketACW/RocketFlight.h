@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include "RocketState.h"
+#include "RocketParameters.h"
+
+//Flight dynamics for a rocket under thrust, gravity and drag, integrated with RK4
+//While the fuel lasts the rocket pitches over at a fixed rate, once it is spent it turns to face along its velocity
+class RocketFlight
+{
+	struct RocketRate
+	{
+		float mVelocity[3];
+		float mAcceleration[3];
+		float mMassRate;
+		float mPitchRate;
+	};
+
+	RocketParameters mParameters;
+
+	RocketRate Rate(const RocketState& pState) const;
+	static RocketState Advance(const RocketState& pState, const RocketRate& pRate, const float pDt);
+
+public:
+	explicit RocketFlight(const RocketParameters& pParameters = RocketParameters());
+	~RocketFlight() = default;
+
+	RocketState Launch(const DirectX::XMFLOAT4& pPosition, const float pPitch) const;
+	void Step(RocketState& pState, const float pDt) const;
+	void Step(std::vector<RocketState>& pStates, const float pDt) const;
+
+	const RocketParameters& Parameters() const;
+	void SetParameters(const RocketParameters& pParameters);
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+//The constants of the flight model, in world units and simulated seconds
+struct RocketParameters
+{
+	float mThrust = 2.5f;
+	float mDryMass = 0.6f;
+	float mFuelMass = 0.4f;
+	float mBurnRate = 0.0667f;		//fuel mass burnt per second while thrusting
+	float mPitchRate = -0.1745f;	//radians per second the rocket pitches over while thrusting
+	float mDrag = 0.01f;			//quadratic drag, the force is mDrag * speed * velocity
+	float mGravity = 1.0f;
+};
@@ -0,0 +1,11 @@
+#pragma once
+#include <directxmath.h>
+
+//Everything the flight model needs to step a rocket, kept as plain data so many rockets can be stepped without a gameobject
+struct RocketState
+{
+	DirectX::XMFLOAT3 mPosition;
+	DirectX::XMFLOAT3 mVelocity;
+	float mMass;	//dry mass plus the fuel left
+	float mPitch;	//rotation about z, the angle the rocket is drawn at
+};
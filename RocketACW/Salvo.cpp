@@ -0,0 +1,289 @@
+#include "Salvo.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for an empty salvo
+/// </summary>
+/// <param name="pParameters"> the thrust, masses, drag and gravity every rocket flies with </param>
+Salvo::Salvo(const RocketParameters& pParameters) : mParameters(pParameters)
+{
+}
+
+/// <summary>
+/// Loads four rockets from the arrays into SIMD lanes
+/// </summary>
+/// <param name="pIndex"> the first of the four rockets, a multiple of four </param>
+/// <returns> the four rockets </returns>
+Salvo::Lanes Salvo::Load(const int pIndex) const
+{
+	Lanes lanes{};
+	lanes.mX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mX[pIndex]));
+	lanes.mY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mY[pIndex]));
+	lanes.mZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mZ[pIndex]));
+	lanes.mVelocityX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityX[pIndex]));
+	lanes.mVelocityY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityY[pIndex]));
+	lanes.mVelocityZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mVelocityZ[pIndex]));
+	lanes.mMass = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mMass[pIndex]));
+	lanes.mPitch = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&mPitch[pIndex]));
+	return lanes;
+}
+
+/// <summary>
+/// Stores four rockets from SIMD lanes back into the arrays
+/// </summary>
+/// <param name="pIndex"> the first of the four rockets, a multiple of four </param>
+/// <param name="pLanes"> the four rockets </param>
+void Salvo::Store(const int pIndex, const Lanes& pLanes)
+{
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mX[pIndex]), pLanes.mX);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mY[pIndex]), pLanes.mY);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mZ[pIndex]), pLanes.mZ);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityX[pIndex]), pLanes.mVelocityX);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityY[pIndex]), pLanes.mVelocityY);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mVelocityZ[pIndex]), pLanes.mVelocityZ);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mMass[pIndex]), pLanes.mMass);
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mPitch[pIndex]), pLanes.mPitch);
+}
+
+/// <summary>
+/// Finds how fast four rockets are changing, the same model as RocketFlight::Rate with the branches turned into selects
+/// </summary>
+/// <param name="pLanes"> the four rockets </param>
+/// <returns> the rate of change of each field, in the same lanes </returns>
+Salvo::Lanes Salvo::Rate(const Lanes& pLanes) const
+{
+	const auto zero = XMVectorZero();
+	const auto burning = XMVectorGreater(pLanes.mMass, XMVectorReplicate(mParameters.mDryMass));
+	const auto thrust = XMVectorSelect(zero, XMVectorReplicate(mParameters.mThrust), burning);
+	const auto speed = XMVectorSqrt(pLanes.mVelocityX * pLanes.mVelocityX + pLanes.mVelocityY * pLanes.mVelocityY + pLanes.mVelocityZ * pLanes.mVelocityZ);
+	const auto drag = XMVectorReplicate(mParameters.mDrag) * speed;
+	const auto inverseMass = XMVectorReciprocal(pLanes.mMass);
+
+	//the rockets up vectors after rotating about z by their pitch
+	XMVECTOR sine;
+	XMVECTOR cosine;
+	XMVectorSinCos(&sine, &cosine, pLanes.mPitch);
+
+	Lanes rate{};
+	rate.mX = pLanes.mVelocityX;
+	rate.mY = pLanes.mVelocityY;
+	rate.mZ = pLanes.mVelocityZ;
+	rate.mVelocityX = (-thrust * sine - drag * pLanes.mVelocityX) * inverseMass;
+	rate.mVelocityY = (thrust * cosine - drag * pLanes.mVelocityY) * inverseMass - XMVectorReplicate(mParameters.mGravity);
+	rate.mVelocityZ = -drag * pLanes.mVelocityZ * inverseMass;
+	rate.mMass = XMVectorSelect(zero, XMVectorReplicate(-mParameters.mBurnRate), burning);
+	rate.mPitch = XMVectorSelect(zero, XMVectorReplicate(mParameters.mPitchRate), burning);
+	return rate;
+}
+
+/// <summary>
+/// Moves four rockets along their rates of change for the given time
+/// </summary>
+/// <param name="pLanes"> the rockets to start from </param>
+/// <param name="pRate"> the rates of change to follow </param>
+/// <param name="pDt"> the time to follow them for </param>
+/// <returns> the moved rockets </returns>
+Salvo::Lanes Salvo::Advance(const Lanes& pLanes, const Lanes& pRate, const float pDt)
+{
+	const auto dt = XMVectorReplicate(pDt);
+	Lanes lanes{};
+	lanes.mX = XMVectorMultiplyAdd(pRate.mX, dt, pLanes.mX);
+	lanes.mY = XMVectorMultiplyAdd(pRate.mY, dt, pLanes.mY);
+	lanes.mZ = XMVectorMultiplyAdd(pRate.mZ, dt, pLanes.mZ);
+	lanes.mVelocityX = XMVectorMultiplyAdd(pRate.mVelocityX, dt, pLanes.mVelocityX);
+	lanes.mVelocityY = XMVectorMultiplyAdd(pRate.mVelocityY, dt, pLanes.mVelocityY);
+	lanes.mVelocityZ = XMVectorMultiplyAdd(pRate.mVelocityZ, dt, pLanes.mVelocityZ);
+	lanes.mMass = XMVectorMultiplyAdd(pRate.mMass, dt, pLanes.mMass);
+	lanes.mPitch = XMVectorMultiplyAdd(pRate.mPitch, dt, pLanes.mPitch);
+	return lanes;
+}
+
+/// <summary>
+/// Adds rockets to the salvo, spread evenly across a line and fanned between two pitches
+/// </summary>
+/// <param name="pPosition"> the middle of the line the rockets launch from </param>
+/// <param name="pCount"> the number of rockets to add </param>
+/// <param name="pWidth"> the length of the line along z </param>
+/// <param name="pMinPitch"> the lowest pitch a rocket is launched at </param>
+/// <param name="pMaxPitch"> the highest pitch a rocket is launched at </param>
+void Salvo::Launch(const XMFLOAT4& pPosition, const int pCount, const float pWidth, const float pMinPitch, const float pMaxPitch)
+{
+	const auto first = mCount;
+	mCount += pCount;
+	const auto lanes = static_cast<size_t>((mCount + 3) & ~3);
+	for (auto* array : { &mX, &mY, &mZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mPitch, &mLastX, &mLastY, &mLastZ, &mLastPitch })
+	{
+		array->resize(lanes, 0.0f);
+	}
+	//the unused lanes are given a mass so they never divide by zero
+	mMass.resize(lanes, mParameters.mDryMass);
+
+	for (auto i = 0; i < pCount; ++i)
+	{
+		//the pitch steps by the golden ratio so neighbouring rockets fly different paths
+		const auto along = pCount > 1 ? static_cast<float>(i) / (pCount - 1) - 0.5f : 0.0f;
+		const auto fan = fmodf(i * 0.618034f, 1.0f);
+		const auto rocket = first + i;
+		mX[rocket] = pPosition.x;
+		mY[rocket] = pPosition.y;
+		mZ[rocket] = pPosition.z + along * pWidth;
+		mVelocityX[rocket] = 0;
+		mVelocityY[rocket] = 0;
+		mVelocityZ[rocket] = 0;
+		mMass[rocket] = mParameters.mDryMass + mParameters.mFuelMass;
+		mPitch[rocket] = pMinPitch + (pMaxPitch - pMinPitch) * fan;
+		mLastX[rocket] = mX[rocket];
+		mLastY[rocket] = mY[rocket];
+		mLastZ[rocket] = mZ[rocket];
+		mLastPitch[rocket] = mPitch[rocket];
+	}
+}
+
+/// <summary>
+/// Steps every rocket forward with fourth order Runge-Kutta, four at a time
+/// </summary>
+/// <param name="pDt"> the length of the step in simulated seconds </param>
+void Salvo::Step(const float pDt)
+{
+	const auto dryMass = XMVectorReplicate(mParameters.mDryMass);
+	const auto stopped = XMVectorReplicate(1e-6f);
+	const auto sixth = XMVectorReplicate(1.0f / 6);
+	const auto two = XMVectorReplicate(2.0f);
+	for (auto i = 0; i < mCount; i += 4)
+	{
+		auto lanes = Load(i);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mLastX[i]), lanes.mX);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mLastY[i]), lanes.mY);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mLastZ[i]), lanes.mZ);
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&mLastPitch[i]), lanes.mPitch);
+
+		const auto k1 = Rate(lanes);
+		const auto k2 = Rate(Advance(lanes, k1, pDt * 0.5f));
+		const auto k3 = Rate(Advance(lanes, k2, pDt * 0.5f));
+		const auto k4 = Rate(Advance(lanes, k3, pDt));
+
+		Lanes rate{};
+		rate.mX = (k1.mX + two * (k2.mX + k3.mX) + k4.mX) * sixth;
+		rate.mY = (k1.mY + two * (k2.mY + k3.mY) + k4.mY) * sixth;
+		rate.mZ = (k1.mZ + two * (k2.mZ + k3.mZ) + k4.mZ) * sixth;
+		rate.mVelocityX = (k1.mVelocityX + two * (k2.mVelocityX + k3.mVelocityX) + k4.mVelocityX) * sixth;
+		rate.mVelocityY = (k1.mVelocityY + two * (k2.mVelocityY + k3.mVelocityY) + k4.mVelocityY) * sixth;
+		rate.mVelocityZ = (k1.mVelocityZ + two * (k2.mVelocityZ + k3.mVelocityZ) + k4.mVelocityZ) * sixth;
+		rate.mMass = (k1.mMass + two * (k2.mMass + k3.mMass) + k4.mMass) * sixth;
+		rate.mPitch = (k1.mPitch + two * (k2.mPitch + k3.mPitch) + k4.mPitch) * sixth;
+		lanes = Advance(lanes, rate, pDt);
+
+		//the rockets which have burnt out turn to face the way they are moving
+		lanes.mMass = XMVectorMax(lanes.mMass, dryMass);
+		const auto moving = XMVectorGreater(lanes.mVelocityX * lanes.mVelocityX + lanes.mVelocityY * lanes.mVelocityY, stopped);
+		const auto coasting = XMVectorAndInt(XMVectorLessOrEqual(lanes.mMass, dryMass), moving);
+		lanes.mPitch = XMVectorSelect(lanes.mPitch, XMVectorATan2(XMVectorNegate(lanes.mVelocityX), lanes.mVelocityY), coasting);
+
+		Store(i, lanes);
+	}
+}
+
+/// <summary>
+/// Sweeps every rocket along its last step through the terrain, rockets which hit it or fall below the floor are removed
+/// </summary>
+/// <param name="pStore"> the terrain to collide with </param>
+/// <param name="pWorldToGrid"> the transform from world space into the grid </param>
+/// <param name="pRadius"> the radius of a rocket in grid cells </param>
+/// <param name="pFloor"> the height in world space below which a rocket is lost </param>
+/// <param name="pImpacts"> filled with the grid position of each impact </param>
+void Salvo::Collide(const VoxelStore& pStore, const XMFLOAT4X4& pWorldToGrid, const float pRadius, const float pFloor, vector<XMFLOAT3>& pImpacts)
+{
+	pImpacts.clear();
+	const auto worldToGrid = XMLoadFloat4x4(&pWorldToGrid);
+	for (auto i = 0; i < mCount;)
+	{
+		XMFLOAT3 from{};
+		XMFLOAT3 to{};
+		XMStoreFloat3(&from, XMVector3TransformCoord(XMVectorSet(mLastX[i], mLastY[i], mLastZ[i], 1), worldToGrid));
+		XMStoreFloat3(&to, XMVector3TransformCoord(XMVectorSet(mX[i], mY[i], mZ[i], 1), worldToGrid));
+
+		VoxelHit hit{};
+		if (pStore.SweepSphere(from, to, pRadius, hit))
+		{
+			XMFLOAT3 impact{};
+			XMStoreFloat3(&impact, XMVectorLerp(XMLoadFloat3(&from), XMLoadFloat3(&to), hit.mTime));
+			pImpacts.push_back(impact);
+			RemoveRocket(i);
+		}
+		else if (mY[i] < pFloor)
+		{
+			RemoveRocket(i);
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+/// <summary>
+/// Removes a rocket by moving the last rocket into its place
+/// </summary>
+/// <param name="pIndex"> the rocket to remove </param>
+void Salvo::RemoveRocket(const int pIndex)
+{
+	const auto last = --mCount;
+	for (auto* array : { &mX, &mY, &mZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mMass, &mPitch, &mLastX, &mLastY, &mLastZ, &mLastPitch })
+	{
+		(*array)[pIndex] = (*array)[last];
+	}
+}
+
+/// <summary>
+/// Writes the position and pitch of every rocket as an instance so the salvo is drawn in one call
+/// Each rocket is blended between the start and the end of the last step, in the same way as the single rocket
+/// </summary>
+/// <param name="pInstances"> filled with one instance per rocket </param>
+/// <param name="pAlpha"> how far past the start of the last step to draw, from 0 to 1 </param>
+void Salvo::Instances(vector<PitchedInstance>& pInstances, const float pAlpha) const
+{
+	pInstances.resize(mCount);
+	for (auto i = 0; i < mCount; ++i)
+	{
+		pInstances[i].mPosition = XMFLOAT3(mLastX[i] + (mX[i] - mLastX[i]) * pAlpha, mLastY[i] + (mY[i] - mLastY[i]) * pAlpha, mLastZ[i] + (mZ[i] - mLastZ[i]) * pAlpha);
+		pInstances[i].mPitch = mLastPitch[i] + (mPitch[i] - mLastPitch[i]) * pAlpha;
+	}
+}
+
+/// <summary>
+/// Removes every rocket, the arrays keep their memory for the next salvo
+/// </summary>
+void Salvo::Clear()
+{
+	mCount = 0;
+}
+
+/// <summary>
+/// Accessor for the number of rockets in flight
+/// </summary>
+/// <returns> the number of rockets </returns>
+const int Salvo::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Accessor for the constants of the flight model
+/// </summary>
+/// <returns> the flight parameters </returns>
+const RocketParameters& Salvo::Parameters() const
+{
+	return mParameters;
+}
+
+/// <summary>
+/// Sets the constants of the flight model
+/// </summary>
+/// <param name="pParameters"> the flight parameters </param>
+void Salvo::SetParameters(const RocketParameters& pParameters)
+{
+	mParameters = pParameters;
+}
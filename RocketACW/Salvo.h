@@ -0,0 +1,58 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include "RocketParameters.h"
+#include "VoxelStore.h"
+#include "PitchedInstance.h"
+
+//A salvo of rockets flown with the same model as RocketFlight, stored as structure of arrays so four rockets are stepped by each SIMD instruction
+//The arrays are kept a multiple of four long, the lanes past the last rocket are stepped but never read
+class Salvo
+{
+	struct Lanes
+	{
+		DirectX::XMVECTOR mX;
+		DirectX::XMVECTOR mY;
+		DirectX::XMVECTOR mZ;
+		DirectX::XMVECTOR mVelocityX;
+		DirectX::XMVECTOR mVelocityY;
+		DirectX::XMVECTOR mVelocityZ;
+		DirectX::XMVECTOR mMass;
+		DirectX::XMVECTOR mPitch;
+	};
+
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<float> mZ;
+	std::vector<float> mVelocityX;
+	std::vector<float> mVelocityY;
+	std::vector<float> mVelocityZ;
+	std::vector<float> mMass;
+	std::vector<float> mPitch;
+	std::vector<float> mLastX;	//where each rocket started the last step, so its collision can be swept and it can be drawn between steps
+	std::vector<float> mLastY;
+	std::vector<float> mLastZ;
+	std::vector<float> mLastPitch;
+	int mCount = 0;
+	RocketParameters mParameters;
+
+	Lanes Load(const int pIndex) const;
+	void Store(const int pIndex, const Lanes& pLanes);
+	Lanes Rate(const Lanes& pLanes) const;
+	static Lanes Advance(const Lanes& pLanes, const Lanes& pRate, const float pDt);
+	void RemoveRocket(const int pIndex);
+
+public:
+	explicit Salvo(const RocketParameters& pParameters = RocketParameters());
+	~Salvo() = default;
+
+	void Launch(const DirectX::XMFLOAT4& pPosition, const int pCount, const float pWidth, const float pMinPitch, const float pMaxPitch);
+	void Step(const float pDt);
+	void Collide(const VoxelStore& pStore, const DirectX::XMFLOAT4X4& pWorldToGrid, const float pRadius, const float pFloor, std::vector<DirectX::XMFLOAT3>& pImpacts);
+	void Instances(std::vector<PitchedInstance>& pInstances, const float pAlpha) const;
+	void Clear();
+
+	const int Count() const;
+	const RocketParameters& Parameters() const;
+	void SetParameters(const RocketParameters& pParameters);
+};
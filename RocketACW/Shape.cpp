@@ -1,4 +1,8 @@
 #include "Shape.h"
+#include "AllocationCounter.h"
+#include <unordered_set>
+#include <cstring>
+#include <cfloat>
 
 using namespace DirectX;
 using namespace std;
@@ -17,9 +21,11 @@ using namespace std;
 /// <param name="pIsEnvironment"> bool which marks if this shape is an environment map </param>
 /// <param name="pBlended"> bool which marks if this shape should be alpha blended </param>
 /// <param name="pGeometryType"> the type of the geometry </param>
+/// <param name="pInstanceFormat"> how the instances are stored, packed instances must sit on the grid between 0 and 1023 </param>
 Shape::Shape(const std::vector<Instance> * const pInstances, const XMFLOAT4& pScale, const XMFLOAT4& pRotation, const XMFLOAT4& pTranslation,
 	const wstring& pDiffuseTex, const wstring& pNormalMap, const wstring& pHeightMap,
-	const wstring& pShader, const string& pName, const bool& pIsEnvironment, const bool& pBlended, const GeometryType& pGeometryType) :
+	const wstring& pShader, const string& pName, const bool& pIsEnvironment, const bool& pBlended, const GeometryType& pGeometryType, const InstanceFormat& pInstanceFormat) :
+	mInstanceFormat(pInstanceFormat),
 	mScale(pScale),
 	mRotation(pRotation),
 	mTranslation(pTranslation),
@@ -34,10 +40,42 @@ Shape::Shape(const std::vector<Instance> * const pInstances, const XMFLOAT4& pSc
 {
 	if (pInstances)
 	{
-		mInstances = *pInstances;
+		if (mInstanceFormat == InstanceFormat::PACKED)
+		{
+			mPackedInstances.reserve(pInstances->size());
+			for (const auto& instance : *pInstances)
+			{
+				mPackedInstances.push_back(PackInstance(instance));
+			}
+		}
+		else if (mInstanceFormat == InstanceFormat::PARTICLE)
+		{
+			//particles start with no size, so they are invisible until the first update
+			mParticleInstances.reserve(pInstances->size());
+			for (const auto& instance : *pInstances)
+			{
+				mParticleInstances.push_back(ParticleInstance{ instance.mPosition, 0 });
+			}
+		}
+		else if (mInstanceFormat == InstanceFormat::PITCHED)
+		{
+			mPitchedInstances.reserve(pInstances->size());
+			for (const auto& instance : *pInstances)
+			{
+				mPitchedInstances.push_back(PitchedInstance{ instance.mPosition, 0 });
+			}
+		}
+		else
+		{
+			mInstances = *pInstances;
+		}
+		mInstanced = true;
+		mInstanceVersion = NextVersion();
+		mBaseInstanceVersion = mInstanceVersion;
 	}
 	SetGeometry(mGeometryType);
 	SetTransform();
+	CalculateBounds();
 }
 
 /// <summary>
@@ -115,7 +153,7 @@ const std::vector<WORD>& Shape::Indices() const
 /// <summary>
 /// Returns a list of instances
 /// </summary>
-/// <returns> a list of instances - this list is empty if the shape does not have instancing enabled </returns>
+/// <returns> a list of instances - this list is empty if the shape does not have instancing enabled or its instances are packed </returns>
 const std::vector<Instance>& Shape::Instances() const
 {
 	return mInstances;
@@ -187,13 +225,35 @@ const bool Shape::IsBlended() const
 /// <summary>
 /// Removes the instances marked by the parameter from the instance list
 /// </summary>
-/// <param name="pIndexToDelete"> a vector containing all of the indices of the instances which must be deleted </param>
-void Shape::RemoveInstances(const std::vector<Instance>& pIndexToDelete)
+/// <param name="pIndexToDelete"> a vector containing all of the instances which must be deleted </param>
+/// <param name="pMode"> whether the order of the remaining instances must be kept </param>
+void Shape::RemoveInstances(const std::vector<Instance>& pIndexToDelete, const RemovalMode pMode)
 {
-	for (auto& index : pIndexToDelete)
+	vector<uint64_t> keys;
+	keys.reserve(pIndexToDelete.size());
+	for (const auto& instance : pIndexToDelete)
 	{
-		mInstances.erase(remove(mInstances.begin(), mInstances.end(), index), mInstances.end());
+		keys.push_back(InstanceKey(instance));
 	}
+	RemoveInstances(keys, pMode);
+}
+
+/// <summary>
+/// Removes every instance whose grid key is in the list - a hash set makes the whole batch a single O(N + K) pass
+/// </summary>
+/// <param name="pKeysToDelete"> the keys of the instances to delete </param>
+/// <param name="pMode"> whether the order of the remaining instances must be kept </param>
+void Shape::RemoveInstances(const std::vector<uint64_t>& pKeysToDelete, const RemovalMode pMode)
+{
+	if (pKeysToDelete.empty())
+	{
+		return;
+	}
+	const unordered_set<uint64_t> keys(pKeysToDelete.begin(), pKeysToDelete.end());
+	RemoveInstancesIf([&keys](const Instance& pInstance)
+	{
+		return keys.count(InstanceKey(pInstance)) > 0;
+	}, pMode);
 }
 
 /// <summary>
@@ -202,7 +262,372 @@ void Shape::RemoveInstances(const std::vector<Instance>& pIndexToDelete)
 /// <param name="pInstances"> the list of instances to set </param>
 void Shape::SetInstances(const std::vector<Instance>& pInstances)
 {
+	if (mInstanceFormat == InstanceFormat::PACKED)
+	{
+		SetPackedInstances(pInstances);
+		return;
+	}
+
+	const AllocationFreeScope allocationFree(InstancesGrow(pInstances.size(), mInstances.capacity()));
+	//only the span between the first and last instance which differ has to be uploaded again
+	const auto common = min(mInstances.size(), pInstances.size());
+	size_t first = 0;
+	while (first < common && memcmp(&mInstances[first], &pInstances[first], sizeof(Instance)) == 0)
+	{
+		++first;
+	}
+	auto last = pInstances.size();
+	if (last == common)
+	{
+		while (last > first && memcmp(&mInstances[last - 1], &pInstances[last - 1], sizeof(Instance)) == 0)
+		{
+			--last;
+		}
+	}
+
 	mInstances = pInstances;
+	MarkInstancesDirty(first, last);
+	CalculateBounds();
+}
+
+/// <summary>
+/// Sets the particles drawn by a PARTICLE shape - every particle moves every update, so the whole list is dirtied without comparing it
+/// The storage keeps its capacity when fewer particles are set, so a shape filled once to its largest size never allocates again
+/// </summary>
+/// <param name="pInstances"> the particles to set </param>
+void Shape::SetParticleInstances(const std::vector<ParticleInstance>& pInstances)
+{
+	const AllocationFreeScope allocationFree(InstancesGrow(pInstances.size(), mParticleInstances.capacity()));
+	mParticleInstances = pInstances;
+	MarkInstancesDirty(0, mParticleInstances.size());
+	CalculateBounds();
+}
+
+/// <summary>
+/// Sets the instances drawn by a PITCHED shape - they are moved every step, so the whole list is dirtied without comparing it
+/// The storage keeps its capacity when fewer instances are set, so a shape filled once to its largest size never allocates again
+/// </summary>
+/// <param name="pInstances"> the instances to set </param>
+void Shape::SetPitchedInstances(const std::vector<PitchedInstance>& pInstances)
+{
+	const AllocationFreeScope allocationFree(InstancesGrow(pInstances.size(), mPitchedInstances.capacity()));
+	mPitchedInstances = pInstances;
+	MarkInstancesDirty(0, mPitchedInstances.size());
+	CalculateBounds();
+}
+
+/// <summary>
+/// Packs the list of instances into the shape, comparing the packed words so only the span which changed is dirtied
+/// </summary>
+/// <param name="pInstances"> the list of instances to pack </param>
+void Shape::SetPackedInstances(const std::vector<Instance>& pInstances)
+{
+	const AllocationFreeScope allocationFree(InstancesGrow(pInstances.size(), mPackedInstances.capacity()));
+	const auto common = min(mPackedInstances.size(), pInstances.size());
+	size_t first = 0;
+	while (first < common && mPackedInstances[first].mPacked == PackInstance(pInstances[first]).mPacked)
+	{
+		++first;
+	}
+	auto last = pInstances.size();
+	if (last == common)
+	{
+		while (last > first && mPackedInstances[last - 1].mPacked == PackInstance(pInstances[last - 1]).mPacked)
+		{
+			--last;
+		}
+	}
+
+	mPackedInstances.resize(pInstances.size());
+	for (auto i = first; i < last; ++i)
+	{
+		mPackedInstances[i] = PackInstance(pInstances[i]);
+	}
+	MarkInstancesDirty(first, last);
+	CalculateBounds();
+}
+
+/// <summary>
+/// Records that the instances in [pFirst, pLast) have changed and moves the shape onto a new instance version
+/// </summary>
+/// <param name="pFirst"> the first modified instance </param>
+/// <param name="pLast"> one past the last modified instance </param>
+void Shape::MarkInstancesDirty(const size_t pFirst, const size_t pLast)
+{
+	if (pFirst >= pLast)
+	{
+		return;
+	}
+	mInstanceVersion = NextVersion();
+
+	//once the list is full the two oldest ranges are folded into one with the newer of their versions, the list is kept oldest first
+	//a buffer which already holds that version skips the fold, so only a buffer left more than the whole list behind uploads a little extra
+	if (mDirtyRanges.size() >= MAX_DIRTY_RANGES)
+	{
+		auto& oldest = mDirtyRanges[0];
+		const auto& next = mDirtyRanges[1];
+		oldest.mFirst = min(oldest.mFirst, next.mFirst);
+		oldest.mLast = max(oldest.mLast, next.mLast);
+		oldest.mVersion = next.mVersion;
+		mDirtyRanges.erase(mDirtyRanges.begin() + 1);
+	}
+	mDirtyRanges.push_back(InstanceRange{ static_cast<unsigned int>(pFirst), static_cast<unsigned int>(pLast), mInstanceVersion });
+}
+
+/// <summary>
+/// Gets whether setting instances would grow the instances or the dirty ranges past the largest size they have held, the only time setting instances may allocate
+/// </summary>
+/// <param name="pCount"> the number of instances about to be set </param>
+/// <param name="pCapacity"> the capacity of the list they are set into </param>
+/// <returns> true if either list would grow </returns>
+const bool Shape::InstancesGrow(const size_t pCount, const size_t pCapacity) const
+{
+	return pCount > pCapacity || (mDirtyRanges.size() < MAX_DIRTY_RANGES && mDirtyRanges.size() == mDirtyRanges.capacity());
+}
+
+/// <summary>
+/// Replaces the vertices and indices of a MESH shape
+/// </summary>
+/// <param name="pVertices"> the new vertices </param>
+/// <param name="pIndices"> the new indices </param>
+void Shape::SetMesh(const std::vector<SimpleVertex>& pVertices, const std::vector<WORD>& pIndices)
+{
+	mVertices = pVertices;
+	mIndices = pIndices;
+	mMeshVersion = NextVersion();
+	CalculateBounds();
+}
+
+/// <summary>
+/// Finds the box around the shape before its transform is applied - the box around the vertices, widened by the box around the instance offsets
+/// A shape with nothing to draw gets an empty box with its min above its max
+/// </summary>
+void Shape::CalculateBounds()
+{
+	mBoundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	mBoundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	if (mVertices.empty() || (mInstanced && InstanceCount() == 0))
+	{
+		return;
+	}
+
+	auto boundsMin = XMLoadFloat3(&mBoundsMin);
+	auto boundsMax = XMLoadFloat3(&mBoundsMax);
+	for (const auto& vertex : mVertices)
+	{
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&vertex.mPos));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&vertex.mPos));
+	}
+
+	if (mInstanced)
+	{
+		auto instanceMin = XMVectorReplicate(FLT_MAX);
+		auto instanceMax = XMVectorReplicate(-FLT_MAX);
+		if (IsPacked())
+		{
+			for (const auto& instance : mPackedInstances)
+			{
+				const auto position = XMVectorSet(static_cast<float>(PackedX(instance)), static_cast<float>(PackedY(instance)), static_cast<float>(PackedZ(instance)), 0);
+				instanceMin = XMVectorMin(instanceMin, position);
+				instanceMax = XMVectorMax(instanceMax, position);
+			}
+		}
+		else if (mInstanceFormat == InstanceFormat::PARTICLE)
+		{
+			for (const auto& instance : mParticleInstances)
+			{
+				instanceMin = XMVectorMin(instanceMin, XMLoadFloat3(&instance.mPosition));
+				instanceMax = XMVectorMax(instanceMax, XMLoadFloat3(&instance.mPosition));
+			}
+		}
+		else if (mInstanceFormat == InstanceFormat::PITCHED)
+		{
+			for (const auto& instance : mPitchedInstances)
+			{
+				instanceMin = XMVectorMin(instanceMin, XMLoadFloat3(&instance.mPosition));
+				instanceMax = XMVectorMax(instanceMax, XMLoadFloat3(&instance.mPosition));
+			}
+		}
+		else
+		{
+			for (const auto& instance : mInstances)
+			{
+				instanceMin = XMVectorMin(instanceMin, XMLoadFloat3(&instance.mPosition));
+				instanceMax = XMVectorMax(instanceMax, XMLoadFloat3(&instance.mPosition));
+			}
+		}
+		boundsMin += instanceMin;
+		boundsMax += instanceMax;
+	}
+	XMStoreFloat3(&mBoundsMin, boundsMin);
+	XMStoreFloat3(&mBoundsMax, boundsMax);
+}
+
+/// <summary>
+/// Gets a new version number for instances or meshes - every shape shares one counter so a new shape reusing an old name never matches stale buffers
+/// </summary>
+/// <returns> a version which has not been handed out before </returns>
+unsigned int Shape::NextVersion()
+{
+	static unsigned int sVersion = 0;
+	return ++sVersion;
+}
+
+/// <summary>
+/// Checks if the shape was created with instances, an instanced shape with no instances left draws nothing
+/// </summary>
+/// <returns> true if the shape is drawn with instancing </returns>
+const bool Shape::IsInstanced() const
+{
+	return mInstanced;
+}
+
+/// <summary>
+/// Gets the minimum corner of the box around the shape, in the shapes own space
+/// </summary>
+/// <returns> the minimum corner, above the maximum if the shape is empty </returns>
+const DirectX::XMFLOAT3& Shape::BoundsMin() const
+{
+	return mBoundsMin;
+}
+
+/// <summary>
+/// Gets the maximum corner of the box around the shape, in the shapes own space
+/// </summary>
+/// <returns> the maximum corner </returns>
+const DirectX::XMFLOAT3& Shape::BoundsMax() const
+{
+	return mBoundsMax;
+}
+
+/// <summary>
+/// Checks if the instances are stored in the packed 10:10:10:2 format
+/// </summary>
+/// <returns> true if the instances are packed </returns>
+const bool Shape::IsPacked() const
+{
+	return mInstanceFormat == InstanceFormat::PACKED;
+}
+
+/// <summary>
+/// Accessor for how the instances are stored and sent to the GPU
+/// </summary>
+/// <returns> the format of the instances </returns>
+const InstanceFormat Shape::Format() const
+{
+	return mInstanceFormat;
+}
+
+/// <summary>
+/// Gets the number of instances whichever format they are stored in
+/// </summary>
+/// <returns> the number of instances </returns>
+const size_t Shape::InstanceCount() const
+{
+	switch (mInstanceFormat)
+	{
+	case InstanceFormat::PACKED:
+		return mPackedInstances.size();
+	case InstanceFormat::PARTICLE:
+		return mParticleInstances.size();
+	case InstanceFormat::PITCHED:
+		return mPitchedInstances.size();
+	default:
+		return mInstances.size();
+	}
+}
+
+/// <summary>
+/// Gets the size of one instance as it is sent to the GPU
+/// </summary>
+/// <returns> the instance stride in bytes </returns>
+const unsigned int Shape::InstanceStride() const
+{
+	switch (mInstanceFormat)
+	{
+	case InstanceFormat::PACKED:
+		return sizeof(PackedInstance);
+	case InstanceFormat::PARTICLE:
+		return sizeof(ParticleInstance);
+	case InstanceFormat::PITCHED:
+		return sizeof(PitchedInstance);
+	default:
+		return sizeof(Instance);
+	}
+}
+
+/// <summary>
+/// Gets the instances as they are sent to the GPU
+/// </summary>
+/// <returns> a pointer to the first instance, InstanceCount() instances of InstanceStride() bytes follow it </returns>
+const void* Shape::InstanceData() const
+{
+	switch (mInstanceFormat)
+	{
+	case InstanceFormat::PACKED:
+		return mPackedInstances.data();
+	case InstanceFormat::PARTICLE:
+		return mParticleInstances.data();
+	case InstanceFormat::PITCHED:
+		return mPitchedInstances.data();
+	default:
+		return mInstances.data();
+	}
+}
+
+/// <summary>
+/// Gets the number of instances the shape can hold before its storage, and the buffer the renderer sizes to match it, have to grow
+/// </summary>
+/// <returns> the capacity of the instance storage </returns>
+const size_t Shape::InstanceCapacity() const
+{
+	switch (mInstanceFormat)
+	{
+	case InstanceFormat::PACKED:
+		return mPackedInstances.capacity();
+	case InstanceFormat::PARTICLE:
+		return mParticleInstances.capacity();
+	case InstanceFormat::PITCHED:
+		return mPitchedInstances.capacity();
+	default:
+		return mInstances.capacity();
+	}
+}
+
+/// <summary>
+/// Gets a counter which changes every time the instances are modified so the renderer knows when to upload them
+/// </summary>
+/// <returns> the version of the instances </returns>
+const unsigned int Shape::InstanceVersion() const
+{
+	return mInstanceVersion;
+}
+
+/// <summary>
+/// Gets the version the shapes instances were created with, the dirty ranges only describe changes made after it
+/// </summary>
+/// <returns> the first instance version of the shape </returns>
+const unsigned int Shape::BaseInstanceVersion() const
+{
+	return mBaseInstanceVersion;
+}
+
+/// <summary>
+/// Gets the runs of instances which have changed, each tagged with the version it was changed in
+/// </summary>
+/// <returns> a list of dirty ranges </returns>
+const std::vector<InstanceRange>& Shape::DirtyInstanceRanges() const
+{
+	return mDirtyRanges;
+}
+
+/// <summary>
+/// Gets a counter which changes every time the mesh is replaced so the renderer knows when to rebuild its buffers
+/// </summary>
+/// <returns> the version of the mesh </returns>
+const unsigned int Shape::MeshVersion() const
+{
+	return mMeshVersion;
 }
 
 /// <summary>
@@ -244,6 +669,8 @@ void Shape::SetGeometry(const GeometryType pGeoType)
 	case GeometryType::QUAD:
 		SetQuad();
 		break;
+	case GeometryType::MESH:
+		break;
 	}
 }
 
@@ -5,6 +5,12 @@
 #include "windows.h"
 #include "SimpleVertex.h"
 #include "Instance.h"
+#include "PackedInstance.h"
+#include "ParticleInstance.h"
+#include "PitchedInstance.h"
+#include "InstanceFormat.h"
+#include "InstanceRange.h"
+#include "RemovalMode.h"
 #include <algorithm>
 
 class Shape
@@ -13,6 +19,17 @@ class Shape
 	std::vector<SimpleVertex> mVertices;
 	std::vector<WORD> mIndices;
 	std::vector<Instance> mInstances;
+	std::vector<PackedInstance> mPackedInstances;
+	std::vector<ParticleInstance> mParticleInstances;
+	std::vector<PitchedInstance> mPitchedInstances;
+	InstanceFormat mInstanceFormat = InstanceFormat::FLOAT3;
+	bool mInstanced = false;
+	unsigned int mInstanceVersion = 0;
+	unsigned int mBaseInstanceVersion = 0;
+	std::vector<InstanceRange> mDirtyRanges;
+	unsigned int mMeshVersion = 0;
+	DirectX::XMFLOAT3 mBoundsMin{};
+	DirectX::XMFLOAT3 mBoundsMax{};
 
 	DirectX::XMFLOAT4X4 mTransform{};
 	DirectX::XMFLOAT4 mScale;
@@ -37,8 +54,43 @@ class Shape
 	void SetQuad();
 
 	void SetTransform();
+	static unsigned int NextVersion();
+	void MarkInstancesDirty(const size_t pFirst, const size_t pLast);
+	const bool InstancesGrow(const size_t pCount, const size_t pCapacity) const;
+	void SetPackedInstances(const std::vector<Instance>& pInstances);
+	void CalculateBounds();
+
+	template <typename T, typename Predicate>
+	void RemoveInstancesFrom(std::vector<T>& pInstances, Predicate pPredicate, const RemovalMode pMode)
+	{
+		//nothing before the first removed instance moves, so only the instances after it are dirtied
+		const auto first = static_cast<size_t>(std::find_if(pInstances.begin(), pInstances.end(), pPredicate) - pInstances.begin());
+		if (pMode == RemovalMode::PRESERVE_ORDER)
+		{
+			pInstances.erase(std::remove_if(pInstances.begin() + first, pInstances.end(), pPredicate), pInstances.end());
+			MarkInstancesDirty(first, pInstances.size());
+			CalculateBounds();
+			return;
+		}
+		for (auto i = first; i < pInstances.size();)
+		{
+			if (pPredicate(pInstances[i]))
+			{
+				pInstances[i] = pInstances.back();
+				pInstances.pop_back();
+			}
+			else
+			{
+				++i;
+			}
+		}
+		MarkInstancesDirty(first, pInstances.size());
+		CalculateBounds();
+	}
 
 public:
+	static const size_t MAX_DIRTY_RANGES = 16;
+
 	Shape(const std::vector<Instance> * const pInstances,
 		const DirectX::XMFLOAT4& pScale,
 		const DirectX::XMFLOAT4& pRotation,
@@ -50,13 +102,17 @@ public:
 		const std::string& pName,
 		const bool& pIsEnvironment,
 		const bool& pBlended,
-		const GeometryType& pGeometryType
+		const GeometryType& pGeometryType,
+		const InstanceFormat& pInstanceFormat = InstanceFormat::FLOAT3
 	);
 
 	~Shape() = default;
 
+	//shapes own their vertices and instances, so they are moved rather than copied
 	Shape& operator=(const Shape& pShape) = delete;
-	//Shape(const Shape& pShape) = delete;
+	Shape(const Shape& pShape) = delete;
+	Shape& operator=(Shape&& pShape) = default;
+	Shape(Shape&& pShape) = default;
 
 	const DirectX::XMFLOAT4X4 * const Transform() const;
 	void Translate(const DirectX::XMFLOAT4& pTranslation);
@@ -74,8 +130,40 @@ public:
 	const std::string& Name() const;
 	const bool IsEnvironment() const;
 	const bool IsBlended() const;
-	void RemoveInstances(const std::vector<Instance>& pIndexToDelete);
+	const bool IsInstanced() const;
+	const bool IsPacked() const;
+	const InstanceFormat Format() const;
+	const size_t InstanceCount() const;
+	const size_t InstanceCapacity() const;
+	const unsigned int InstanceStride() const;
+	const void* InstanceData() const;
+	const unsigned int InstanceVersion() const;
+	const unsigned int BaseInstanceVersion() const;
+	const std::vector<InstanceRange>& DirtyInstanceRanges() const;
+	const DirectX::XMFLOAT3& BoundsMin() const;
+	const DirectX::XMFLOAT3& BoundsMax() const;
+	void RemoveInstances(const std::vector<Instance>& pIndexToDelete, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER);
+	void RemoveInstances(const std::vector<uint64_t>& pKeysToDelete, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER);
+
+	//Removes every instance matching the predicate in a single pass, packed instances are unpacked for the predicate
+	template <typename Predicate>
+	void RemoveInstancesIf(Predicate pPredicate, const RemovalMode pMode = RemovalMode::PRESERVE_ORDER)
+	{
+		if (mInstanceFormat == InstanceFormat::PACKED)
+		{
+			RemoveInstancesFrom(mPackedInstances, [&pPredicate](const PackedInstance& pInstance)
+			{
+				return pPredicate(UnpackInstance(pInstance));
+			}, pMode);
+			return;
+		}
+		RemoveInstancesFrom(mInstances, pPredicate, pMode);
+	}
 	void SetInstances(const std::vector<Instance>& pInstances);
+	void SetParticleInstances(const std::vector<ParticleInstance>& pInstances);
+	void SetPitchedInstances(const std::vector<PitchedInstance>& pInstances);
+	void SetMesh(const std::vector<SimpleVertex>& pVertices, const std::vector<WORD>& pIndices);
+	const unsigned int MeshVersion() const;
 	void SetRotation(const DirectX::XMFLOAT4& pRotation);
 };
 
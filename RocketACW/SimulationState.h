@@ -0,0 +1,10 @@
+#pragma once
+#include <directxmath.h>
+
+//The parts of the scene moved by the fixed step simulation, kept for the last two steps so rendering can blend between them
+struct SimulationState
+{
+	DirectX::XMFLOAT4 mRocketTranslation;
+	DirectX::XMFLOAT4 mRocketRotation;
+	float mDayAngle;
+};
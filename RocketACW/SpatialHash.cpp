@@ -0,0 +1,431 @@
+#include "SpatialHash.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Checks if two boxes overlap, touching counts as overlapping
+/// </summary>
+/// <param name="pA"> the first box </param>
+/// <param name="pMin"> the minimum corner of the second box </param>
+/// <param name="pMax"> the maximum corner of the second box </param>
+/// <returns> true if the boxes overlap, an empty box overlaps nothing </returns>
+static bool Overlaps(const SpatialProxy& pA, const XMFLOAT3& pMin, const XMFLOAT3& pMax)
+{
+	return pA.mCellMin.x <= pA.mCellMax.x &&
+		pA.mMin.x <= pMax.x && pA.mMax.x >= pMin.x &&
+		pA.mMin.y <= pMax.y && pA.mMax.y >= pMin.y &&
+		pA.mMin.z <= pMax.z && pA.mMax.z >= pMin.z;
+}
+
+/// <summary>
+/// Constructor for the spatial hash
+/// </summary>
+/// <param name="pCellSize"> the width of a cell in world units, around the size of a typical object </param>
+/// <param name="pBuckets"> the initial number of buckets, rounded up to a power of two - the table doubles as it fills </param>
+SpatialHash::SpatialHash(const float pCellSize, const int pBuckets) : mCellSize(pCellSize)
+{
+	auto buckets = 1;
+	while (buckets < pBuckets)
+	{
+		buckets *= 2;
+	}
+	mBuckets.assign(buckets, -1);
+}
+
+/// <summary>
+/// Hashes a cell into a bucket, cells sharing a bucket are told apart by the box tests
+/// </summary>
+/// <returns> the bucket index </returns>
+int SpatialHash::Bucket(const int pX, const int pY, const int pZ) const
+{
+	const auto hash = (static_cast<unsigned int>(pX) * 73856093u) ^ (static_cast<unsigned int>(pY) * 19349663u) ^ (static_cast<unsigned int>(pZ) * 83492791u);
+	return static_cast<int>(hash & static_cast<unsigned int>(mBuckets.size() - 1));
+}
+
+/// <summary>
+/// Finds the range of cells a box covers, an empty box gives a range with its min above its max
+/// </summary>
+/// <param name="pMin"> the minimum corner of the box </param>
+/// <param name="pMax"> the maximum corner of the box </param>
+/// <param name="pCellMin"> the first cell covered </param>
+/// <param name="pCellMax"> the last cell covered </param>
+void SpatialHash::Cells(const XMFLOAT3& pMin, const XMFLOAT3& pMax, XMINT3& pCellMin, XMINT3& pCellMax) const
+{
+	if (!(pMin.x <= pMax.x && pMin.y <= pMax.y && pMin.z <= pMax.z))
+	{
+		pCellMin = XMINT3(0, 0, 0);
+		pCellMax = XMINT3(-1, -1, -1);
+		return;
+	}
+	//clamped so a runaway object cannot overflow the cell coordinates
+	const auto limit = static_cast<float>(1 << 20);
+	const auto cell = [&](const float pValue)
+	{
+		return static_cast<int>(floor((max)(-limit, (min)(limit, pValue / mCellSize))));
+	};
+	pCellMin = XMINT3(cell(pMin.x), cell(pMin.y), cell(pMin.z));
+	pCellMax = XMINT3(cell(pMax.x), cell(pMax.y), cell(pMax.z));
+}
+
+/// <summary>
+/// Links a proxy into every cell of its cell range, or onto the large list if it covers too many cells
+/// </summary>
+/// <param name="pProxy"> the proxy to link </param>
+void SpatialHash::LinkProxy(const int pProxy)
+{
+	auto& proxy = mProxies[pProxy];
+	const auto& cellMin = proxy.mCellMin;
+	const auto& cellMax = proxy.mCellMax;
+	proxy.mLarge = false;
+	if (cellMin.x > cellMax.x)
+	{
+		return;
+	}
+	const auto cells = static_cast<long long>(cellMax.x - cellMin.x + 1) * (cellMax.y - cellMin.y + 1) * (cellMax.z - cellMin.z + 1);
+	if (cells > MAX_CELLS)
+	{
+		proxy.mLarge = true;
+		mLarge.push_back(pProxy);
+		return;
+	}
+
+	for (auto z = cellMin.z; z <= cellMax.z; ++z)
+	{
+		for (auto y = cellMin.y; y <= cellMax.y; ++y)
+		{
+			for (auto x = cellMin.x; x <= cellMax.x; ++x)
+			{
+				auto link = mFreeLink;
+				if (link >= 0)
+				{
+					mFreeLink = mLinks[link].mNext;
+				}
+				else
+				{
+					link = static_cast<int>(mLinks.size());
+					mLinks.emplace_back();
+				}
+				auto& bucket = mBuckets[Bucket(x, y, z)];
+				mLinks[link] = CellLink{ pProxy, bucket };
+				bucket = link;
+			}
+		}
+	}
+	mLinkCount += static_cast<int>(cells);
+}
+
+/// <summary>
+/// Unlinks a proxy from the cells it was last linked into, the links go back on the free list
+/// </summary>
+/// <param name="pProxy"> the proxy to unlink </param>
+void SpatialHash::UnlinkProxy(const int pProxy)
+{
+	const auto& proxy = mProxies[pProxy];
+	if (proxy.mLarge)
+	{
+		const auto it = find(mLarge.begin(), mLarge.end(), pProxy);
+		*it = mLarge.back();
+		mLarge.pop_back();
+		return;
+	}
+
+	const auto& cellMin = proxy.mCellMin;
+	const auto& cellMax = proxy.mCellMax;
+	for (auto z = cellMin.z; z <= cellMax.z; ++z)
+	{
+		for (auto y = cellMin.y; y <= cellMax.y; ++y)
+		{
+			for (auto x = cellMin.x; x <= cellMax.x; ++x)
+			{
+				//a proxy in two cells which share a bucket has two links there, each cell removes one of them
+				auto* previous = &mBuckets[Bucket(x, y, z)];
+				while (mLinks[*previous].mProxy != pProxy)
+				{
+					previous = &mLinks[*previous].mNext;
+				}
+				const auto link = *previous;
+				*previous = mLinks[link].mNext;
+				mLinks[link].mNext = mFreeLink;
+				mFreeLink = link;
+				--mLinkCount;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Doubles the buckets until there are at most two links per bucket and links every proxy again
+/// </summary>
+void SpatialHash::Grow()
+{
+	auto buckets = mBuckets.size();
+	while (static_cast<size_t>(mLinkCount) > buckets * 2)
+	{
+		buckets *= 2;
+	}
+	mBuckets.assign(buckets, -1);
+	mLinks.clear();
+	mLarge.clear();
+	mFreeLink = -1;
+	mLinkCount = 0;
+	for (auto proxy = 0; proxy < static_cast<int>(mProxies.size()); ++proxy)
+	{
+		if (mProxies[proxy].mOwner >= 0)
+		{
+			LinkProxy(proxy);
+		}
+	}
+}
+
+/// <summary>
+/// Starts a new query, clearing the stamps on the rare occasion the counter wraps
+/// </summary>
+/// <returns> a stamp no proxy holds </returns>
+unsigned int SpatialHash::NextStamp()
+{
+	if (++mStamp == 0)
+	{
+		fill(mStamps.begin(), mStamps.end(), 0);
+		mStamp = 1;
+	}
+	return mStamp;
+}
+
+/// <summary>
+/// Adds a box to the hash
+/// </summary>
+/// <param name="pMin"> the minimum corner of the box </param>
+/// <param name="pMax"> the maximum corner of the box, below the minimum for an empty box </param>
+/// <param name="pOwner"> the gameobject the box belongs to, boxes with the same owner are never paired </param>
+/// <param name="pShape"> the shape within the gameobject </param>
+/// <returns> the proxy for the box, used to move or remove it </returns>
+int SpatialHash::Insert(const XMFLOAT3& pMin, const XMFLOAT3& pMax, const int pOwner, const int pShape)
+{
+	int proxy;
+	if (!mFreeProxies.empty())
+	{
+		proxy = mFreeProxies.back();
+		mFreeProxies.pop_back();
+	}
+	else
+	{
+		proxy = static_cast<int>(mProxies.size());
+		mProxies.emplace_back();
+		mStamps.push_back(0);
+	}
+
+	auto& inserted = mProxies[proxy];
+	inserted = SpatialProxy{ pMin, pMax, XMINT3(), XMINT3(), false, pOwner, pShape };
+	Cells(pMin, pMax, inserted.mCellMin, inserted.mCellMax);
+	LinkProxy(proxy);
+	if (static_cast<size_t>(mLinkCount) > mBuckets.size() * 2)
+	{
+		Grow();
+	}
+	return proxy;
+}
+
+/// <summary>
+/// Moves a box, it is only relinked if it has crossed into different cells
+/// </summary>
+/// <param name="pProxy"> the proxy of the box </param>
+/// <param name="pMin"> the new minimum corner </param>
+/// <param name="pMax"> the new maximum corner </param>
+void SpatialHash::Update(const int pProxy, const XMFLOAT3& pMin, const XMFLOAT3& pMax)
+{
+	auto& proxy = mProxies[pProxy];
+	proxy.mMin = pMin;
+	proxy.mMax = pMax;
+
+	XMINT3 cellMin{};
+	XMINT3 cellMax{};
+	Cells(pMin, pMax, cellMin, cellMax);
+	if (cellMin.x == proxy.mCellMin.x && cellMin.y == proxy.mCellMin.y && cellMin.z == proxy.mCellMin.z &&
+		cellMax.x == proxy.mCellMax.x && cellMax.y == proxy.mCellMax.y && cellMax.z == proxy.mCellMax.z)
+	{
+		return;
+	}
+
+	UnlinkProxy(pProxy);
+	proxy.mCellMin = cellMin;
+	proxy.mCellMax = cellMax;
+	LinkProxy(pProxy);
+	if (static_cast<size_t>(mLinkCount) > mBuckets.size() * 2)
+	{
+		Grow();
+	}
+}
+
+/// <summary>
+/// Removes a box from the hash, its proxy may be handed out again
+/// </summary>
+/// <param name="pProxy"> the proxy of the box </param>
+void SpatialHash::Remove(const int pProxy)
+{
+	UnlinkProxy(pProxy);
+	mProxies[pProxy].mOwner = -1;
+	mFreeProxies.push_back(pProxy);
+}
+
+/// <summary>
+/// Removes every box, the memory is kept for the boxes which replace them
+/// </summary>
+void SpatialHash::Clear()
+{
+	fill(mBuckets.begin(), mBuckets.end(), -1);
+	mProxies.clear();
+	mFreeProxies.clear();
+	mLinks.clear();
+	mLarge.clear();
+	mStamps.clear();
+	mFreeLink = -1;
+	mLinkCount = 0;
+}
+
+/// <summary>
+/// Finds every box which overlaps a region, only the cells under the region are visited
+/// </summary>
+/// <param name="pMin"> the minimum corner of the region </param>
+/// <param name="pMax"> the maximum corner of the region </param>
+/// <param name="pProxies"> cleared then filled with the proxies of the overlapping boxes </param>
+void SpatialHash::Query(const XMFLOAT3& pMin, const XMFLOAT3& pMax, vector<int>& pProxies)
+{
+	pProxies.clear();
+	XMINT3 cellMin{};
+	XMINT3 cellMax{};
+	Cells(pMin, pMax, cellMin, cellMax);
+	if (cellMin.x > cellMax.x)
+	{
+		return;
+	}
+
+	//a region bigger than the hash is cheaper to test box by box
+	const auto cells = static_cast<long long>(cellMax.x - cellMin.x + 1) * (cellMax.y - cellMin.y + 1) * (cellMax.z - cellMin.z + 1);
+	if (cells > static_cast<long long>(mBuckets.size()))
+	{
+		for (auto proxy = 0; proxy < static_cast<int>(mProxies.size()); ++proxy)
+		{
+			if (mProxies[proxy].mOwner >= 0 && Overlaps(mProxies[proxy], pMin, pMax))
+			{
+				pProxies.push_back(proxy);
+			}
+		}
+		return;
+	}
+
+	const auto stamp = NextStamp();
+	for (auto z = cellMin.z; z <= cellMax.z; ++z)
+	{
+		for (auto y = cellMin.y; y <= cellMax.y; ++y)
+		{
+			for (auto x = cellMin.x; x <= cellMax.x; ++x)
+			{
+				for (auto link = mBuckets[Bucket(x, y, z)]; link >= 0; link = mLinks[link].mNext)
+				{
+					const auto proxy = mLinks[link].mProxy;
+					if (mStamps[proxy] != stamp)
+					{
+						mStamps[proxy] = stamp;
+						if (Overlaps(mProxies[proxy], pMin, pMax))
+						{
+							pProxies.push_back(proxy);
+						}
+					}
+				}
+			}
+		}
+	}
+	for (const auto proxy : mLarge)
+	{
+		if (Overlaps(mProxies[proxy], pMin, pMax))
+		{
+			pProxies.push_back(proxy);
+		}
+	}
+}
+
+/// <summary>
+/// Finds every pair of overlapping boxes with different owners, each box only looks through the cells it covers
+/// </summary>
+/// <param name="pPairs"> cleared then filled with the overlapping pairs of proxies, the lower proxy first </param>
+void SpatialHash::Pairs(vector<pair<int, int>>& pPairs)
+{
+	pPairs.clear();
+	for (auto a = 0; a < static_cast<int>(mProxies.size()); ++a)
+	{
+		const auto& proxy = mProxies[a];
+		if (proxy.mOwner < 0 || proxy.mLarge)
+		{
+			continue;
+		}
+		const auto stamp = NextStamp();
+		for (auto z = proxy.mCellMin.z; z <= proxy.mCellMax.z; ++z)
+		{
+			for (auto y = proxy.mCellMin.y; y <= proxy.mCellMax.y; ++y)
+			{
+				for (auto x = proxy.mCellMin.x; x <= proxy.mCellMax.x; ++x)
+				{
+					for (auto link = mBuckets[Bucket(x, y, z)]; link >= 0; link = mLinks[link].mNext)
+					{
+						//each pair is found from its lower proxy only
+						const auto b = mLinks[link].mProxy;
+						if (b > a && mStamps[b] != stamp)
+						{
+							mStamps[b] = stamp;
+							if (mProxies[b].mOwner != proxy.mOwner && Overlaps(mProxies[b], proxy.mMin, proxy.mMax))
+							{
+								pPairs.emplace_back(a, b);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	//large boxes are tested against everything, a pair of large boxes is found from the lower one
+	for (const auto large : mLarge)
+	{
+		const auto& proxy = mProxies[large];
+		for (auto b = 0; b < static_cast<int>(mProxies.size()); ++b)
+		{
+			const auto& other = mProxies[b];
+			if (b != large && other.mOwner >= 0 && other.mOwner != proxy.mOwner && (!other.mLarge || b > large) &&
+				Overlaps(other, proxy.mMin, proxy.mMax))
+			{
+				pPairs.emplace_back((min)(large, b), (max)(large, b));
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets a proxy held by the hash
+/// </summary>
+/// <param name="pProxy"> the proxy </param>
+/// <returns> the box, owner and shape of the proxy </returns>
+const SpatialProxy& SpatialHash::Proxy(const int pProxy) const
+{
+	return mProxies[pProxy];
+}
+
+/// <summary>
+/// Gets the number of boxes in the hash
+/// </summary>
+/// <returns> the number of proxies in use </returns>
+const int SpatialHash::Count() const
+{
+	return static_cast<int>(mProxies.size() - mFreeProxies.size());
+}
+
+/// <summary>
+/// Gets the width of a cell
+/// </summary>
+/// <returns> the cell size in world units </returns>
+const float SpatialHash::CellSize() const
+{
+	return mCellSize;
+}
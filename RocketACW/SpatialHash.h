@@ -0,0 +1,53 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <utility>
+#include "SpatialProxy.h"
+
+//Uniform grid broadphase - every box is linked into each cell it touches and the cells are hashed into a table of buckets, so the world needs no bounds
+//The table doubles whenever the buckets average more than two links, so it only resizes while the scene is growing
+//Links come from a pooled free list so moving a box between cells, and every query, runs without allocating once the pool has grown
+class SpatialHash
+{
+	struct CellLink
+	{
+		int mProxy;
+		int mNext;		//the next link in the bucket, or the next free link
+	};
+
+	std::vector<SpatialProxy> mProxies;
+	std::vector<int> mFreeProxies;
+	std::vector<int> mBuckets;
+	std::vector<CellLink> mLinks;
+	std::vector<int> mLarge;			//proxies covering too many cells to link, every query tests them directly
+	std::vector<unsigned int> mStamps;	//the query each proxy was last reported by, so a box in several cells is reported once
+	unsigned int mStamp = 0;
+	int mFreeLink = -1;
+	int mLinkCount = 0;
+	float mCellSize;
+
+	int Bucket(const int pX, const int pY, const int pZ) const;
+	void Cells(const DirectX::XMFLOAT3& pMin, const DirectX::XMFLOAT3& pMax, DirectX::XMINT3& pCellMin, DirectX::XMINT3& pCellMax) const;
+	void LinkProxy(const int pProxy);
+	void UnlinkProxy(const int pProxy);
+	void Grow();
+	unsigned int NextStamp();
+
+public:
+	static const int MAX_CELLS = 512;
+
+	SpatialHash(const float pCellSize = 8.0f, const int pBuckets = 1024);
+	~SpatialHash() = default;
+
+	int Insert(const DirectX::XMFLOAT3& pMin, const DirectX::XMFLOAT3& pMax, const int pOwner, const int pShape);
+	void Update(const int pProxy, const DirectX::XMFLOAT3& pMin, const DirectX::XMFLOAT3& pMax);
+	void Remove(const int pProxy);
+	void Clear();
+
+	void Query(const DirectX::XMFLOAT3& pMin, const DirectX::XMFLOAT3& pMax, std::vector<int>& pProxies);
+	void Pairs(std::vector<std::pair<int, int>>& pPairs);
+
+	const SpatialProxy& Proxy(const int pProxy) const;
+	const int Count() const;
+	const float CellSize() const;
+};
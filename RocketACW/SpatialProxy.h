@@ -0,0 +1,14 @@
+#pragma once
+#include <directxmath.h>
+
+//A box held by the spatial hash along with what it belongs to
+struct SpatialProxy
+{
+	DirectX::XMFLOAT3 mMin;
+	DirectX::XMFLOAT3 mMax;
+	DirectX::XMINT3 mCellMin;	//the cells the box was last hashed into, a min above the max means the box is empty
+	DirectX::XMINT3 mCellMax;
+	bool mLarge;				//covers more cells than are worth linking
+	int mOwner;					//the gameobject, -1 once the proxy is removed
+	int mShape;					//the shape within the gameobject
+};
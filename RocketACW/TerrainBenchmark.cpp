@@ -0,0 +1,218 @@
+#include "TerrainBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include "Instance.h"
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for the terrain benchmark
+/// </summary>
+/// <param name="pGenerator"> the generator used to build every terrain </param>
+/// <param name="pQueries"> the number of point and sphere queries made against each store </param>
+/// <param name="pFlatCubeLimit"> terrains with more cubes than this skip the flat list, its linear queries would take minutes </param>
+TerrainBenchmark::TerrainBenchmark(const TerrainGenerator& pGenerator, const int pQueries, const int pFlatCubeLimit) :
+	mGenerator(pGenerator), mQueries(pQueries), mFlatCubeLimit(pFlatCubeLimit), mHits(0)
+{
+}
+
+/// <summary>
+/// Builds the terrain at every size in each store and measures it
+/// </summary>
+/// <param name="pSizes"> the terrain sizes to measure, in cubes </param>
+void TerrainBenchmark::Run(const vector<XMINT3>& pSizes)
+{
+	mResults.clear();
+	for (const auto& size : pSizes)
+	{
+		{
+			VoxelGrid grid(size.x, size.y, size.z);
+			const auto start = chrono::high_resolution_clock::now();
+			mGenerator.Generate(grid);
+			const auto buildMs = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+			MeasureFlat(grid);
+			MeasureStore(grid, "Dense", buildMs);
+		}
+		{
+			VoxelOctree octree(size.x, size.y, size.z);
+			const auto start = chrono::high_resolution_clock::now();
+			mGenerator.Generate(octree);
+			MeasureStore(octree, "Octree", chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count());
+		}
+		{
+			VoxelColumns columns(size.x, size.y, size.z);
+			const auto start = chrono::high_resolution_clock::now();
+			mGenerator.Generate(columns);
+			MeasureStore(columns, "Columns", chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count());
+		}
+	}
+}
+
+/// <summary>
+/// Times the seeded point, sphere and crater queries against a store, the craters are carved last as they change the terrain
+/// </summary>
+/// <param name="pStore"> the store to measure, holding the generated terrain </param>
+/// <param name="pName"> the name of the store in the report </param>
+/// <param name="pBuildMs"> how long the store took to generate </param>
+void TerrainBenchmark::MeasureStore(VoxelStore& pStore, const string& pName, const float pBuildMs)
+{
+	TerrainBenchmarkResult result{ pName, XMINT3(pStore.SizeX(), pStore.SizeY(), pStore.SizeZ()), pStore.Count(), pStore.MemoryBytes(), pBuildMs, 0, 0, 0, 0 };
+	mt19937 random(1234);
+	uniform_real_distribution<float> unit(0, 1);
+
+	auto start = chrono::high_resolution_clock::now();
+	for (auto query = 0; query < mQueries; ++query)
+	{
+		mHits += pStore.IsSolid(static_cast<int>(unit(random) * result.mSize.x), static_cast<int>(unit(random) * result.mSize.y), static_cast<int>(unit(random) * result.mSize.z)) ? 1 : 0;
+	}
+	result.mPointQueryNs = chrono::duration<float, nano>(chrono::high_resolution_clock::now() - start).count() / (max)(mQueries, 1);
+
+	start = chrono::high_resolution_clock::now();
+	for (auto query = 0; query < mQueries; ++query)
+	{
+		const auto centre = XMFLOAT3(unit(random) * result.mSize.x, unit(random) * result.mSize.y, unit(random) * result.mSize.z);
+		mHits += pStore.OverlapsSphere(centre, 3.0f) ? 1 : 0;
+	}
+	result.mSphereQueryNs = chrono::duration<float, nano>(chrono::high_resolution_clock::now() - start).count() / (max)(mQueries, 1);
+
+	vector<XMINT3> cells;
+	start = chrono::high_resolution_clock::now();
+	pStore.ExposedCells(XMINT3(0, 0, 0), XMINT3(result.mSize.x - 1, result.mSize.y - 1, result.mSize.z - 1), cells);
+	result.mExposedMs = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+	mHits += static_cast<int>(cells.size());
+
+	start = chrono::high_resolution_clock::now();
+	for (auto crater = 0; crater < (max)(mQueries / 100, 1); ++crater)
+	{
+		const auto centre = XMFLOAT3(unit(random) * result.mSize.x, unit(random) * result.mSize.y, unit(random) * result.mSize.z);
+		mHits += pStore.CarveSphere(centre, 4.0f);
+	}
+	result.mCarveMs = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+
+	mResults.push_back(result);
+}
+
+/// <summary>
+/// Times the same queries against a flat list of every cube, the way the terrain was first stored - every query is a linear scan
+/// Surface extraction is skipped as a flat list has no way to find a cubes neighbours
+/// </summary>
+/// <param name="pStore"> the store to copy the cubes from </param>
+void TerrainBenchmark::MeasureFlat(const VoxelStore& pStore)
+{
+	TerrainBenchmarkResult result{ "Flat", XMINT3(pStore.SizeX(), pStore.SizeY(), pStore.SizeZ()), pStore.Count(),
+		pStore.Count() * sizeof(Instance), -1, -1, -1, -1, -1 };
+	if (pStore.Count() > mFlatCubeLimit)
+	{
+		mResults.push_back(result);
+		return;
+	}
+
+	auto start = chrono::high_resolution_clock::now();
+	vector<Instance> cubes;
+	cubes.reserve(pStore.Count());
+	for (auto z = 0; z < result.mSize.z; ++z)
+	{
+		for (auto y = 0; y < result.mSize.y; ++y)
+		{
+			for (auto x = 0; x < result.mSize.x; ++x)
+			{
+				if (pStore.IsSolid(x, y, z))
+				{
+					cubes.emplace_back(Instance{ XMFLOAT3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)) });
+				}
+			}
+		}
+	}
+	result.mBuildMs = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
+	result.mBytes = cubes.capacity() * sizeof(Instance);
+
+	//linear scans are slow enough that a handful of queries gives a steady average
+	const auto queries = (max)((min)(mQueries, 64), 1);
+	mt19937 random(1234);
+	uniform_real_distribution<float> unit(0, 1);
+
+	start = chrono::high_resolution_clock::now();
+	for (auto query = 0; query < queries; ++query)
+	{
+		const auto cell = XMFLOAT3(static_cast<float>(static_cast<int>(unit(random) * result.mSize.x)),
+			static_cast<float>(static_cast<int>(unit(random) * result.mSize.y)), static_cast<float>(static_cast<int>(unit(random) * result.mSize.z)));
+		mHits += any_of(cubes.begin(), cubes.end(), [&](const Instance& pCube)
+		{
+			return pCube.mPosition.x == cell.x && pCube.mPosition.y == cell.y && pCube.mPosition.z == cell.z;
+		}) ? 1 : 0;
+	}
+	result.mPointQueryNs = chrono::duration<float, nano>(chrono::high_resolution_clock::now() - start).count() / queries;
+
+	start = chrono::high_resolution_clock::now();
+	for (auto query = 0; query < queries; ++query)
+	{
+		const auto centre = XMFLOAT3(unit(random) * result.mSize.x, unit(random) * result.mSize.y, unit(random) * result.mSize.z);
+		mHits += any_of(cubes.begin(), cubes.end(), [&](const Instance& pCube)
+		{
+			const auto dx = pCube.mPosition.x - centre.x;
+			const auto dy = pCube.mPosition.y - centre.y;
+			const auto dz = pCube.mPosition.z - centre.z;
+			return dx * dx + dy * dy + dz * dz < 9.0f;
+		}) ? 1 : 0;
+	}
+	result.mSphereQueryNs = chrono::duration<float, nano>(chrono::high_resolution_clock::now() - start).count() / queries;
+
+	start = chrono::high_resolution_clock::now();
+	for (auto crater = 0; crater < (max)(queries / 8, 1); ++crater)
+	{
+		const auto centre = XMFLOAT3(unit(random) * result.mSize.x, unit(random) * result.mSize.y, unit(random) * result.mSize.z);
+		cubes.erase(remove_if(cubes.begin(), cubes.end(), [&](const Instance& pCube)
+		{
+			const auto dx = pCube.mPosition.x - centre.x;
+			const auto dy = pCube.mPosition.y - centre.y;
+			const auto dz = pCube.mPosition.z - centre.z;
+			return dx * dx + dy * dy + dz * dz < 16.0f;
+		}), cubes.end());
+	}
+	//scaled up to the number of craters the stores carve
+	result.mCarveMs = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count() * (max)(mQueries / 100, 1) / (max)(queries / 8, 1);
+
+	mResults.push_back(result);
+}
+
+/// <summary>
+/// Writes the results as a table, one row per store and size
+/// </summary>
+/// <param name="pFileName"> the file to write the report to </param>
+void TerrainBenchmark::Write(const string& pFileName) const
+{
+	ofstream file(pFileName);
+	file << left << setw(10) << "Store" << setw(18) << "Size" << right << setw(12) << "Cubes" << setw(14) << "Memory KB"
+		<< setw(12) << "Build ms" << setw(12) << "Point ns" << setw(12) << "Sphere ns" << setw(12) << "Surface ms" << setw(12) << "Carve ms" << "\n";
+	file << fixed << setprecision(2);
+	for (const auto& result : mResults)
+	{
+		const auto size = to_string(result.mSize.x) + "x" + to_string(result.mSize.y) + "x" + to_string(result.mSize.z);
+		file << left << setw(10) << result.mStore << setw(18) << size << right << setw(12) << result.mCubes << setw(14) << result.mBytes / 1024;
+		for (const auto time : { result.mBuildMs, result.mPointQueryNs, result.mSphereQueryNs, result.mExposedMs, result.mCarveMs })
+		{
+			if (time < 0)
+			{
+				file << setw(12) << "-";
+			}
+			else
+			{
+				file << setw(12) << time;
+			}
+		}
+		file << "\n";
+	}
+}
+
+/// <summary>
+/// Gets the results of the last run
+/// </summary>
+/// <returns> one result per store and size </returns>
+const vector<TerrainBenchmarkResult>& TerrainBenchmark::Results() const
+{
+	return mResults;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <directxmath.h>
+#include "TerrainGenerator.h"
+#include "TerrainBenchmarkResult.h"
+
+//Measures the memory use and query speed of each terrain store, and of a flat list holding every cube, across a set of terrain sizes
+//Every store answers the same seeded queries so the rows of a size can be compared directly
+class TerrainBenchmark
+{
+	TerrainGenerator mGenerator;
+	int mQueries;
+	int mFlatCubeLimit;
+	int mHits;	//every query result is summed here so none of the queries can be optimised away
+	std::vector<TerrainBenchmarkResult> mResults;
+
+	void MeasureStore(VoxelStore& pStore, const std::string& pName, const float pBuildMs);
+	void MeasureFlat(const VoxelStore& pStore);
+
+public:
+	explicit TerrainBenchmark(const TerrainGenerator& pGenerator, const int pQueries = 10000, const int pFlatCubeLimit = 4000000);
+	~TerrainBenchmark() = default;
+
+	void Run(const std::vector<DirectX::XMINT3>& pSizes);
+	void Write(const std::string& pFileName) const;
+
+	const std::vector<TerrainBenchmarkResult>& Results() const;
+};
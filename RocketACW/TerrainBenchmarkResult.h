@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <directxmath.h>
+
+//One row of the terrain benchmark - times are negative when the measurement was skipped
+struct TerrainBenchmarkResult
+{
+	std::string mStore;
+	DirectX::XMINT3 mSize;
+	int mCubes;
+	size_t mBytes;
+	float mBuildMs;
+	float mPointQueryNs;
+	float mSphereQueryNs;
+	float mExposedMs;
+	float mCarveMs;
+};
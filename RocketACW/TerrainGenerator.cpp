@@ -0,0 +1,261 @@
+#include "TerrainGenerator.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+#include "ParallelFor.h"
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for the terrain generator
+/// </summary>
+/// <param name="pSeed"> the seed used for every noise layer </param>
+TerrainGenerator::TerrainGenerator(const unsigned int pSeed) : mSeed(pSeed)
+{
+}
+
+/// <summary>
+/// Hashes a lattice point into a pseudo random value, the same point and seed always give the same value
+/// </summary>
+/// <returns> a value in [0, 1) </returns>
+float TerrainGenerator::Hash(const int pX, const int pY, const int pZ, const unsigned int pSeed)
+{
+	auto hash = pSeed;
+	hash ^= static_cast<uint32_t>(pX) * 0x8da6b343u;
+	hash ^= static_cast<uint32_t>(pY) * 0xd8163841u;
+	hash ^= static_cast<uint32_t>(pZ) * 0xcb1ab31fu;
+	//murmur3 finaliser to spread the bits
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35u;
+	hash ^= hash >> 16;
+	return (hash & 0xffffff) / 16777216.0f;
+}
+
+/// <summary>
+/// Samples smoothly interpolated value noise at the given point
+/// </summary>
+/// <returns> a value in [0, 1) </returns>
+float TerrainGenerator::ValueNoise(const float pX, const float pY, const float pZ, const unsigned int pSeed)
+{
+	const auto x0 = static_cast<int>(floor(pX));
+	const auto y0 = static_cast<int>(floor(pY));
+	const auto z0 = static_cast<int>(floor(pZ));
+	//smoothstep the offsets so the noise has no creases along the lattice
+	auto fx = pX - x0;
+	auto fy = pY - y0;
+	auto fz = pZ - z0;
+	fx = fx * fx * (3 - 2 * fx);
+	fy = fy * fy * (3 - 2 * fy);
+	fz = fz * fz * (3 - 2 * fz);
+
+	float corners[2][2];
+	for (auto k = 0; k < 2; ++k)
+	{
+		for (auto j = 0; j < 2; ++j)
+		{
+			const auto a = Hash(x0, y0 + j, z0 + k, pSeed);
+			const auto b = Hash(x0 + 1, y0 + j, z0 + k, pSeed);
+			corners[k][j] = a + (b - a) * fx;
+		}
+	}
+	const auto front = corners[0][0] + (corners[0][1] - corners[0][0]) * fy;
+	const auto back = corners[1][0] + (corners[1][1] - corners[1][0]) * fy;
+	return front + (back - front) * fz;
+}
+
+/// <summary>
+/// Sums the noise layers for a column to find how many cubes tall it is
+/// </summary>
+/// <param name="pSizeY"> the height of the grid </param>
+/// <returns> the number of solid cells in the column, at least one so the terrain never has holes </returns>
+int TerrainGenerator::ColumnHeight(const int pX, const int pZ, const int pSizeY) const
+{
+	auto noise = 0.0f;
+	auto weight = 1.0f;
+	auto totalWeight = 0.0f;
+	auto frequency = mFrequency;
+	for (auto octave = 0; octave < mOctaves; ++octave)
+	{
+		noise += ValueNoise(pX * frequency, 0, pZ * frequency, mSeed + octave) * weight;
+		totalWeight += weight;
+		weight *= 0.5f;
+		frequency *= 2.0f;
+	}
+	if (totalWeight > 0)
+	{
+		noise /= totalWeight;
+	}
+
+	const auto height = static_cast<int>(pSizeY * (mBaseHeight + mAmplitude * (noise * 2 - 1)));
+	return min(max(height, 1), pSizeY);
+}
+
+/// <summary>
+/// Checks if the cell lies inside a cave
+/// </summary>
+/// <returns> true if the cave noise is above the threshold </returns>
+const bool TerrainGenerator::IsCave(const int pX, const int pY, const int pZ) const
+{
+	return ValueNoise(pX * mCaveFrequency, pY * mCaveFrequency, pZ * mCaveFrequency, ~mSeed) > mCaveThreshold;
+}
+
+/// <summary>
+/// Checks if a cell is solid given the height of its column
+/// Caves are kept off the bottom layer and out of the top two layers of each column so the surface is not riddled with holes
+/// </summary>
+/// <param name="pY"> the height of the cell </param>
+/// <param name="pHeight"> the height of the column the cell is in </param>
+/// <returns> true if the cell is below the surface and not in a cave </returns>
+const bool TerrainGenerator::IsSolid(const int pY, const int pHeight, const int pX, const int pZ) const
+{
+	return pY < pHeight && !(mCaves && pY > 0 && pY < pHeight - 2 && IsCave(pX, pY, pZ));
+}
+
+/// <summary>
+/// Finds the height of every column across worker threads
+/// </summary>
+/// <returns> the column heights, indexed by z * sizeX + x </returns>
+vector<int> TerrainGenerator::ColumnHeights(const int pSizeX, const int pSizeY, const int pSizeZ) const
+{
+	vector<int> heights(pSizeX * pSizeZ);
+	ParallelFor(pSizeZ, [&](const int pBegin, const int pEnd)
+	{
+		for (auto z = pBegin; z < pEnd; ++z)
+		{
+			for (auto x = 0; x < pSizeX; ++x)
+			{
+				heights[z * pSizeX + x] = ColumnHeight(x, z, pSizeY);
+			}
+		}
+	}, mThreads);
+	return heights;
+}
+
+/// <summary>
+/// Fills the grid with the generated terrain, the heightfield and the occupancy are both built across worker threads
+/// </summary>
+/// <param name="pGrid"> the grid to fill, its size is kept </param>
+void TerrainGenerator::Generate(VoxelGrid& pGrid) const
+{
+	const auto sizeX = pGrid.SizeX();
+	const auto heights = ColumnHeights(sizeX, pGrid.SizeY(), pGrid.SizeZ());
+
+	pGrid.Build([&](const int pX, const int pY, const int pZ)
+	{
+		return IsSolid(pY, heights[pZ * sizeX + pX], pX, pZ);
+	}, mThreads);
+}
+
+/// <summary>
+/// Fills the octree with the generated terrain
+/// Regions which lie wholly below the lowest or above the highest column in their footprint are classified without visiting their cells,
+/// so only the surface band and the caves are built cell by cell
+/// </summary>
+/// <param name="pOctree"> the octree to fill, its size is kept </param>
+void TerrainGenerator::Generate(VoxelOctree& pOctree) const
+{
+	const auto sizeX = pOctree.SizeX();
+	const auto heights = ColumnHeights(sizeX, pOctree.SizeY(), pOctree.SizeZ());
+
+	pOctree.Build([&](const XMINT3& pMin, const XMINT3& pMax)
+	{
+		auto lowest = INT_MAX;
+		auto highest = 0;
+		for (auto z = pMin.z; z <= pMax.z; ++z)
+		{
+			for (auto x = pMin.x; x <= pMax.x; ++x)
+			{
+				const auto height = heights[z * sizeX + x];
+				lowest = min(lowest, height);
+				highest = max(highest, height);
+			}
+		}
+
+		if (pMin.y >= highest)
+		{
+			return VoxelOctree::RegionState::EMPTY;
+		}
+		if (pMax.y < lowest && !(mCaves && pMax.y > 0 && pMin.y < highest - 2))
+		{
+			return VoxelOctree::RegionState::SOLID;
+		}
+		return VoxelOctree::RegionState::MIXED;
+	}, [&](const int pX, const int pY, const int pZ)
+	{
+		return IsSolid(pY, heights[pZ * sizeX + pX], pX, pZ);
+	});
+}
+
+/// <summary>
+/// Fills the column store with the generated terrain, the columns are encoded across worker threads
+/// </summary>
+/// <param name="pColumns"> the column store to fill, its size is kept </param>
+void TerrainGenerator::Generate(VoxelColumns& pColumns) const
+{
+	const auto sizeX = pColumns.SizeX();
+	const auto heights = ColumnHeights(sizeX, pColumns.SizeY(), pColumns.SizeZ());
+
+	pColumns.Build([&](const int pX, const int pY, const int pZ)
+	{
+		return IsSolid(pY, heights[pZ * sizeX + pX], pX, pZ);
+	}, mThreads);
+}
+
+/// <summary>
+/// Sets the seed used for every noise layer
+/// </summary>
+/// <param name="pSeed"> the new seed </param>
+void TerrainGenerator::SetSeed(const unsigned int pSeed)
+{
+	mSeed = pSeed;
+}
+
+/// <summary>
+/// Sets the shape of the heightfield
+/// </summary>
+/// <param name="pOctaves"> the number of noise layers, each with double the frequency and half the weight of the last </param>
+/// <param name="pFrequency"> the frequency of the first layer in cycles per cube </param>
+/// <param name="pBaseHeight"> the average height as a fraction of the grid height </param>
+/// <param name="pAmplitude"> how far the height can stray from the base, as a fraction of the grid height </param>
+void TerrainGenerator::SetHeightField(const int pOctaves, const float pFrequency, const float pBaseHeight, const float pAmplitude)
+{
+	mOctaves = pOctaves;
+	mFrequency = pFrequency;
+	mBaseHeight = pBaseHeight;
+	mAmplitude = pAmplitude;
+}
+
+/// <summary>
+/// Turns the caves on or off
+/// </summary>
+/// <param name="pEnabled"> true to carve caves </param>
+/// <param name="pFrequency"> the frequency of the cave noise in cycles per cube </param>
+/// <param name="pThreshold"> cells where the cave noise is above this are emptied, higher values give fewer caves </param>
+void TerrainGenerator::SetCaves(const bool pEnabled, const float pFrequency, const float pThreshold)
+{
+	mCaves = pEnabled;
+	mCaveFrequency = pFrequency;
+	mCaveThreshold = pThreshold;
+}
+
+/// <summary>
+/// Sets the number of threads used to generate the terrain
+/// </summary>
+/// <param name="pThreads"> the number of threads, 0 uses one per hardware core </param>
+void TerrainGenerator::SetThreadCount(const int pThreads)
+{
+	mThreads = pThreads;
+}
+
+/// <summary>
+/// Gets the seed used for every noise layer
+/// </summary>
+/// <returns> the seed </returns>
+const unsigned int TerrainGenerator::Seed() const
+{
+	return mSeed;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "VoxelGrid.h"
+#include "VoxelOctree.h"
+#include "VoxelColumns.h"
+
+//Seedable terrain generator - a layered value noise heightfield with optional noise caves carved beneath it
+//The same seed and settings always build the same terrain, whatever the number of threads
+class TerrainGenerator
+{
+	unsigned int mSeed;
+	int mOctaves = 4;
+	float mFrequency = 1.0f / 48.0f;
+	float mBaseHeight = 0.6f;
+	float mAmplitude = 0.3f;
+	bool mCaves = false;
+	float mCaveFrequency = 1.0f / 12.0f;
+	float mCaveThreshold = 0.7f;
+	int mThreads = 0;
+
+	static float Hash(const int pX, const int pY, const int pZ, const unsigned int pSeed);
+	static float ValueNoise(const float pX, const float pY, const float pZ, const unsigned int pSeed);
+	int ColumnHeight(const int pX, const int pZ, const int pSizeY) const;
+	const bool IsCave(const int pX, const int pY, const int pZ) const;
+	const bool IsSolid(const int pY, const int pHeight, const int pX, const int pZ) const;
+	std::vector<int> ColumnHeights(const int pSizeX, const int pSizeY, const int pSizeZ) const;
+
+public:
+	explicit TerrainGenerator(const unsigned int pSeed = 1);
+	~TerrainGenerator() = default;
+
+	void SetSeed(const unsigned int pSeed);
+	void SetHeightField(const int pOctaves, const float pFrequency, const float pBaseHeight, const float pAmplitude);
+	void SetCaves(const bool pEnabled, const float pFrequency, const float pThreshold);
+	void SetThreadCount(const int pThreads);
+
+	void Generate(VoxelGrid& pGrid) const;
+	void Generate(VoxelOctree& pOctree) const;
+	void Generate(VoxelColumns& pColumns) const;
+
+	const unsigned int Seed() const;
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <directxmath.h>
+
+//A ray cast into the terrain, in grid space where each cube sits on an integer coordinate
+struct TerrainRay
+{
+	DirectX::XMFLOAT3 mOrigin;
+	DirectX::XMFLOAT3 mDirection;	//does not need to be normalised
+	float mMaxDistance;				//in grid cells along the direction
+};
@@ -0,0 +1,126 @@
+#include "TerrainSnapshot.h"
+#include "Result.h"
+#include <cmath>
+
+using namespace std;
+
+/// <summary>
+/// Destructor for the terrain snapshot, unmaps the file
+/// </summary>
+TerrainSnapshot::~TerrainSnapshot()
+{
+	Close();
+}
+
+/// <summary>
+/// Maps a snapshot file and checks its header and sections fit inside it - the cells themselves are not read
+/// </summary>
+/// <param name="pFileName"> the snapshot file to open </param>
+/// <returns> Result::OK if the snapshot was mapped, Result::FAIL if the file could not be mapped or is not a valid snapshot </returns>
+HRESULT TerrainSnapshot::Open(const wstring& pFileName)
+{
+	Close();
+
+	mFile = CreateFileW(pFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		return Result::FAIL;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || size.QuadPart < static_cast<long long>(sizeof(TerrainSnapshotHeader)))
+	{
+		Close();
+		return Result::FAIL;
+	}
+	mFileBytes = static_cast<uint64_t>(size.QuadPart);
+
+	mMapping = CreateFileMappingW(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mMapping)
+	{
+		Close();
+		return Result::FAIL;
+	}
+	mView = static_cast<const uint8_t*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mView)
+	{
+		Close();
+		return Result::FAIL;
+	}
+
+	//the sizes are capped before they are multiplied and every section is compared against the bytes left after its offset,
+	//so no sum or product of header fields can wrap around and let a section reach past the end of the view
+	const auto& header = Header();
+	const auto sizesValid = header.mSizeX >= 0 && header.mSizeY >= 0 && header.mSizeZ >= 0 &&
+		header.mSizeX <= TerrainSnapshotHeader::MAX_SIZE && header.mSizeY <= TerrainSnapshotHeader::MAX_SIZE && header.mSizeZ <= TerrainSnapshotHeader::MAX_SIZE;
+	const auto cells = sizesValid ? static_cast<uint64_t>(header.mSizeX) * header.mSizeY * header.mSizeZ : 0;
+	const auto valid = header.mMagic == TerrainSnapshotHeader::MAGIC && header.mVersion == TerrainSnapshotHeader::VERSION && sizesValid &&
+		isfinite(header.mScale) && header.mScale > 0 &&
+		header.mOccupancyWords == (cells + 63) / 64 && header.mOccupancyOffset % 8 == 0 &&
+		header.mOccupancyOffset <= mFileBytes && header.mOccupancyWords <= (mFileBytes - header.mOccupancyOffset) / 8 &&
+		(header.mVoxelDataBytes == 0 || (header.mVoxelDataBytes == cells && header.mVoxelDataOffset <= mFileBytes && header.mVoxelDataBytes <= mFileBytes - header.mVoxelDataOffset));
+	if (!valid)
+	{
+		Close();
+		return Result::FAIL;
+	}
+	return Result::OK;
+}
+
+/// <summary>
+/// Unmaps the file and releases its handles, safe to call when nothing is open
+/// </summary>
+void TerrainSnapshot::Close()
+{
+	if (mView)
+	{
+		UnmapViewOfFile(mView);
+		mView = nullptr;
+	}
+	if (mMapping)
+	{
+		CloseHandle(mMapping);
+		mMapping = nullptr;
+	}
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+		mFile = INVALID_HANDLE_VALUE;
+	}
+	mFileBytes = 0;
+}
+
+/// <summary>
+/// Checks if a valid snapshot is mapped
+/// </summary>
+/// <returns> true if the snapshot can be read </returns>
+const bool TerrainSnapshot::IsOpen() const
+{
+	return mView != nullptr;
+}
+
+/// <summary>
+/// Gets the header of the mapped snapshot, only valid while the snapshot is open
+/// </summary>
+/// <returns> the header at the start of the file </returns>
+const TerrainSnapshotHeader& TerrainSnapshot::Header() const
+{
+	return *reinterpret_cast<const TerrainSnapshotHeader*>(mView);
+}
+
+/// <summary>
+/// Gets the occupancy words of the mapped snapshot, only valid while the snapshot is open
+/// </summary>
+/// <returns> a pointer into the mapped file </returns>
+const uint64_t* TerrainSnapshot::Occupancy() const
+{
+	return reinterpret_cast<const uint64_t*>(mView + Header().mOccupancyOffset);
+}
+
+/// <summary>
+/// Gets the optional per cell data of the mapped snapshot
+/// </summary>
+/// <returns> a pointer into the mapped file, nullptr if the snapshot has no per cell data </returns>
+const uint8_t* TerrainSnapshot::VoxelData() const
+{
+	return Header().mVoxelDataBytes != 0 ? mView + Header().mVoxelDataOffset : nullptr;
+}
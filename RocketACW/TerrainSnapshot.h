@@ -0,0 +1,37 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <cstdint>
+#include "TerrainSnapshotHeader.h"
+
+//Read only view of a terrain snapshot file - the file is memory mapped so opening it costs nothing per cell and pages are only read when touched
+class TerrainSnapshot
+{
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	HANDLE mMapping = nullptr;
+	const uint8_t* mView = nullptr;
+	uint64_t mFileBytes = 0;
+
+public:
+	TerrainSnapshot() = default;
+	~TerrainSnapshot();
+
+	TerrainSnapshot& operator=(const TerrainSnapshot& pTerrainSnapshot) = delete;
+	TerrainSnapshot(const TerrainSnapshot& pTerrainSnapshot) = delete;
+
+	HRESULT Open(const std::wstring& pFileName);
+	void Close();
+
+	const bool IsOpen() const;
+	const TerrainSnapshotHeader& Header() const;
+	const uint64_t* Occupancy() const;
+	const uint8_t* VoxelData() const;
+
+	//Reads a cell straight from the mapped occupancy, the cell must be inside the snapshot
+	const bool IsSolid(const int pX, const int pY, const int pZ) const
+	{
+		const auto& header = Header();
+		const auto index = (static_cast<uint64_t>(pZ) * header.mSizeY + pY) * header.mSizeX + pX;
+		return (Occupancy()[index >> 6] >> (index & 63)) & 1;
+	}
+};
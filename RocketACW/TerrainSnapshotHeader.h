@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+//Header at the start of a terrain snapshot file - every section is 8 byte aligned so the mapped file can be read in place
+//The occupancy is one bit per cell in the same order as VoxelGrid, x fastest then y then z, packed into little endian 64 bit words
+struct TerrainSnapshotHeader
+{
+	static const uint32_t MAGIC = 0x4E535452;	//"RTSN"
+	static const uint32_t VERSION = 1;
+	static const int32_t MAX_SIZE = 1024;		//the largest size along any axis, the same limit packed instances have - it keeps every section size well inside 64 bits
+
+	uint32_t mMagic;
+	uint32_t mVersion;
+	int32_t mSizeX;
+	int32_t mSizeY;
+	int32_t mSizeZ;
+	float mScale;
+	int32_t mCount;				//number of solid cells
+	uint32_t mReserved;
+	uint64_t mOccupancyOffset;
+	uint64_t mOccupancyWords;
+	uint64_t mVoxelDataOffset;	//optional byte per cell, zero bytes when the snapshot has none
+	uint64_t mVoxelDataBytes;
+};
+
+static_assert(sizeof(TerrainSnapshotHeader) == 64, "the snapshot header is read straight from the file and must not change size");
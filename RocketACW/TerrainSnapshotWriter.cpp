@@ -0,0 +1,186 @@
+#include "TerrainSnapshotWriter.h"
+#include <algorithm>
+#include "Result.h"
+
+using namespace std;
+
+/// <summary>
+/// Destructor for the snapshot writer, an unfinished file is closed as it stands
+/// </summary>
+TerrainSnapshotWriter::~TerrainSnapshotWriter()
+{
+	if (mFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(mFile);
+	}
+}
+
+/// <summary>
+/// Creates the snapshot file and writes its header, the sections must then be written in order before closing
+/// </summary>
+/// <param name="pFileName"> the file to create, any existing file is replaced </param>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+/// <param name="pScale"> the world size of a cell </param>
+/// <param name="pCount"> the number of solid cells </param>
+/// <param name="pVoxelData"> true if a byte per cell will follow the occupancy </param>
+/// <returns> Result::OK if the file was created, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::Open(const wstring& pFileName, const int pSizeX, const int pSizeY, const int pSizeZ, const float pScale, const int pCount, const bool pVoxelData)
+{
+	//a snapshot the reader would refuse is not written at all
+	if (mFile != INVALID_HANDLE_VALUE || pSizeX < 0 || pSizeY < 0 || pSizeZ < 0 ||
+		pSizeX > TerrainSnapshotHeader::MAX_SIZE || pSizeY > TerrainSnapshotHeader::MAX_SIZE || pSizeZ > TerrainSnapshotHeader::MAX_SIZE)
+	{
+		return Result::FAIL;
+	}
+	mFile = CreateFileW(pFileName.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		return Result::FAIL;
+	}
+
+	const auto cells = static_cast<uint64_t>(pSizeX) * pSizeY * pSizeZ;
+	mHeader = TerrainSnapshotHeader{};
+	mHeader.mMagic = TerrainSnapshotHeader::MAGIC;
+	mHeader.mVersion = TerrainSnapshotHeader::VERSION;
+	mHeader.mSizeX = pSizeX;
+	mHeader.mSizeY = pSizeY;
+	mHeader.mSizeZ = pSizeZ;
+	mHeader.mScale = pScale;
+	mHeader.mCount = pCount;
+	mHeader.mOccupancyOffset = sizeof(TerrainSnapshotHeader);
+	mHeader.mOccupancyWords = (cells + 63) / 64;
+	mHeader.mVoxelDataOffset = mHeader.mOccupancyOffset + mHeader.mOccupancyWords * 8;
+	mHeader.mVoxelDataBytes = pVoxelData ? cells : 0;
+
+	mBuffer.clear();
+	mBuffer.reserve(BUFFER_BYTES);
+	mWritten = 0;
+	return Write(&mHeader, sizeof(mHeader));
+}
+
+/// <summary>
+/// Packs the occupancy of the store into words and streams them out
+/// </summary>
+/// <param name="pStore"> the store to save, it must be the size given to Open </param>
+/// <returns> Result::OK if the occupancy was written, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::WriteOccupancy(const VoxelStore& pStore)
+{
+	if (mWritten + mBuffer.size() != mHeader.mOccupancyOffset || pStore.SizeX() != mHeader.mSizeX ||
+		pStore.SizeY() != mHeader.mSizeY || pStore.SizeZ() != mHeader.mSizeZ)
+	{
+		return Result::INVALIDARGS;
+	}
+
+	auto hr{ Result::OK };
+	uint64_t word = 0;
+	auto bit = 0;
+	for (auto z = 0; z < mHeader.mSizeZ; ++z)
+	{
+		for (auto y = 0; y < mHeader.mSizeY; ++y)
+		{
+			for (auto x = 0; x < mHeader.mSizeX; ++x)
+			{
+				if (pStore.IsSolid(x, y, z))
+				{
+					word |= 1ull << bit;
+				}
+				if (++bit == 64)
+				{
+					hr = Write(&word, sizeof(word));
+					if (FAILED(hr))
+						return hr;
+					word = 0;
+					bit = 0;
+				}
+			}
+		}
+	}
+	if (bit != 0)
+	{
+		hr = Write(&word, sizeof(word));
+	}
+	return hr;
+}
+
+/// <summary>
+/// Streams out part of the per cell data, it can be written in as many pieces as needed after the occupancy
+/// </summary>
+/// <param name="pData"> the next bytes of per cell data </param>
+/// <param name="pBytes"> the number of bytes to write </param>
+/// <returns> Result::OK if the data was written, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::WriteVoxelData(const uint8_t* pData, const size_t pBytes)
+{
+	if (mWritten + mBuffer.size() + pBytes > mHeader.mVoxelDataOffset + mHeader.mVoxelDataBytes ||
+		mWritten + mBuffer.size() < mHeader.mVoxelDataOffset)
+	{
+		return Result::INVALIDARGS;
+	}
+	return Write(pData, pBytes);
+}
+
+/// <summary>
+/// Flushes the last of the buffer and closes the file
+/// </summary>
+/// <returns> Result::OK if every section was written in full, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::Close()
+{
+	if (mFile == INVALID_HANDLE_VALUE)
+	{
+		return Result::FAIL;
+	}
+	auto hr = Flush();
+	CloseHandle(mFile);
+	mFile = INVALID_HANDLE_VALUE;
+	if (SUCCEEDED(hr) && mWritten != mHeader.mVoxelDataOffset + mHeader.mVoxelDataBytes)
+	{
+		hr = Result::FAIL;
+	}
+	return hr;
+}
+
+/// <summary>
+/// Copies bytes into the buffer, writing it to the file each time it fills
+/// </summary>
+/// <returns> Result::OK if the bytes were buffered or written, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::Write(const void* pData, const size_t pBytes)
+{
+	auto hr{ Result::OK };
+	auto bytes = static_cast<const uint8_t*>(pData);
+	auto remaining = pBytes;
+	while (remaining > 0)
+	{
+		const auto count = (min)(remaining, BUFFER_BYTES - mBuffer.size());
+		mBuffer.insert(mBuffer.end(), bytes, bytes + count);
+		bytes += count;
+		remaining -= count;
+		if (mBuffer.size() == BUFFER_BYTES)
+		{
+			hr = Flush();
+			if (FAILED(hr))
+				return hr;
+		}
+	}
+	return hr;
+}
+
+/// <summary>
+/// Writes the buffer to the file and empties it
+/// </summary>
+/// <returns> Result::OK if the whole buffer was written, Result::FAIL otherwise </returns>
+HRESULT TerrainSnapshotWriter::Flush()
+{
+	if (mBuffer.empty())
+	{
+		return Result::OK;
+	}
+	DWORD written = 0;
+	if (!WriteFile(mFile, mBuffer.data(), static_cast<DWORD>(mBuffer.size()), &written, nullptr) || written != mBuffer.size())
+	{
+		return Result::FAIL;
+	}
+	mWritten += written;
+	mBuffer.clear();
+	return Result::OK;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "TerrainSnapshotHeader.h"
+#include "VoxelStore.h"
+
+//Writes a terrain snapshot front to back through a fixed size buffer, so saving never holds a second copy of the terrain in memory
+class TerrainSnapshotWriter
+{
+	static const size_t BUFFER_BYTES = 1 << 20;
+
+	HANDLE mFile = INVALID_HANDLE_VALUE;
+	std::vector<uint8_t> mBuffer;
+	TerrainSnapshotHeader mHeader{};
+	uint64_t mWritten = 0;
+
+	HRESULT Write(const void* pData, const size_t pBytes);
+	HRESULT Flush();
+
+public:
+	TerrainSnapshotWriter() = default;
+	~TerrainSnapshotWriter();
+
+	TerrainSnapshotWriter& operator=(const TerrainSnapshotWriter& pTerrainSnapshotWriter) = delete;
+	TerrainSnapshotWriter(const TerrainSnapshotWriter& pTerrainSnapshotWriter) = delete;
+
+	HRESULT Open(const std::wstring& pFileName, const int pSizeX, const int pSizeY, const int pSizeZ, const float pScale, const int pCount, const bool pVoxelData);
+	HRESULT WriteOccupancy(const VoxelStore& pStore);
+	HRESULT WriteVoxelData(const uint8_t* pData, const size_t pBytes);
+	HRESULT Close();
+};
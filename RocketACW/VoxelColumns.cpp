@@ -0,0 +1,451 @@
+#include "VoxelColumns.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for the column store, all cells start empty
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y, at most 65535 </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+VoxelColumns::VoxelColumns(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	Resize(pSizeX, pSizeY, pSizeZ);
+}
+
+/// <summary>
+/// Converts a column coordinate into an index - x is the fastest changing axis
+/// </summary>
+/// <returns> the index of the column </returns>
+int VoxelColumns::Column(const int pX, const int pZ) const
+{
+	return pZ * mSizeX + pX;
+}
+
+/// <summary>
+/// Checks if the cell coordinate lies inside the store
+/// </summary>
+/// <returns> true if the cell is inside the store </returns>
+const bool VoxelColumns::InBounds(const int pX, const int pY, const int pZ) const
+{
+	return pX >= 0 && pY >= 0 && pZ >= 0 && pX < mSizeX && pY < mSizeY && pZ < mSizeZ;
+}
+
+/// <summary>
+/// Copies the column store behind the store interface
+/// </summary>
+/// <returns> a new column store holding the same cells </returns>
+unique_ptr<VoxelStore> VoxelColumns::Clone() const
+{
+	return make_unique<VoxelColumns>(*this);
+}
+
+/// <summary>
+/// Resizes the store, clearing every cell
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y, at most 65535 </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+void VoxelColumns::Resize(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	mSizeX = pSizeX;
+	mSizeY = (min)(pSizeY, 65535);
+	mSizeZ = pSizeZ;
+	const auto columns = mSizeX * mSizeZ;
+	mOffsets.assign(columns, 0);
+	mRunCounts.assign(columns, 0);
+	mCapacities.assign(columns, 0);
+	Fill(false);
+}
+
+/// <summary>
+/// Sets every cell in the store to the given state, a full column is a single run
+/// </summary>
+/// <param name="pSolid"> true to fill the store, false to empty it </param>
+void VoxelColumns::Fill(const bool pSolid)
+{
+	const auto columns = mSizeX * mSizeZ;
+	const auto runs = pSolid && mSizeY > 0 ? 1 : 0;
+	mRuns.assign(columns * (runs + 1), Run{ 0, static_cast<uint16_t>(mSizeY) });
+	for (auto column = 0; column < columns; ++column)
+	{
+		mOffsets[column] = column * (runs + 1);
+		mRunCounts[column] = static_cast<uint16_t>(runs);
+		mCapacities[column] = static_cast<uint16_t>(runs + 1);
+	}
+	mWasted = 0;
+	mCount = runs * mSizeX * mSizeY * mSizeZ;
+}
+
+/// <summary>
+/// Checks if any cell of a column is solid between two heights
+/// </summary>
+/// <param name="pColumn"> the index of the column </param>
+/// <param name="pFirst"> the lowest cell to check </param>
+/// <param name="pLast"> the highest cell to check (inclusive) </param>
+/// <returns> true if a run overlaps the span </returns>
+const bool VoxelColumns::SolidInColumn(const int pColumn, const int pFirst, const int pLast) const
+{
+	const auto* run = &mRuns[mOffsets[pColumn]];
+	const auto* end = run + mRunCounts[pColumn];
+	for (; run != end && run->mStart <= pLast; ++run)
+	{
+		if (run->mEnd > pFirst)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Fills or empties a span of a column, splitting or merging its runs
+/// </summary>
+/// <param name="pColumn"> the index of the column </param>
+/// <param name="pFirst"> the lowest cell of the span </param>
+/// <param name="pLast"> the highest cell of the span (inclusive) </param>
+/// <param name="pSolid"> true to fill the span, false to empty it </param>
+/// <returns> the number of cells which changed </returns>
+int VoxelColumns::SetSpan(const int pColumn, const int pFirst, const int pLast, const bool pSolid)
+{
+	const auto* run = &mRuns[mOffsets[pColumn]];
+	const auto* end = run + mRunCounts[pColumn];
+	const auto spanEnd = pLast + 1;
+	auto changed = 0;
+	mScratch.clear();
+
+	if (pSolid)
+	{
+		//runs which overlap or touch the span are merged into it
+		auto start = pFirst;
+		auto stop = spanEnd;
+		changed = spanEnd - pFirst;
+		for (; run != end && run->mEnd < pFirst; ++run)
+		{
+			mScratch.push_back(*run);
+		}
+		for (; run != end && run->mStart <= spanEnd; ++run)
+		{
+			changed -= (max)(0, (min)(static_cast<int>(run->mEnd), spanEnd) - (max)(static_cast<int>(run->mStart), pFirst));
+			start = (min)(start, static_cast<int>(run->mStart));
+			stop = (max)(stop, static_cast<int>(run->mEnd));
+		}
+		mScratch.push_back(Run{ static_cast<uint16_t>(start), static_cast<uint16_t>(stop) });
+		for (; run != end; ++run)
+		{
+			mScratch.push_back(*run);
+		}
+	}
+	else
+	{
+		//runs which overlap the span are trimmed, a run which covers it is split in two
+		for (; run != end; ++run)
+		{
+			if (run->mEnd <= pFirst || run->mStart > pLast)
+			{
+				mScratch.push_back(*run);
+				continue;
+			}
+			if (run->mStart < pFirst)
+			{
+				mScratch.push_back(Run{ run->mStart, static_cast<uint16_t>(pFirst) });
+			}
+			if (run->mEnd > spanEnd)
+			{
+				mScratch.push_back(Run{ static_cast<uint16_t>(spanEnd), run->mEnd });
+			}
+			changed += (min)(static_cast<int>(run->mEnd), spanEnd) - (max)(static_cast<int>(run->mStart), pFirst);
+		}
+	}
+
+	if (changed != 0)
+	{
+		WriteColumn(pColumn, mScratch);
+		mCount += pSolid ? changed : -changed;
+	}
+	return changed;
+}
+
+/// <summary>
+/// Stores new runs for a column - they are written in place when they fit, otherwise the column moves to the end of the pool with room to grow
+/// </summary>
+/// <param name="pColumn"> the index of the column </param>
+/// <param name="pRuns"> the new runs of the column, sorted from the bottom up </param>
+void VoxelColumns::WriteColumn(const int pColumn, const vector<Run>& pRuns)
+{
+	const auto count = static_cast<int>(pRuns.size());
+	if (count > mCapacities[pColumn])
+	{
+		const auto capacity = (min)((max)(count, mCapacities[pColumn] * 2), 65535);
+		mWasted += mCapacities[pColumn];
+		mOffsets[pColumn] = static_cast<uint32_t>(mRuns.size());
+		mCapacities[pColumn] = static_cast<uint16_t>(capacity);
+		mRuns.resize(mRuns.size() + capacity);
+	}
+	copy(pRuns.begin(), pRuns.end(), mRuns.begin() + mOffsets[pColumn]);
+	mRunCounts[pColumn] = static_cast<uint16_t>(count);
+
+	if (mWasted > mRuns.size() / 2)
+	{
+		Compact();
+	}
+}
+
+/// <summary>
+/// Repacks the pool to drop the space left behind by columns which moved, every column keeps one spare run
+/// </summary>
+void VoxelColumns::Compact()
+{
+	vector<Run> runs;
+	runs.reserve(mRuns.size() - mWasted);
+	for (auto column = 0; column < static_cast<int>(mOffsets.size()); ++column)
+	{
+		const auto first = mRuns.begin() + mOffsets[column];
+		mOffsets[column] = static_cast<uint32_t>(runs.size());
+		mCapacities[column] = (min)(mRunCounts[column] + 1, 65535);
+		runs.insert(runs.end(), first, first + mRunCounts[column]);
+		runs.resize(mOffsets[column] + mCapacities[column]);
+	}
+	mRuns.swap(runs);
+	mWasted = 0;
+}
+
+/// <summary>
+/// Finds the cells of a column whose centres lie strictly inside a sphere - the same test the dense grid makes, so both stores carve identical craters
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <param name="pFirst"> receives the lowest cell inside the sphere </param>
+/// <param name="pLast"> receives the highest cell inside the sphere </param>
+/// <returns> true if any cell of the column is inside the sphere </returns>
+const bool VoxelColumns::SphereSpan(const XMFLOAT3& pCentre, const float pRadius, const int pX, const int pZ, int& pFirst, int& pLast) const
+{
+	const auto dx = pX - pCentre.x;
+	const auto dz = pZ - pCentre.z;
+	const auto radiusSq = pRadius * pRadius;
+	const auto lowest = (max)(static_cast<int>(ceil(pCentre.y - pRadius)), 0);
+	const auto highest = (min)(static_cast<int>(floor(pCentre.y + pRadius)), mSizeY - 1);
+
+	pFirst = lowest;
+	while (pFirst <= highest && !(dx * dx + (pFirst - pCentre.y) * (pFirst - pCentre.y) + dz * dz < radiusSq))
+	{
+		++pFirst;
+	}
+	pLast = highest;
+	while (pLast >= pFirst && !(dx * dx + (pLast - pCentre.y) * (pLast - pCentre.y) + dz * dz < radiusSq))
+	{
+		--pLast;
+	}
+	return pFirst <= pLast;
+}
+
+/// <summary>
+/// Checks if the given cell is occupied - cells outside of the store are always empty
+/// </summary>
+/// <returns> true if there is a cube in the cell </returns>
+const bool VoxelColumns::IsSolid(const int pX, const int pY, const int pZ) const
+{
+	return InBounds(pX, pY, pZ) && SolidInColumn(Column(pX, pZ), pY, pY);
+}
+
+/// <summary>
+/// Marks the given cell as occupied, cells outside of the store are ignored
+/// </summary>
+void VoxelColumns::Set(const int pX, const int pY, const int pZ)
+{
+	if (InBounds(pX, pY, pZ))
+	{
+		SetSpan(Column(pX, pZ), pY, pY, true);
+	}
+}
+
+/// <summary>
+/// Marks the given cell as empty, cells outside of the store are ignored
+/// </summary>
+void VoxelColumns::Clear(const int pX, const int pY, const int pZ)
+{
+	if (InBounds(pX, pY, pZ))
+	{
+		SetSpan(Column(pX, pZ), pY, pY, false);
+	}
+}
+
+/// <summary>
+/// Checks if any occupied cell centre lies within the sphere - each column under the sphere is tested against its span in one pass over its runs
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <returns> true if an occupied cell overlaps the sphere </returns>
+const bool VoxelColumns::OverlapsSphere(const XMFLOAT3& pCentre, const float pRadius) const
+{
+	const auto minX = (max)(static_cast<int>(ceil(pCentre.x - pRadius)), 0);
+	const auto maxX = (min)(static_cast<int>(floor(pCentre.x + pRadius)), mSizeX - 1);
+	const auto minZ = (max)(static_cast<int>(ceil(pCentre.z - pRadius)), 0);
+	const auto maxZ = (min)(static_cast<int>(floor(pCentre.z + pRadius)), mSizeZ - 1);
+
+	auto first = 0;
+	auto last = 0;
+	for (auto z = minZ; z <= maxZ; ++z)
+	{
+		for (auto x = minX; x <= maxX; ++x)
+		{
+			if (SphereSpan(pCentre, pRadius, x, z, first, last) && SolidInColumn(Column(x, z), first, last))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Empties every cell whose centre is inside the sphere - each column under the sphere loses one span, splitting a run where the crater is buried
+/// </summary>
+/// <param name="pCentre"> the centre of the crater in grid space </param>
+/// <param name="pRadius"> the radius of the crater in grid space </param>
+/// <returns> the number of cells which were emptied </returns>
+int VoxelColumns::CarveSphere(const XMFLOAT3& pCentre, const float pRadius)
+{
+	const auto minX = (max)(static_cast<int>(ceil(pCentre.x - pRadius)), 0);
+	const auto maxX = (min)(static_cast<int>(floor(pCentre.x + pRadius)), mSizeX - 1);
+	const auto minZ = (max)(static_cast<int>(ceil(pCentre.z - pRadius)), 0);
+	const auto maxZ = (min)(static_cast<int>(floor(pCentre.z + pRadius)), mSizeZ - 1);
+
+	auto removed = 0;
+	auto first = 0;
+	auto last = 0;
+	for (auto z = minZ; z <= maxZ; ++z)
+	{
+		for (auto x = minX; x <= maxX; ++x)
+		{
+			if (SphereSpan(pCentre, pRadius, x, z, first, last))
+			{
+				removed += SetSpan(Column(x, z), first, last, false);
+			}
+		}
+	}
+	return removed;
+}
+
+/// <summary>
+/// Finds every exposed cell in the range by walking the runs of each column alongside the runs of its four neighbours
+/// The ends of a run are always exposed, cells between them only when a neighbouring column is empty at that height
+/// </summary>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+/// <param name="pCells"> receives the exposed cells, the list is cleared first </param>
+void VoxelColumns::ExposedCells(const XMINT3& pMin, const XMINT3& pMax, vector<XMINT3>& pCells) const
+{
+	pCells.clear();
+	const auto minY = (max)(pMin.y, 0);
+	const auto maxY = (min)(pMax.y, mSizeY - 1);
+	const int offsets[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+	for (auto z = (max)(pMin.z, 0); z <= (min)(pMax.z, mSizeZ - 1); ++z)
+	{
+		for (auto x = (max)(pMin.x, 0); x <= (min)(pMax.x, mSizeX - 1); ++x)
+		{
+			//a cursor into each neighbouring column, columns outside the store have no runs
+			const Run* next[4]{};
+			const Run* end[4]{};
+			for (auto side = 0; side < 4; ++side)
+			{
+				const auto nx = x + offsets[side][0];
+				const auto nz = z + offsets[side][1];
+				if (nx >= 0 && nz >= 0 && nx < mSizeX && nz < mSizeZ)
+				{
+					const auto neighbour = Column(nx, nz);
+					next[side] = &mRuns[mOffsets[neighbour]];
+					end[side] = next[side] + mRunCounts[neighbour];
+				}
+			}
+
+			const auto column = Column(x, z);
+			const auto* run = &mRuns[mOffsets[column]];
+			const auto* runEnd = run + mRunCounts[column];
+			for (; run != runEnd && run->mStart <= maxY; ++run)
+			{
+				const auto top = run->mEnd - 1;
+				for (auto y = (max)(static_cast<int>(run->mStart), minY); y <= (min)(top, maxY); ++y)
+				{
+					auto exposed = y == run->mStart || y == top;
+					for (auto side = 0; side < 4; ++side)
+					{
+						while (next[side] != end[side] && next[side]->mEnd <= y)
+						{
+							++next[side];
+						}
+						exposed = exposed || next[side] == end[side] || next[side]->mStart > y;
+					}
+					if (exposed)
+					{
+						pCells.emplace_back(x, y, z);
+					}
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets the number of cells in x
+/// </summary>
+/// <returns> the width of the store </returns>
+const int VoxelColumns::SizeX() const
+{
+	return mSizeX;
+}
+
+/// <summary>
+/// Gets the number of cells in y
+/// </summary>
+/// <returns> the height of the store </returns>
+const int VoxelColumns::SizeY() const
+{
+	return mSizeY;
+}
+
+/// <summary>
+/// Gets the number of cells in z
+/// </summary>
+/// <returns> the depth of the store </returns>
+const int VoxelColumns::SizeZ() const
+{
+	return mSizeZ;
+}
+
+/// <summary>
+/// Gets the number of occupied cells
+/// </summary>
+/// <returns> the number of cubes in the store </returns>
+const int VoxelColumns::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Gets the memory held by the run pool and the column tables
+/// </summary>
+/// <returns> the size of the store in bytes </returns>
+const size_t VoxelColumns::MemoryBytes() const
+{
+	return mRuns.capacity() * sizeof(Run) + mScratch.capacity() * sizeof(Run) + mOffsets.capacity() * sizeof(uint32_t) +
+		(mRunCounts.capacity() + mCapacities.capacity()) * sizeof(uint16_t);
+}
+
+/// <summary>
+/// Gets the number of runs in use across every column
+/// </summary>
+/// <returns> the number of solid spans in the store </returns>
+const int VoxelColumns::RunCount() const
+{
+	int runs = 0;
+	for (const auto count : mRunCounts)
+	{
+		runs += count;
+	}
+	return runs;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include "ParallelFor.h"
+#include "VoxelStore.h"
+
+//Run length encoded occupancy store - every column keeps a sorted list of its solid spans, so a plain heightfield costs one run per column
+//The runs of all columns share one pool and each column has a little spare room so a crater can split its runs in place
+class VoxelColumns final : public VoxelStore
+{
+	struct Run
+	{
+		uint16_t mStart;	//lowest solid cell
+		uint16_t mEnd;		//one past the highest solid cell
+	};
+
+	std::vector<Run> mRuns;
+	std::vector<uint32_t> mOffsets;
+	std::vector<uint16_t> mRunCounts;
+	std::vector<uint16_t> mCapacities;
+	std::vector<Run> mScratch;
+	size_t mWasted = 0;
+	int mSizeX = 0;
+	int mSizeY = 0;
+	int mSizeZ = 0;
+	int mCount = 0;
+
+	int Column(const int pX, const int pZ) const;
+	const bool InBounds(const int pX, const int pY, const int pZ) const;
+	const bool SolidInColumn(const int pColumn, const int pFirst, const int pLast) const;
+	int SetSpan(const int pColumn, const int pFirst, const int pLast, const bool pSolid);
+	void WriteColumn(const int pColumn, const std::vector<Run>& pRuns);
+	void Compact();
+	const bool SphereSpan(const DirectX::XMFLOAT3& pCentre, const float pRadius, const int pX, const int pZ, int& pFirst, int& pLast) const;
+
+public:
+	VoxelColumns() = default;
+	VoxelColumns(const int pSizeX, const int pSizeY, const int pSizeZ);
+	~VoxelColumns() = default;
+
+	std::unique_ptr<VoxelStore> Clone() const override;
+
+	void Resize(const int pSizeX, const int pSizeY, const int pSizeZ) override;
+	void Fill(const bool pSolid) override;
+
+	//Sets every cell from pIsSolid(x, y, z) - rows of columns are encoded on separate threads then packed into the pool in order
+	template <typename Predicate>
+	void Build(Predicate pIsSolid, const int pThreads = 0)
+	{
+		std::vector<std::vector<Run>> rowRuns(mSizeZ);
+		std::vector<int> rowCounts(mSizeZ);
+		ParallelFor(mSizeZ, [&](const int pBegin, const int pEnd)
+		{
+			for (auto z = pBegin; z < pEnd; ++z)
+			{
+				auto& runs = rowRuns[z];
+				auto cells = 0;
+				for (auto x = 0; x < mSizeX; ++x)
+				{
+					const auto first = runs.size();
+					auto start = -1;
+					for (auto y = 0; y <= mSizeY; ++y)
+					{
+						const auto solid = y < mSizeY && pIsSolid(x, y, z);
+						if (solid && start < 0)
+						{
+							start = y;
+						}
+						else if (!solid && start >= 0)
+						{
+							runs.push_back(Run{ static_cast<uint16_t>(start), static_cast<uint16_t>(y) });
+							cells += y - start;
+							start = -1;
+						}
+					}
+					mRunCounts[Column(x, z)] = static_cast<uint16_t>(runs.size() - first);
+				}
+				rowCounts[z] = cells;
+			}
+		}, pThreads);
+
+		//one spare run per column lets the first crater through a column split it without moving anything
+		auto total = mRunCounts.size();
+		for (const auto& runs : rowRuns)
+		{
+			total += runs.size();
+		}
+		std::vector<Run>().swap(mRuns);
+		mRuns.reserve(total);
+		mCount = 0;
+		for (auto z = 0; z < mSizeZ; ++z)
+		{
+			auto next = rowRuns[z].begin();
+			for (auto x = 0; x < mSizeX; ++x)
+			{
+				const auto column = Column(x, z);
+				mOffsets[column] = static_cast<uint32_t>(mRuns.size());
+				mCapacities[column] = mRunCounts[column] + 1;
+				mRuns.insert(mRuns.end(), next, next + mRunCounts[column]);
+				mRuns.emplace_back(Run{ 0, 0 });
+				next += mRunCounts[column];
+			}
+			mCount += rowCounts[z];
+			std::vector<Run>().swap(rowRuns[z]);
+		}
+		mWasted = 0;
+	}
+
+	const bool IsSolid(const int pX, const int pY, const int pZ) const override;
+	void Set(const int pX, const int pY, const int pZ) override;
+	void Clear(const int pX, const int pY, const int pZ) override;
+
+	const bool OverlapsSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) const override;
+	int CarveSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) override;
+	void ExposedCells(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const override;
+
+	const int SizeX() const override;
+	const int SizeY() const override;
+	const int SizeZ() const override;
+	const int Count() const override;
+	const size_t MemoryBytes() const override;
+	const int RunCount() const;
+};
@@ -0,0 +1,249 @@
+#include "VoxelDebris.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor which allocates the whole ring up front, so breaking and stepping debris never allocate
+/// </summary>
+/// <param name="pCapacity"> the most pieces which can be in flight at once </param>
+/// <param name="pSize"> the edge length of a piece in cells </param>
+VoxelDebris::VoxelDebris(const int pCapacity, const float pSize) : mCapacity(pCapacity), mSize(pSize)
+{
+	for (auto* array : { &mX, &mY, &mZ, &mVelocityX, &mVelocityY, &mVelocityZ, &mAge, &mLifetime })
+	{
+		array->resize(static_cast<size_t>(pCapacity), 0.0f);
+	}
+}
+
+/// <summary>
+/// Gets the next number from the debris' own xorshift generator, so the same crater always breaks the same way
+/// </summary>
+/// <returns> a number in [0, 1) </returns>
+const float VoxelDebris::Random()
+{
+	mSeed ^= mSeed << 13;
+	mSeed ^= mSeed >> 17;
+	mSeed ^= mSeed << 5;
+	return static_cast<float>(mSeed >> 8) * (1.0f / 16777216.0f);
+}
+
+/// <summary>
+/// Puts a piece at the end of the ring, taking the place of the oldest piece if the ring is full
+/// </summary>
+/// <param name="pX"> the x position of the piece in grid space </param>
+/// <param name="pY"> the y position of the piece in grid space </param>
+/// <param name="pZ"> the z position of the piece in grid space </param>
+/// <param name="pVelocityX"> the x velocity of the piece in cells per second </param>
+/// <param name="pVelocityY"> the y velocity of the piece in cells per second </param>
+/// <param name="pVelocityZ"> the z velocity of the piece in cells per second </param>
+/// <param name="pLifetime"> the time the piece lives for </param>
+void VoxelDebris::Spawn(const float pX, const float pY, const float pZ, const float pVelocityX, const float pVelocityY, const float pVelocityZ, const float pLifetime)
+{
+	const auto piece = (mOldest + mCount) % mCapacity;
+	if (mCount == mCapacity)
+	{
+		mOldest = (mOldest + 1) % mCapacity;
+	}
+	else
+	{
+		++mCount;
+	}
+	mX[piece] = pX;
+	mY[piece] = pY;
+	mZ[piece] = pZ;
+	mVelocityX[piece] = pVelocityX;
+	mVelocityY[piece] = pVelocityY;
+	mVelocityZ[piece] = pVelocityZ;
+	mAge[piece] = 0;
+	mLifetime[piece] = pLifetime;
+}
+
+/// <summary>
+/// Turns a share of the solid cells inside a sphere into debris flying out from its centre
+/// Must be called before the sphere is carved, while the cells are still solid
+/// </summary>
+/// <param name="pStore"> the occupancy store about to be carved </param>
+/// <param name="pCentre"> the centre of the crater in grid space </param>
+/// <param name="pRadius"> the radius of the crater in grid space </param>
+/// <param name="pFraction"> the share of the removed cells which become debris, between 0 and 1 </param>
+/// <param name="pSpeed"> the average speed the debris are thrown at in cells per second </param>
+/// <param name="pLifetime"> the average time a piece lives for </param>
+/// <returns> the number of pieces thrown </returns>
+const int VoxelDebris::Break(const VoxelStore& pStore, const XMFLOAT3& pCentre, const float pRadius, const float pFraction, const float pSpeed, const float pLifetime)
+{
+	if (pFraction <= 0 || mCapacity == 0)
+	{
+		return 0;
+	}
+
+	//the same cells as the carve removes - those whose centres are strictly inside the sphere
+	const auto minX = max(static_cast<int>(ceil(pCentre.x - pRadius)), 0);
+	const auto minY = max(static_cast<int>(ceil(pCentre.y - pRadius)), 0);
+	const auto minZ = max(static_cast<int>(ceil(pCentre.z - pRadius)), 0);
+	const auto maxX = min(static_cast<int>(floor(pCentre.x + pRadius)), pStore.SizeX() - 1);
+	const auto maxY = min(static_cast<int>(floor(pCentre.y + pRadius)), pStore.SizeY() - 1);
+	const auto maxZ = min(static_cast<int>(floor(pCentre.z + pRadius)), pStore.SizeZ() - 1);
+	const auto radiusSq = pRadius * pRadius;
+	auto thrown = 0;
+	for (auto z = minZ; z <= maxZ; ++z)
+	{
+		for (auto y = minY; y <= maxY; ++y)
+		{
+			for (auto x = minX; x <= maxX; ++x)
+			{
+				const auto dx = x - pCentre.x;
+				const auto dy = y - pCentre.y;
+				const auto dz = z - pCentre.z;
+				const auto distanceSq = dx * dx + dy * dy + dz * dz;
+				if (distanceSq >= radiusSq || !pStore.IsSolid(x, y, z) || Random() >= pFraction)
+				{
+					continue;
+				}
+
+				//thrown straight out from the centre and lifted, so pieces from the floor of the crater still leave it
+				const auto speed = pSpeed * (0.5f + Random());
+				const auto scale = distanceSq > 0 ? speed / sqrtf(distanceSq) : 0.0f;
+				Spawn(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z), dx * scale, dy * scale + pSpeed, dz * scale, pLifetime * (0.75f + 0.5f * Random()));
+
+				//a crater bigger than the ring would only overwrite its own pieces
+				if (++thrown == mCapacity)
+				{
+					return thrown;
+				}
+			}
+		}
+	}
+	return thrown;
+}
+
+/// <summary>
+/// Moves a piece one axis at a time, a piece whose leading face would enter a solid cell bounces back off that face instead
+/// </summary>
+/// <param name="pPiece"> the index of the piece in the ring </param>
+/// <param name="pDt"> the time step </param>
+/// <param name="pGravity"> the acceleration downwards in cells per second squared </param>
+/// <param name="pStore"> the occupancy store the debris collide with </param>
+void VoxelDebris::Step(const int pPiece, const float pDt, const float pGravity, const VoxelStore& pStore)
+{
+	const auto half = mSize * 0.5f;
+	float* const position[] = { &mX[pPiece], &mY[pPiece], &mZ[pPiece] };
+	float* const velocity[] = { &mVelocityX[pPiece], &mVelocityY[pPiece], &mVelocityZ[pPiece] };
+	*velocity[1] -= pGravity * pDt;
+
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto moved = *position[axis] + *velocity[axis] * pDt;
+		//cells are centred on whole numbers, so the cell under a point is found by rounding
+		int cell[3];
+		for (auto other = 0; other < 3; ++other)
+		{
+			const auto probe = other == axis ? moved + (*velocity[axis] > 0 ? half : -half) : *position[other];
+			cell[other] = static_cast<int>(floor(probe + 0.5f));
+		}
+		if (!pStore.IsSolid(cell[0], cell[1], cell[2]))
+		{
+			*position[axis] = moved;
+			continue;
+		}
+
+		*velocity[axis] *= -RESTITUTION;
+		for (auto other = 0; other < 3; ++other)
+		{
+			if (other != axis)
+			{
+				*velocity[other] *= FRICTION;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Steps every piece in the ring and drops the oldest pieces once they have died
+/// A piece which dies before an older one is skipped until the older one has gone
+/// Each piece is split into as many sub-steps as keep it within half a cell per axis, gravity is counted so a falling piece is not under split
+/// </summary>
+/// <param name="pDt"> the time step </param>
+/// <param name="pGravity"> the acceleration downwards in cells per second squared </param>
+/// <param name="pStore"> the occupancy store the debris collide with </param>
+void VoxelDebris::Update(const float pDt, const float pGravity, const VoxelStore& pStore)
+{
+	for (auto i = 0; i < mCount; ++i)
+	{
+		const auto piece = (mOldest + i) % mCapacity;
+		if (mAge[piece] >= mLifetime[piece])
+		{
+			continue;
+		}
+		mAge[piece] += pDt;
+		const auto fastest = (max)({ fabsf(mVelocityX[piece]), fabsf(mVelocityY[piece]) + pGravity * pDt, fabsf(mVelocityZ[piece]) });
+		const auto subSteps = (max)(static_cast<int>(ceil(fastest * pDt / MAX_TRAVEL)), 1);
+		const auto subDt = pDt / subSteps;
+		for (auto subStep = 0; subStep < subSteps; ++subStep)
+		{
+			Step(piece, subDt, pGravity, pStore);
+		}
+	}
+
+	while (mCount > 0 && mAge[mOldest] >= mLifetime[mOldest])
+	{
+		mOldest = (mOldest + 1) % mCapacity;
+		--mCount;
+	}
+}
+
+/// <summary>
+/// Writes an instance for every living piece, positions are divided by the size of a piece so they land on the grid once a shape of that scale is applied
+/// </summary>
+/// <param name="pInstances"> receives the instances, the list is cleared first </param>
+void VoxelDebris::Instances(vector<Instance>& pInstances) const
+{
+	pInstances.clear();
+	const auto inverseSize = 1.0f / mSize;
+	for (auto i = 0; i < mCount; ++i)
+	{
+		const auto piece = (mOldest + i) % mCapacity;
+		if (mAge[piece] < mLifetime[piece])
+		{
+			pInstances.emplace_back(Instance{ XMFLOAT3(mX[piece] * inverseSize, mY[piece] * inverseSize, mZ[piece] * inverseSize) });
+		}
+	}
+}
+
+/// <summary>
+/// Removes every piece, the ring keeps its storage
+/// </summary>
+void VoxelDebris::Clear()
+{
+	mOldest = 0;
+	mCount = 0;
+}
+
+/// <summary>
+/// Gets the number of pieces held in the ring
+/// </summary>
+/// <returns> the number of pieces in the ring </returns>
+const int VoxelDebris::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Gets the most pieces the ring can hold
+/// </summary>
+/// <returns> the capacity of the ring </returns>
+const int VoxelDebris::Capacity() const
+{
+	return mCapacity;
+}
+
+/// <summary>
+/// Gets the edge length of a piece in cells
+/// </summary>
+/// <returns> the size of a piece </returns>
+const float VoxelDebris::Size() const
+{
+	return mSize;
+}
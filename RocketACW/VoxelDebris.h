@@ -0,0 +1,49 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include "VoxelStore.h"
+#include "Instance.h"
+
+//Cubes thrown out of a crater - a share of the cells an explosion removes fly off as short lived rigid debris
+//The debris live in grid space as structure of arrays in a ring of fixed capacity, once the ring is full a new piece takes the place of the oldest
+//so a crater of any size costs the same memory and stepping never visits more than the capacity
+//Each piece is moved one axis at a time and bounces off the face of any solid cell its leading face would enter, a lookup in the occupancy store per axis
+//A fast piece is moved in sub-steps of at most half a cell per axis, so it cannot pass through a wall one cell thick between two lookups
+class VoxelDebris
+{
+	static constexpr float RESTITUTION = 0.3f;	//the share of its speed a piece keeps when it bounces off a face
+	static constexpr float FRICTION = 0.6f;		//the share of its speed along a face a piece keeps each time it touches it
+	static constexpr float MAX_TRAVEL = 0.5f;	//the furthest a piece moves along any axis in one sub-step, in cells
+
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<float> mZ;
+	std::vector<float> mVelocityX;
+	std::vector<float> mVelocityY;
+	std::vector<float> mVelocityZ;
+	std::vector<float> mAge;
+	std::vector<float> mLifetime;
+	int mCapacity = 0;
+	int mOldest = 0;
+	int mCount = 0;
+	float mSize = 0;
+	uint32_t mSeed = 0x2545f491u;
+
+	const float Random();
+	void Spawn(const float pX, const float pY, const float pZ, const float pVelocityX, const float pVelocityY, const float pVelocityZ, const float pLifetime);
+	void Step(const int pPiece, const float pDt, const float pGravity, const VoxelStore& pStore);
+
+public:
+	VoxelDebris(const int pCapacity, const float pSize);
+	~VoxelDebris() = default;
+
+	const int Break(const VoxelStore& pStore, const DirectX::XMFLOAT3& pCentre, const float pRadius, const float pFraction, const float pSpeed, const float pLifetime);
+	void Update(const float pDt, const float pGravity, const VoxelStore& pStore);
+	void Instances(std::vector<Instance>& pInstances) const;
+	void Clear();
+
+	const int Count() const;
+	const int Capacity() const;
+	const float Size() const;
+};
@@ -0,0 +1,296 @@
+#include "VoxelGrid.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for the voxel grid, all cells start empty
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+VoxelGrid::VoxelGrid(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	Resize(pSizeX, pSizeY, pSizeZ);
+}
+
+/// <summary>
+/// Converts a cell coordinate into a bit index - x is the fastest changing axis
+/// </summary>
+/// <returns> the index of the bit representing the cell </returns>
+int VoxelGrid::Index(const int pX, const int pY, const int pZ) const
+{
+	return (pZ * mSizeY + pY) * mSizeX + pX;
+}
+
+/// <summary>
+/// Copies the grid behind the store interface
+/// </summary>
+/// <returns> a new grid holding the same cells </returns>
+unique_ptr<VoxelStore> VoxelGrid::Clone() const
+{
+	return make_unique<VoxelGrid>(*this);
+}
+
+/// <summary>
+/// Resizes the grid, clearing every cell
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+void VoxelGrid::Resize(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	mSizeX = pSizeX;
+	mSizeY = pSizeY;
+	mSizeZ = pSizeZ;
+	const auto cells = mSizeX * mSizeY * mSizeZ;
+	mBits.assign((cells + 63) / 64, 0);
+	mCount = 0;
+}
+
+/// <summary>
+/// Sets every cell in the grid to the given state
+/// </summary>
+/// <param name="pSolid"> true to fill the grid, false to empty it </param>
+void VoxelGrid::Fill(const bool pSolid)
+{
+	const auto cells = mSizeX * mSizeY * mSizeZ;
+	fill(mBits.begin(), mBits.end(), pSolid ? ~0ull : 0ull);
+	//clear the unused bits at the end of the last word so they never read as solid
+	if (pSolid && cells % 64 != 0)
+	{
+		mBits.back() = (1ull << (cells % 64)) - 1;
+	}
+	mCount = pSolid ? cells : 0;
+}
+
+/// <summary>
+/// Copies the whole bitmap from words laid out the same way as the grid, such as a mapped snapshot
+/// </summary>
+/// <param name="pWords"> the words to copy, one for every 64 cells of the grid </param>
+void VoxelGrid::Load(const uint64_t* pWords)
+{
+	const auto cells = mSizeX * mSizeY * mSizeZ;
+	copy(pWords, pWords + mBits.size(), mBits.begin());
+	if (cells % 64 != 0)
+	{
+		mBits.back() &= (1ull << (cells % 64)) - 1;
+	}
+	mCount = 0;
+	for (const auto word : mBits)
+	{
+		mCount += static_cast<int>(bitset<64>(word).count());
+	}
+}
+
+/// <summary>
+/// Checks if the cell coordinate lies inside the grid
+/// </summary>
+/// <returns> true if the cell is inside the grid </returns>
+const bool VoxelGrid::InBounds(const int pX, const int pY, const int pZ) const
+{
+	return pX >= 0 && pY >= 0 && pZ >= 0 && pX < mSizeX && pY < mSizeY && pZ < mSizeZ;
+}
+
+/// <summary>
+/// Checks if the given cell is occupied - cells outside of the grid are always empty
+/// </summary>
+/// <returns> true if there is a cube in the cell </returns>
+const bool VoxelGrid::IsSolid(const int pX, const int pY, const int pZ) const
+{
+	if (!InBounds(pX, pY, pZ))
+	{
+		return false;
+	}
+	const auto index = Index(pX, pY, pZ);
+	return (mBits[index >> 6] >> (index & 63)) & 1;
+}
+
+/// <summary>
+/// Marks the given cell as occupied
+/// </summary>
+void VoxelGrid::Set(const int pX, const int pY, const int pZ)
+{
+	if (!InBounds(pX, pY, pZ))
+	{
+		return;
+	}
+	const auto index = Index(pX, pY, pZ);
+	const auto mask = 1ull << (index & 63);
+	if (!(mBits[index >> 6] & mask))
+	{
+		mBits[index >> 6] |= mask;
+		++mCount;
+	}
+}
+
+/// <summary>
+/// Marks the given cell as empty
+/// </summary>
+void VoxelGrid::Clear(const int pX, const int pY, const int pZ)
+{
+	if (!InBounds(pX, pY, pZ))
+	{
+		return;
+	}
+	const auto index = Index(pX, pY, pZ);
+	const auto mask = 1ull << (index & 63);
+	if (mBits[index >> 6] & mask)
+	{
+		mBits[index >> 6] &= ~mask;
+		--mCount;
+	}
+}
+
+/// <summary>
+/// Finds the range of cells whose centres could lie inside the sphere, clamped to the grid
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+void VoxelGrid::SphereBounds(const XMFLOAT3& pCentre, const float pRadius, XMINT3& pMin, XMINT3& pMax) const
+{
+	pMin = XMINT3(max(static_cast<int>(ceil(pCentre.x - pRadius)), 0),
+		max(static_cast<int>(ceil(pCentre.y - pRadius)), 0),
+		max(static_cast<int>(ceil(pCentre.z - pRadius)), 0));
+	pMax = XMINT3(min(static_cast<int>(floor(pCentre.x + pRadius)), mSizeX - 1),
+		min(static_cast<int>(floor(pCentre.y + pRadius)), mSizeY - 1),
+		min(static_cast<int>(floor(pCentre.z + pRadius)), mSizeZ - 1));
+}
+
+/// <summary>
+/// Checks if any occupied cell centre lies within the sphere - only the cells under the spheres bounds are visited
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <returns> true if an occupied cell overlaps the sphere </returns>
+const bool VoxelGrid::OverlapsSphere(const XMFLOAT3& pCentre, const float pRadius) const
+{
+	XMINT3 minCell{};
+	XMINT3 maxCell{};
+	SphereBounds(pCentre, pRadius, minCell, maxCell);
+	const auto radiusSq = pRadius * pRadius;
+
+	for (auto z = minCell.z; z <= maxCell.z; ++z)
+	{
+		const auto dz = z - pCentre.z;
+		for (auto y = minCell.y; y <= maxCell.y; ++y)
+		{
+			const auto dy = y - pCentre.y;
+			for (auto x = minCell.x; x <= maxCell.x; ++x)
+			{
+				const auto dx = x - pCentre.x;
+				if (dx * dx + dy * dy + dz * dz < radiusSq && IsSolid(x, y, z))
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Rasterizes the sphere over the grid and empties every cell whose centre is inside it
+/// </summary>
+/// <param name="pCentre"> the centre of the crater in grid space </param>
+/// <param name="pRadius"> the radius of the crater in grid space </param>
+/// <returns> the number of cells which were emptied </returns>
+int VoxelGrid::CarveSphere(const XMFLOAT3& pCentre, const float pRadius)
+{
+	XMINT3 minCell{};
+	XMINT3 maxCell{};
+	SphereBounds(pCentre, pRadius, minCell, maxCell);
+	const auto radiusSq = pRadius * pRadius;
+	const auto countBefore = mCount;
+
+	for (auto z = minCell.z; z <= maxCell.z; ++z)
+	{
+		const auto dz = z - pCentre.z;
+		for (auto y = minCell.y; y <= maxCell.y; ++y)
+		{
+			const auto dy = y - pCentre.y;
+			for (auto x = minCell.x; x <= maxCell.x; ++x)
+			{
+				const auto dx = x - pCentre.x;
+				if (dx * dx + dy * dy + dz * dz < radiusSq)
+				{
+					Clear(x, y, z);
+				}
+			}
+		}
+	}
+	return countBefore - mCount;
+}
+
+/// <summary>
+/// Finds every exposed cell in the range by testing each cell and its neighbours
+/// </summary>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+/// <param name="pCells"> receives the exposed cells, the list is cleared first </param>
+void VoxelGrid::ExposedCells(const XMINT3& pMin, const XMINT3& pMax, vector<XMINT3>& pCells) const
+{
+	pCells.clear();
+	for (auto z = max(pMin.z, 0); z <= min(pMax.z, mSizeZ - 1); ++z)
+	{
+		for (auto y = max(pMin.y, 0); y <= min(pMax.y, mSizeY - 1); ++y)
+		{
+			for (auto x = max(pMin.x, 0); x <= min(pMax.x, mSizeX - 1); ++x)
+			{
+				if (IsExposed(x, y, z))
+				{
+					pCells.emplace_back(x, y, z);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets the number of cells in x
+/// </summary>
+/// <returns> the width of the grid </returns>
+const int VoxelGrid::SizeX() const
+{
+	return mSizeX;
+}
+
+/// <summary>
+/// Gets the number of cells in y
+/// </summary>
+/// <returns> the height of the grid </returns>
+const int VoxelGrid::SizeY() const
+{
+	return mSizeY;
+}
+
+/// <summary>
+/// Gets the number of cells in z
+/// </summary>
+/// <returns> the depth of the grid </returns>
+const int VoxelGrid::SizeZ() const
+{
+	return mSizeZ;
+}
+
+/// <summary>
+/// Gets the number of occupied cells
+/// </summary>
+/// <returns> the number of cubes in the grid </returns>
+const int VoxelGrid::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Gets the memory held by the bitmap
+/// </summary>
+/// <returns> the size of the bitmap in bytes </returns>
+const size_t VoxelGrid::MemoryBytes() const
+{
+	return mBits.capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include <bitset>
+#include "ParallelFor.h"
+#include "VoxelStore.h"
+
+//Dense occupancy bitmap for the terrain - one bit per cube, indexed by integer cell coordinates
+class VoxelGrid final : public VoxelStore
+{
+	std::vector<uint64_t> mBits;
+	int mSizeX = 0;
+	int mSizeY = 0;
+	int mSizeZ = 0;
+	int mCount = 0;
+
+	int Index(const int pX, const int pY, const int pZ) const;
+	void SphereBounds(const DirectX::XMFLOAT3& pCentre, const float pRadius, DirectX::XMINT3& pMin, DirectX::XMINT3& pMax) const;
+
+public:
+	VoxelGrid() = default;
+	VoxelGrid(const int pSizeX, const int pSizeY, const int pSizeZ);
+	~VoxelGrid() = default;
+
+	std::unique_ptr<VoxelStore> Clone() const override;
+
+	void Resize(const int pSizeX, const int pSizeY, const int pSizeZ) override;
+	void Fill(const bool pSolid) override;
+
+	//Sets every cell from pIsSolid(x, y, z) - the words of the bitmap are shared out between threads so no two threads write the same word
+	template <typename Predicate>
+	void Build(Predicate pIsSolid, const int pThreads = 0)
+	{
+		const auto cells = mSizeX * mSizeY * mSizeZ;
+		ParallelFor(static_cast<int>(mBits.size()), [&](const int pBegin, const int pEnd)
+		{
+			auto index = pBegin * 64;
+			auto x = index % mSizeX;
+			auto y = (index / mSizeX) % mSizeY;
+			auto z = index / (mSizeX * mSizeY);
+			for (auto word = pBegin; word < pEnd; ++word)
+			{
+				uint64_t bits = 0;
+				const auto last = (std::min)(64, cells - word * 64);
+				for (auto bit = 0; bit < last; ++bit)
+				{
+					if (pIsSolid(x, y, z))
+					{
+						bits |= 1ull << bit;
+					}
+					if (++x == mSizeX)
+					{
+						x = 0;
+						if (++y == mSizeY)
+						{
+							y = 0;
+							++z;
+						}
+					}
+				}
+				mBits[word] = bits;
+			}
+		}, pThreads);
+
+		mCount = 0;
+		for (const auto word : mBits)
+		{
+			mCount += static_cast<int>(std::bitset<64>(word).count());
+		}
+	}
+
+	void Load(const uint64_t* pWords);
+
+	const bool InBounds(const int pX, const int pY, const int pZ) const;
+	const bool IsSolid(const int pX, const int pY, const int pZ) const override;
+	void Set(const int pX, const int pY, const int pZ) override;
+	void Clear(const int pX, const int pY, const int pZ) override;
+
+	const bool OverlapsSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) const override;
+	int CarveSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) override;
+	void ExposedCells(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const override;
+
+	const int SizeX() const override;
+	const int SizeY() const override;
+	const int SizeZ() const override;
+	const int Count() const override;
+	const size_t MemoryBytes() const override;
+};
@@ -0,0 +1,9 @@
+#pragma once
+#include <directxmath.h>
+
+//The first solid cell met by a sweep through the terrain
+struct VoxelHit
+{
+	DirectX::XMINT3 mCell;
+	float mTime;	//how far along the sweep the hit happened, 0 at the start and 1 at the end
+};
@@ -0,0 +1,729 @@
+#include "VoxelOctree.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Constructor for an empty octree with no cells
+/// </summary>
+VoxelOctree::VoxelOctree()
+{
+	Resize(0, 0, 0);
+}
+
+/// <summary>
+/// Constructor for the octree, all cells start empty
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+VoxelOctree::VoxelOctree(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	Resize(pSizeX, pSizeY, pSizeZ);
+}
+
+/// <summary>
+/// Finds which of a nodes 64 children holds the cell - every level uses two bits of each coordinate
+/// </summary>
+/// <param name="pLevel"> the level of the node, 0 is the bottom level whose children are single cells </param>
+/// <returns> the index of the child </returns>
+int VoxelOctree::ChildIndex(const int pX, const int pY, const int pZ, const int pLevel)
+{
+	const auto shift = 2 * pLevel;
+	return (((pZ >> shift) & 3) * 4 + ((pY >> shift) & 3)) * 4 + ((pX >> shift) & 3);
+}
+
+/// <summary>
+/// Gets the width in cells of each child of a node on the given level
+/// </summary>
+/// <returns> 4 to the power of the level </returns>
+int VoxelOctree::ChildSpan(const int pLevel)
+{
+	return 1 << (2 * pLevel);
+}
+
+/// <summary>
+/// Finds the lowest cell covered by a child
+/// </summary>
+/// <param name="pOrigin"> the lowest cell of the parent node </param>
+/// <param name="pChild"> the index of the child </param>
+/// <param name="pSpan"> the width of the child in cells </param>
+/// <returns> the lowest cell of the child </returns>
+XMINT3 VoxelOctree::ChildOrigin(const XMINT3& pOrigin, const int pChild, const int pSpan)
+{
+	return XMINT3(pOrigin.x + (pChild & 3) * pSpan, pOrigin.y + ((pChild >> 2) & 3) * pSpan, pOrigin.z + (pChild >> 4) * pSpan);
+}
+
+/// <summary>
+/// Finds the squared distance from a point to the nearest cell centre in a cubic region
+/// </summary>
+/// <param name="pCentre"> the point to measure from </param>
+/// <param name="pMin"> the lowest cell of the region </param>
+/// <param name="pSpan"> the width of the region in cells </param>
+/// <returns> the squared distance </returns>
+float VoxelOctree::NearestDistanceSq(const XMFLOAT3& pCentre, const XMINT3& pMin, const int pSpan)
+{
+	const float centre[3] = { pCentre.x, pCentre.y, pCentre.z };
+	const int min[3] = { pMin.x, pMin.y, pMin.z };
+	auto distanceSq = 0.0f;
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		//the nearest cell centre on each axis is the nearest integer clamped into the region
+		const auto nearest = std::min(std::max(floor(centre[axis] + 0.5f), static_cast<float>(min[axis])), static_cast<float>(min[axis] + pSpan - 1));
+		const auto d = centre[axis] - nearest;
+		distanceSq += d * d;
+	}
+	return distanceSq;
+}
+
+/// <summary>
+/// Finds the squared distance from a point to the furthest cell centre in a cubic region
+/// </summary>
+/// <param name="pCentre"> the point to measure from </param>
+/// <param name="pMin"> the lowest cell of the region </param>
+/// <param name="pSpan"> the width of the region in cells </param>
+/// <returns> the squared distance </returns>
+float VoxelOctree::FurthestDistanceSq(const XMFLOAT3& pCentre, const XMINT3& pMin, const int pSpan)
+{
+	const float centre[3] = { pCentre.x, pCentre.y, pCentre.z };
+	const int min[3] = { pMin.x, pMin.y, pMin.z };
+	auto distanceSq = 0.0f;
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto d = std::max(abs(centre[axis] - min[axis]), abs(centre[axis] - (min[axis] + pSpan - 1)));
+		distanceSq += d * d;
+	}
+	return distanceSq;
+}
+
+/// <summary>
+/// Checks if the cell coordinate lies inside the store
+/// </summary>
+/// <returns> true if the cell is inside the store </returns>
+const bool VoxelOctree::InBounds(const int pX, const int pY, const int pZ) const
+{
+	return pX >= 0 && pY >= 0 && pZ >= 0 && pX < mSizeX && pY < mSizeY && pZ < mSizeZ;
+}
+
+/// <summary>
+/// Checks if a cubic region lies entirely inside the store
+/// </summary>
+/// <returns> true if every cell of the region is inside the store </returns>
+const bool VoxelOctree::RegionInside(const XMINT3& pMin, const int pSpan) const
+{
+	return pMin.x + pSpan <= mSizeX && pMin.y + pSpan <= mSizeY && pMin.z + pSpan <= mSizeZ;
+}
+
+/// <summary>
+/// Checks if a cubic region lies entirely outside the store - regions never start below zero, so only the lowest corner needs testing
+/// </summary>
+/// <param name="pMin"> the lowest cell of the region </param>
+/// <returns> true if no cell of the region is inside the store </returns>
+const bool VoxelOctree::RegionOutside(const XMINT3& pMin) const
+{
+	return pMin.x >= mSizeX || pMin.y >= mSizeY || pMin.z >= mSizeZ;
+}
+
+/// <summary>
+/// Creates a uniform node, reusing a freed one where possible
+/// </summary>
+/// <param name="pSolid"> true if every child of the node starts solid </param>
+/// <returns> the index of the node </returns>
+uint32_t VoxelOctree::AllocateNode(const bool pSolid)
+{
+	const auto node = Node{ pSolid ? ~0ull : 0ull, 0ull, 0u };
+	if (!mFreeNodes.empty())
+	{
+		const auto index = mFreeNodes.back();
+		mFreeNodes.pop_back();
+		mNodes[index] = node;
+		return index;
+	}
+	mNodes.push_back(node);
+	return static_cast<uint32_t>(mNodes.size() - 1);
+}
+
+/// <summary>
+/// Returns a node and all of its descendants to the free lists
+/// </summary>
+/// <param name="pNode"> the node to free </param>
+void VoxelOctree::FreeNode(const uint32_t pNode)
+{
+	const auto mixed = mNodes[pNode].mMixed;
+	if (mixed)
+	{
+		for (auto child = 0; child < 64; ++child)
+		{
+			if (mixed & (1ull << child))
+			{
+				FreeNode(mChildSlots[mNodes[pNode].mChildren + child]);
+			}
+		}
+		mFreeSlots.push_back(mNodes[pNode].mChildren);
+	}
+	mFreeNodes.push_back(pNode);
+}
+
+/// <summary>
+/// Makes a child mixed and points it at its own node, the child slots are only allocated once a node has a mixed child
+/// </summary>
+/// <param name="pNode"> the parent node </param>
+/// <param name="pChild"> the index of the child </param>
+/// <param name="pChildNode"> the node which describes the child </param>
+void VoxelOctree::SetChild(const uint32_t pNode, const int pChild, const uint32_t pChildNode)
+{
+	if (!mNodes[pNode].mMixed)
+	{
+		if (!mFreeSlots.empty())
+		{
+			mNodes[pNode].mChildren = mFreeSlots.back();
+			mFreeSlots.pop_back();
+		}
+		else
+		{
+			mNodes[pNode].mChildren = static_cast<uint32_t>(mChildSlots.size());
+			mChildSlots.resize(mChildSlots.size() + 64);
+		}
+	}
+	auto& node = mNodes[pNode];
+	mChildSlots[node.mChildren + pChild] = pChildNode;
+	node.mMixed |= 1ull << pChild;
+	node.mSolid &= ~(1ull << pChild);
+}
+
+/// <summary>
+/// Frees the node of a mixed child and leaves the child empty
+/// </summary>
+/// <param name="pNode"> the parent node </param>
+/// <param name="pChild"> the index of the child </param>
+void VoxelOctree::ReleaseChild(const uint32_t pNode, const int pChild)
+{
+	FreeNode(mChildSlots[mNodes[pNode].mChildren + pChild]);
+	auto& node = mNodes[pNode];
+	node.mMixed &= ~(1ull << pChild);
+	if (!node.mMixed)
+	{
+		mFreeSlots.push_back(node.mChildren);
+	}
+}
+
+/// <summary>
+/// Turns a mixed child back into a uniform one if its node has become entirely empty or entirely solid
+/// </summary>
+/// <param name="pNode"> the parent node </param>
+/// <param name="pChild"> the index of the child </param>
+void VoxelOctree::Collapse(const uint32_t pNode, const int pChild)
+{
+	const auto& child = mNodes[mChildSlots[mNodes[pNode].mChildren + pChild]];
+	if (child.mMixed || (child.mSolid != 0 && child.mSolid != ~0ull))
+	{
+		return;
+	}
+	const auto solid = child.mSolid != 0;
+	ReleaseChild(pNode, pChild);
+	if (solid)
+	{
+		mNodes[pNode].mSolid |= 1ull << pChild;
+	}
+}
+
+/// <summary>
+/// Gives a uniform child a node of its own so that part of it can be changed
+/// </summary>
+/// <param name="pNode"> the parent node </param>
+/// <param name="pChild"> the index of the child </param>
+/// <returns> the index of the new node </returns>
+uint32_t VoxelOctree::Split(const uint32_t pNode, const int pChild)
+{
+	const auto childNode = AllocateNode((mNodes[pNode].mSolid & (1ull << pChild)) != 0);
+	SetChild(pNode, pChild, childNode);
+	return childNode;
+}
+
+/// <summary>
+/// Counts the solid cells under a node
+/// </summary>
+/// <param name="pNode"> the node to count </param>
+/// <param name="pLevel"> the level of the node </param>
+/// <returns> the number of solid cells </returns>
+int64_t VoxelOctree::CountCells(const uint32_t pNode, const int pLevel) const
+{
+	const auto span = static_cast<int64_t>(ChildSpan(pLevel));
+	const auto& node = mNodes[pNode];
+	auto count = static_cast<int64_t>(bitset<64>(node.mSolid).count()) * span * span * span;
+	for (auto child = 0; node.mMixed && child < 64; ++child)
+	{
+		if (node.mMixed & (1ull << child))
+		{
+			count += CountCells(mChildSlots[node.mChildren + child], pLevel - 1);
+		}
+	}
+	return count;
+}
+
+/// <summary>
+/// Copies the octree behind the store interface
+/// </summary>
+/// <returns> a new octree holding the same cells </returns>
+unique_ptr<VoxelStore> VoxelOctree::Clone() const
+{
+	return make_unique<VoxelOctree>(*this);
+}
+
+/// <summary>
+/// Resizes the store, clearing every cell - the tree is made deep enough for its root to cover the largest axis
+/// </summary>
+/// <param name="pSizeX"> the number of cells in x </param>
+/// <param name="pSizeY"> the number of cells in y </param>
+/// <param name="pSizeZ"> the number of cells in z </param>
+void VoxelOctree::Resize(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	mSizeX = pSizeX;
+	mSizeY = pSizeY;
+	mSizeZ = pSizeZ;
+	mLevels = 1;
+	while (ChildSpan(mLevels) < max(max(mSizeX, mSizeY), mSizeZ))
+	{
+		++mLevels;
+	}
+	Fill(false);
+}
+
+/// <summary>
+/// Sets every cell in the store to the given state, only the nodes along the edges of the store are needed when filling
+/// </summary>
+/// <param name="pSolid"> true to fill the store, false to empty it </param>
+void VoxelOctree::Fill(const bool pSolid)
+{
+	mNodes.assign(1, Node{ 0ull, 0ull, 0u });
+	mChildSlots.clear();
+	mFreeNodes.clear();
+	mFreeSlots.clear();
+	mCount = 0;
+	if (pSolid)
+	{
+		FillNode(ROOT, mLevels - 1, XMINT3(0, 0, 0));
+		mCount = mSizeX * mSizeY * mSizeZ;
+	}
+}
+
+/// <summary>
+/// Fills every cell of the node which lies inside the store
+/// </summary>
+/// <param name="pNode"> the node to fill </param>
+/// <param name="pLevel"> the level of the node </param>
+/// <param name="pOrigin"> the lowest cell of the node </param>
+void VoxelOctree::FillNode(const uint32_t pNode, const int pLevel, const XMINT3& pOrigin)
+{
+	const auto span = ChildSpan(pLevel);
+	for (auto child = 0; child < 64; ++child)
+	{
+		const auto origin = ChildOrigin(pOrigin, child, span);
+		if (RegionOutside(origin))
+		{
+			continue;
+		}
+		if (RegionInside(origin, span))
+		{
+			mNodes[pNode].mSolid |= 1ull << child;
+			continue;
+		}
+		FillNode(Split(pNode, child), pLevel - 1, origin);
+	}
+}
+
+/// <summary>
+/// Rebuilds the store from a cell test - regions the classifier can decide on their own are never visited cell by cell
+/// </summary>
+/// <param name="pClassify"> decides if a region is empty, solid or needs looking at more closely </param>
+/// <param name="pIsSolid"> decides if a single cell is solid </param>
+void VoxelOctree::Build(const Classifier& pClassify, const CellTest& pIsSolid)
+{
+	Fill(false);
+	BuildNode(ROOT, mLevels - 1, XMINT3(0, 0, 0), pClassify, pIsSolid);
+	mCount = static_cast<int>(CountCells(ROOT, mLevels - 1));
+}
+
+/// <summary>
+/// Builds the children of a node, collapsing any which turn out to be uniform
+/// </summary>
+/// <param name="pNode"> the node to build </param>
+/// <param name="pLevel"> the level of the node </param>
+/// <param name="pOrigin"> the lowest cell of the node </param>
+/// <param name="pClassify"> decides if a region is empty, solid or needs looking at more closely </param>
+/// <param name="pIsSolid"> decides if a single cell is solid </param>
+void VoxelOctree::BuildNode(const uint32_t pNode, const int pLevel, const XMINT3& pOrigin, const Classifier& pClassify, const CellTest& pIsSolid)
+{
+	const auto span = ChildSpan(pLevel);
+	for (auto child = 0; child < 64; ++child)
+	{
+		const auto origin = ChildOrigin(pOrigin, child, span);
+		if (RegionOutside(origin))
+		{
+			continue;
+		}
+		if (pLevel == 0)
+		{
+			if (InBounds(origin.x, origin.y, origin.z) && pIsSolid(origin.x, origin.y, origin.z))
+			{
+				mNodes[pNode].mSolid |= 1ull << child;
+			}
+			continue;
+		}
+
+		const auto last = XMINT3(min(origin.x + span, mSizeX) - 1, min(origin.y + span, mSizeY) - 1, min(origin.z + span, mSizeZ) - 1);
+		const auto state = pClassify(origin, last);
+		if (state == RegionState::EMPTY)
+		{
+			continue;
+		}
+		if (state == RegionState::SOLID && RegionInside(origin, span))
+		{
+			mNodes[pNode].mSolid |= 1ull << child;
+			continue;
+		}
+		BuildNode(Split(pNode, child), pLevel - 1, origin, pClassify, pIsSolid);
+		Collapse(pNode, child);
+	}
+}
+
+/// <summary>
+/// Checks if the given cell is occupied - the walk from the root stops at the first uniform child
+/// </summary>
+/// <returns> true if there is a cube in the cell </returns>
+const bool VoxelOctree::IsSolid(const int pX, const int pY, const int pZ) const
+{
+	if (!InBounds(pX, pY, pZ))
+	{
+		return false;
+	}
+	auto node = ROOT;
+	for (auto level = mLevels - 1; ; --level)
+	{
+		const auto child = ChildIndex(pX, pY, pZ, level);
+		const auto bit = 1ull << child;
+		const auto& current = mNodes[node];
+		if (current.mSolid & bit)
+		{
+			return true;
+		}
+		if (!(current.mMixed & bit))
+		{
+			return false;
+		}
+		node = mChildSlots[current.mChildren + child];
+	}
+}
+
+/// <summary>
+/// Sets a single cell, splitting uniform children on the way down and collapsing them again on the way up
+/// </summary>
+/// <param name="pNode"> the node holding the cell </param>
+/// <param name="pLevel"> the level of the node </param>
+/// <param name="pSolid"> the new state of the cell </param>
+void VoxelOctree::Modify(const uint32_t pNode, const int pLevel, const int pX, const int pY, const int pZ, const bool pSolid)
+{
+	const auto child = ChildIndex(pX, pY, pZ, pLevel);
+	const auto bit = 1ull << child;
+	auto& node = mNodes[pNode];
+	if (pLevel == 0)
+	{
+		if (((node.mSolid & bit) != 0) != pSolid)
+		{
+			node.mSolid ^= bit;
+			mCount += pSolid ? 1 : -1;
+		}
+		return;
+	}
+
+	uint32_t childNode;
+	if (node.mMixed & bit)
+	{
+		childNode = mChildSlots[node.mChildren + child];
+	}
+	else
+	{
+		if (((node.mSolid & bit) != 0) == pSolid)
+		{
+			return;
+		}
+		childNode = Split(pNode, child);
+	}
+	Modify(childNode, pLevel - 1, pX, pY, pZ, pSolid);
+	Collapse(pNode, child);
+}
+
+/// <summary>
+/// Marks the given cell as occupied
+/// </summary>
+void VoxelOctree::Set(const int pX, const int pY, const int pZ)
+{
+	if (InBounds(pX, pY, pZ))
+	{
+		Modify(ROOT, mLevels - 1, pX, pY, pZ, true);
+	}
+}
+
+/// <summary>
+/// Marks the given cell as empty
+/// </summary>
+void VoxelOctree::Clear(const int pX, const int pY, const int pZ)
+{
+	if (InBounds(pX, pY, pZ))
+	{
+		Modify(ROOT, mLevels - 1, pX, pY, pZ, false);
+	}
+}
+
+/// <summary>
+/// Checks if any occupied cell centre lies within the sphere
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <returns> true if an occupied cell overlaps the sphere </returns>
+const bool VoxelOctree::OverlapsSphere(const XMFLOAT3& pCentre, const float pRadius) const
+{
+	return mCount > 0 && OverlapsNode(ROOT, mLevels - 1, XMINT3(0, 0, 0), pCentre, pRadius * pRadius);
+}
+
+/// <summary>
+/// Checks the children of a node against the sphere, uniformly solid children answer straight away
+/// </summary>
+/// <returns> true if an occupied cell overlaps the sphere </returns>
+const bool VoxelOctree::OverlapsNode(const uint32_t pNode, const int pLevel, const XMINT3& pOrigin, const XMFLOAT3& pCentre, const float pRadiusSq) const
+{
+	const auto span = ChildSpan(pLevel);
+	const auto& node = mNodes[pNode];
+	for (auto child = 0; child < 64; ++child)
+	{
+		const auto bit = 1ull << child;
+		if (!((node.mSolid | node.mMixed) & bit))
+		{
+			continue;
+		}
+		const auto origin = ChildOrigin(pOrigin, child, span);
+		if (NearestDistanceSq(pCentre, origin, span) >= pRadiusSq)
+		{
+			continue;
+		}
+		if ((node.mSolid & bit) || OverlapsNode(mChildSlots[node.mChildren + child], pLevel - 1, origin, pCentre, pRadiusSq))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Empties every cell whose centre is inside the sphere - children entirely inside are dropped whole rather than cell by cell
+/// </summary>
+/// <param name="pCentre"> the centre of the crater in grid space </param>
+/// <param name="pRadius"> the radius of the crater in grid space </param>
+/// <returns> the number of cells which were emptied </returns>
+int VoxelOctree::CarveSphere(const XMFLOAT3& pCentre, const float pRadius)
+{
+	if (mCount == 0)
+	{
+		return 0;
+	}
+	const auto removed = static_cast<int>(CarveNode(ROOT, mLevels - 1, XMINT3(0, 0, 0), pCentre, pRadius * pRadius));
+	mCount -= removed;
+	return removed;
+}
+
+/// <summary>
+/// Carves the sphere out of the children of a node
+/// </summary>
+/// <returns> the number of cells which were emptied </returns>
+int64_t VoxelOctree::CarveNode(const uint32_t pNode, const int pLevel, const XMINT3& pOrigin, const XMFLOAT3& pCentre, const float pRadiusSq)
+{
+	const auto span = ChildSpan(pLevel);
+	int64_t removed = 0;
+	for (auto child = 0; child < 64; ++child)
+	{
+		const auto bit = 1ull << child;
+		const auto solid = (mNodes[pNode].mSolid & bit) != 0;
+		const auto mixed = (mNodes[pNode].mMixed & bit) != 0;
+		if (!solid && !mixed)
+		{
+			continue;
+		}
+		const auto origin = ChildOrigin(pOrigin, child, span);
+		if (NearestDistanceSq(pCentre, origin, span) >= pRadiusSq)
+		{
+			continue;
+		}
+
+		if (FurthestDistanceSq(pCentre, origin, span) < pRadiusSq)
+		{
+			if (solid)
+			{
+				removed += static_cast<int64_t>(span) * span * span;
+				mNodes[pNode].mSolid &= ~bit;
+			}
+			else
+			{
+				removed += CountCells(mChildSlots[mNodes[pNode].mChildren + child], pLevel - 1);
+				ReleaseChild(pNode, child);
+			}
+			continue;
+		}
+
+		const auto childNode = solid ? Split(pNode, child) : mChildSlots[mNodes[pNode].mChildren + child];
+		removed += CarveNode(childNode, pLevel - 1, origin, pCentre, pRadiusSq);
+		Collapse(pNode, child);
+	}
+	return removed;
+}
+
+/// <summary>
+/// Finds every exposed cell in the range - only the boundaries of uniformly solid regions are visited, never their insides
+/// </summary>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+/// <param name="pCells"> receives the exposed cells, the list is cleared first </param>
+void VoxelOctree::ExposedCells(const XMINT3& pMin, const XMINT3& pMax, vector<XMINT3>& pCells) const
+{
+	pCells.clear();
+	const auto minCell = XMINT3(max(pMin.x, 0), max(pMin.y, 0), max(pMin.z, 0));
+	const auto maxCell = XMINT3(min(pMax.x, mSizeX - 1), min(pMax.y, mSizeY - 1), min(pMax.z, mSizeZ - 1));
+	if (mCount == 0 || minCell.x > maxCell.x || minCell.y > maxCell.y || minCell.z > maxCell.z)
+	{
+		return;
+	}
+	ExposedInNode(ROOT, mLevels - 1, XMINT3(0, 0, 0), minCell, maxCell, pCells);
+}
+
+/// <summary>
+/// Finds the exposed cells under a node which lie in the range
+/// </summary>
+void VoxelOctree::ExposedInNode(const uint32_t pNode, const int pLevel, const XMINT3& pOrigin, const XMINT3& pMin, const XMINT3& pMax, vector<XMINT3>& pCells) const
+{
+	const auto span = ChildSpan(pLevel);
+	const auto& node = mNodes[pNode];
+	for (auto child = 0; child < 64; ++child)
+	{
+		const auto bit = 1ull << child;
+		if (!((node.mSolid | node.mMixed) & bit))
+		{
+			continue;
+		}
+		const auto origin = ChildOrigin(pOrigin, child, span);
+		if (origin.x > pMax.x || origin.y > pMax.y || origin.z > pMax.z ||
+			origin.x + span <= pMin.x || origin.y + span <= pMin.y || origin.z + span <= pMin.z)
+		{
+			continue;
+		}
+		if (node.mSolid & bit)
+		{
+			ExposedInSolidRegion(origin, span, pMin, pMax, pCells);
+		}
+		else
+		{
+			ExposedInNode(mChildSlots[node.mChildren + child], pLevel - 1, origin, pMin, pMax, pCells);
+		}
+	}
+}
+
+/// <summary>
+/// Finds the exposed cells of a uniformly solid region which lie in the range - only cells on the faces of the region can be exposed
+/// </summary>
+/// <param name="pOrigin"> the lowest cell of the region </param>
+/// <param name="pSpan"> the width of the region in cells </param>
+void VoxelOctree::ExposedInSolidRegion(const XMINT3& pOrigin, const int pSpan, const XMINT3& pMin, const XMINT3& pMax, vector<XMINT3>& pCells) const
+{
+	const auto last = XMINT3(pOrigin.x + pSpan - 1, pOrigin.y + pSpan - 1, pOrigin.z + pSpan - 1);
+	const auto minX = max(pOrigin.x, pMin.x);
+	const auto maxX = min(last.x, pMax.x);
+	for (auto z = max(pOrigin.z, pMin.z); z <= min(last.z, pMax.z); ++z)
+	{
+		for (auto y = max(pOrigin.y, pMin.y); y <= min(last.y, pMax.y); ++y)
+		{
+			const auto addIfExposed = [&](const int pX)
+			{
+				if (IsExposed(pX, y, z))
+				{
+					pCells.emplace_back(pX, y, z);
+				}
+			};
+
+			if (z == pOrigin.z || z == last.z || y == pOrigin.y || y == last.y)
+			{
+				//rows on a face of the region are walked in full
+				for (auto x = minX; x <= maxX; ++x)
+				{
+					addIfExposed(x);
+				}
+			}
+			else
+			{
+				//rows through the middle only have their two end cells on the surface
+				if (minX == pOrigin.x)
+				{
+					addIfExposed(pOrigin.x);
+				}
+				if (maxX == last.x && last.x != pOrigin.x)
+				{
+					addIfExposed(last.x);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets the number of cells in x
+/// </summary>
+/// <returns> the width of the store </returns>
+const int VoxelOctree::SizeX() const
+{
+	return mSizeX;
+}
+
+/// <summary>
+/// Gets the number of cells in y
+/// </summary>
+/// <returns> the height of the store </returns>
+const int VoxelOctree::SizeY() const
+{
+	return mSizeY;
+}
+
+/// <summary>
+/// Gets the number of cells in z
+/// </summary>
+/// <returns> the depth of the store </returns>
+const int VoxelOctree::SizeZ() const
+{
+	return mSizeZ;
+}
+
+/// <summary>
+/// Gets the number of occupied cells
+/// </summary>
+/// <returns> the number of cubes in the store </returns>
+const int VoxelOctree::Count() const
+{
+	return mCount;
+}
+
+/// <summary>
+/// Gets the memory held by the nodes and their child slots
+/// </summary>
+/// <returns> the size of the tree in bytes </returns>
+const size_t VoxelOctree::MemoryBytes() const
+{
+	return mNodes.capacity() * sizeof(Node) + (mChildSlots.capacity() + mFreeNodes.capacity() + mFreeSlots.capacity()) * sizeof(uint32_t);
+}
+
+/// <summary>
+/// Gets the number of nodes in use
+/// </summary>
+/// <returns> the number of live nodes </returns>
+const int VoxelOctree::NodeCount() const
+{
+	return static_cast<int>(mNodes.size() - mFreeNodes.size());
+}
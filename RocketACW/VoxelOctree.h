@@ -0,0 +1,95 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "VoxelStore.h"
+
+//Sparse occupancy store - a 64-tree where every node splits its cube into 4x4x4 children
+//A child is either uniformly empty, uniformly solid or mixed with a node of its own, so memory follows the surface rather than the volume
+class VoxelOctree final : public VoxelStore
+{
+public:
+	enum class RegionState
+	{
+		EMPTY,
+		SOLID,
+		MIXED
+	};
+
+	//Classifies the cells in [min, max] without visiting them, MIXED makes the build look closer
+	typedef std::function<RegionState(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax)> Classifier;
+	typedef std::function<bool(const int pX, const int pY, const int pZ)> CellTest;
+
+private:
+	struct Node
+	{
+		uint64_t mSolid;	//children which are entirely solid
+		uint64_t mMixed;	//children which have a node of their own, never set on the bottom level where children are single cells
+		uint32_t mChildren;	//start of the 64 child slots in mChildSlots, only valid while mMixed is not zero
+	};
+
+	static const uint32_t ROOT = 0;
+
+	std::vector<Node> mNodes;
+	std::vector<uint32_t> mChildSlots;
+	std::vector<uint32_t> mFreeNodes;
+	std::vector<uint32_t> mFreeSlots;
+	int mSizeX = 0;
+	int mSizeY = 0;
+	int mSizeZ = 0;
+	int mLevels = 1;
+	int mCount = 0;
+
+	static int ChildIndex(const int pX, const int pY, const int pZ, const int pLevel);
+	static int ChildSpan(const int pLevel);
+	static DirectX::XMINT3 ChildOrigin(const DirectX::XMINT3& pOrigin, const int pChild, const int pSpan);
+	static float NearestDistanceSq(const DirectX::XMFLOAT3& pCentre, const DirectX::XMINT3& pMin, const int pSpan);
+	static float FurthestDistanceSq(const DirectX::XMFLOAT3& pCentre, const DirectX::XMINT3& pMin, const int pSpan);
+
+	const bool InBounds(const int pX, const int pY, const int pZ) const;
+	const bool RegionInside(const DirectX::XMINT3& pMin, const int pSpan) const;
+	const bool RegionOutside(const DirectX::XMINT3& pMin) const;
+
+	uint32_t AllocateNode(const bool pSolid);
+	void FreeNode(const uint32_t pNode);
+	void SetChild(const uint32_t pNode, const int pChild, const uint32_t pChildNode);
+	void ReleaseChild(const uint32_t pNode, const int pChild);
+	void Collapse(const uint32_t pNode, const int pChild);
+	uint32_t Split(const uint32_t pNode, const int pChild);
+	int64_t CountCells(const uint32_t pNode, const int pLevel) const;
+
+	void Modify(const uint32_t pNode, const int pLevel, const int pX, const int pY, const int pZ, const bool pSolid);
+	void FillNode(const uint32_t pNode, const int pLevel, const DirectX::XMINT3& pOrigin);
+	void BuildNode(const uint32_t pNode, const int pLevel, const DirectX::XMINT3& pOrigin, const Classifier& pClassify, const CellTest& pIsSolid);
+	const bool OverlapsNode(const uint32_t pNode, const int pLevel, const DirectX::XMINT3& pOrigin, const DirectX::XMFLOAT3& pCentre, const float pRadiusSq) const;
+	int64_t CarveNode(const uint32_t pNode, const int pLevel, const DirectX::XMINT3& pOrigin, const DirectX::XMFLOAT3& pCentre, const float pRadiusSq);
+	void ExposedInNode(const uint32_t pNode, const int pLevel, const DirectX::XMINT3& pOrigin, const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const;
+	void ExposedInSolidRegion(const DirectX::XMINT3& pOrigin, const int pSpan, const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const;
+
+public:
+	VoxelOctree();
+	VoxelOctree(const int pSizeX, const int pSizeY, const int pSizeZ);
+	~VoxelOctree() = default;
+
+	std::unique_ptr<VoxelStore> Clone() const override;
+
+	void Resize(const int pSizeX, const int pSizeY, const int pSizeZ) override;
+	void Fill(const bool pSolid) override;
+	void Build(const Classifier& pClassify, const CellTest& pIsSolid);
+
+	const bool IsSolid(const int pX, const int pY, const int pZ) const override;
+	void Set(const int pX, const int pY, const int pZ) override;
+	void Clear(const int pX, const int pY, const int pZ) override;
+
+	const bool OverlapsSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) const override;
+	int CarveSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) override;
+	void ExposedCells(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const override;
+
+	const int SizeX() const override;
+	const int SizeY() const override;
+	const int SizeZ() const override;
+	const int Count() const override;
+	const size_t MemoryBytes() const override;
+	const int NodeCount() const;
+};
@@ -0,0 +1,8 @@
+#pragma once
+//Which occupancy store the terrain keeps its cubes in
+enum class VoxelStorage
+{
+	DENSE,	//one bit per cell, fastest queries, memory grows with the volume
+	OCTREE,	//sparse 64-tree which collapses uniform regions, memory grows with the surface
+	COLUMNS	//run length encoded columns, a heightfield costs one run per column
+};
@@ -0,0 +1,445 @@
+#include "VoxelStore.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <cassert>
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Sweeps a sphere from one point to another and finds the first solid cell it touches - a cell is touched when its centre comes within the radius, as in OverlapsSphere
+/// The cells along the path are walked in order with a 3D DDA and only the cells around each one are tested, so the cost follows the length of the path
+/// </summary>
+/// <param name="pFrom"> the centre of the sphere at the start of the sweep, in grid space </param>
+/// <param name="pTo"> the centre of the sphere at the end of the sweep, in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <param name="pHit"> the first cell hit and when it was hit, only set if there was a hit </param>
+/// <returns> true if the sphere touched a solid cell anywhere along the sweep </returns>
+const bool VoxelStore::SweepSphere(const XMFLOAT3& pFrom, const XMFLOAT3& pTo, const float pRadius, VoxelHit& pHit) const
+{
+	const float from[3] = { pFrom.x, pFrom.y, pFrom.z };
+	const float delta[3] = { pTo.x - pFrom.x, pTo.y - pFrom.y, pTo.z - pFrom.z };
+	const int size[3] = { SizeX(), SizeY(), SizeZ() };
+	const auto infinity = numeric_limits<float>::infinity();
+
+	//a cell touched from a point on the path is at most this many cells from the cell holding the point
+	const auto reach = static_cast<int>(floor(pRadius + 0.5f));
+
+	//clip the path to the cells which could be touched, a sweep far above the terrain costs nothing
+	auto start = 0.0f;
+	auto end = 1.0f;
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto low = -reach - 0.5f;
+		const auto high = size[axis] - 1 + reach + 0.5f;
+		if (delta[axis] == 0)
+		{
+			if (from[axis] < low || from[axis] > high)
+			{
+				return false;
+			}
+			continue;
+		}
+		auto enter = (low - from[axis]) / delta[axis];
+		auto exit = (high - from[axis]) / delta[axis];
+		if (enter > exit)
+		{
+			swap(enter, exit);
+		}
+		start = (max)(start, enter);
+		end = (min)(end, exit);
+	}
+	if (start > end)
+	{
+		return false;
+	}
+
+	//cells are centred on integer coordinates, so the path crosses into a new cell at every half
+	int cell[3]{};
+	int step[3]{};
+	float next[3]{};
+	float increment[3]{};
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto position = from[axis] + delta[axis] * start;
+		cell[axis] = static_cast<int>(floor(position + 0.5f));
+		if (delta[axis] == 0)
+		{
+			step[axis] = 0;
+			next[axis] = infinity;
+			increment[axis] = infinity;
+			continue;
+		}
+		step[axis] = delta[axis] > 0 ? 1 : -1;
+		next[axis] = (cell[axis] + step[axis] * 0.5f - from[axis]) / delta[axis];
+		increment[axis] = 1.0f / abs(delta[axis]);
+	}
+
+	const auto lengthSq = delta[0] * delta[0] + delta[1] * delta[1] + delta[2] * delta[2];
+	const auto radiusSq = pRadius * pRadius;
+	auto best = infinity;
+	auto entered = start;
+	//a cell touched at time t is found from the path cell holding t, so once the path enters cells after the best hit nothing earlier can follow
+	while (entered <= end && entered <= best)
+	{
+		for (auto z = cell[2] - reach; z <= cell[2] + reach; ++z)
+		{
+			for (auto y = cell[1] - reach; y <= cell[1] + reach; ++y)
+			{
+				for (auto x = cell[0] - reach; x <= cell[0] + reach; ++x)
+				{
+					//solve |from + delta * t - cell| = radius for the first time the sphere reaches the cell centre
+					const auto offsetX = from[0] - x;
+					const auto offsetY = from[1] - y;
+					const auto offsetZ = from[2] - z;
+					const auto c = offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ - radiusSq;
+					auto time = 0.0f;
+					if (c >= 0)
+					{
+						const auto b = offsetX * delta[0] + offsetY * delta[1] + offsetZ * delta[2];
+						const auto discriminant = b * b - lengthSq * c;
+						if (b >= 0 || discriminant < 0)
+						{
+							continue;
+						}
+						time = (-b - sqrt(discriminant)) / lengthSq;
+					}
+					if (time <= 1.0f && time < best && IsSolid(x, y, z))
+					{
+						best = time;
+						pHit = VoxelHit{ XMINT3(x, y, z), time };
+					}
+				}
+			}
+		}
+
+		const auto axis = next[0] < next[1] ? (next[0] < next[2] ? 0 : 2) : (next[1] < next[2] ? 1 : 2);
+		if (next[axis] == infinity)
+		{
+			break;
+		}
+		entered = next[axis];
+		next[axis] += increment[axis];
+		cell[axis] += step[axis];
+	}
+	return best != infinity;
+}
+
+/// <summary>
+/// Counts the solid cells whose centres are inside a sphere - the cells CarveSphere would remove, without removing them
+/// </summary>
+/// <param name="pCentre"> the centre of the sphere in grid space </param>
+/// <param name="pRadius"> the radius of the sphere in grid space </param>
+/// <returns> the number of solid cells in the sphere </returns>
+const int VoxelStore::CountSphere(const XMFLOAT3& pCentre, const float pRadius) const
+{
+	const auto minX = max(static_cast<int>(ceil(pCentre.x - pRadius)), 0);
+	const auto minY = max(static_cast<int>(ceil(pCentre.y - pRadius)), 0);
+	const auto minZ = max(static_cast<int>(ceil(pCentre.z - pRadius)), 0);
+	const auto maxX = min(static_cast<int>(floor(pCentre.x + pRadius)), SizeX() - 1);
+	const auto maxY = min(static_cast<int>(floor(pCentre.y + pRadius)), SizeY() - 1);
+	const auto maxZ = min(static_cast<int>(floor(pCentre.z + pRadius)), SizeZ() - 1);
+	const auto radiusSq = pRadius * pRadius;
+	auto count = 0;
+	for (auto z = minZ; z <= maxZ; ++z)
+	{
+		for (auto y = minY; y <= maxY; ++y)
+		{
+			for (auto x = minX; x <= maxX; ++x)
+			{
+				const auto dx = x - pCentre.x;
+				const auto dy = y - pCentre.y;
+				const auto dz = z - pCentre.z;
+				if (dx * dx + dy * dy + dz * dz < radiusSq && IsSolid(x, y, z))
+				{
+					++count;
+				}
+			}
+		}
+	}
+	return count;
+}
+
+/// <summary>
+/// Casts a ray through the grid with a 3D DDA and finds the first solid cell it enters
+/// </summary>
+/// <param name="pRay"> the ray in grid space </param>
+/// <param name="pHit"> the cell hit, the face it was entered through and how far along the ray it is </param>
+/// <returns> true if the ray hit a solid cell within its length </returns>
+const bool VoxelStore::Raycast(const TerrainRay& pRay, RayHit& pHit) const
+{
+	pHit = RayHit{ XMINT3(0, 0, 0), XMINT3(0, 0, 0), 0, false };
+	const auto length = sqrt(pRay.mDirection.x * pRay.mDirection.x + pRay.mDirection.y * pRay.mDirection.y + pRay.mDirection.z * pRay.mDirection.z);
+	if (length == 0)
+	{
+		return false;
+	}
+	const float origin[3] = { pRay.mOrigin.x, pRay.mOrigin.y, pRay.mOrigin.z };
+	const float direction[3] = { pRay.mDirection.x / length, pRay.mDirection.y / length, pRay.mDirection.z / length };
+	const int size[3] = { SizeX(), SizeY(), SizeZ() };
+	const auto infinity = numeric_limits<float>::infinity();
+
+	//clip the ray to the box around every cell, remembering which face it came in through
+	auto start = 0.0f;
+	auto end = pRay.mMaxDistance;
+	auto entryAxis = -1;
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		const auto low = -0.5f;
+		const auto high = size[axis] - 0.5f;
+		if (direction[axis] == 0)
+		{
+			if (origin[axis] < low || origin[axis] > high)
+			{
+				return false;
+			}
+			continue;
+		}
+		const auto enter = ((direction[axis] > 0 ? low : high) - origin[axis]) / direction[axis];
+		const auto exit = ((direction[axis] > 0 ? high : low) - origin[axis]) / direction[axis];
+		if (enter > start)
+		{
+			start = enter;
+			entryAxis = axis;
+		}
+		end = (min)(end, exit);
+	}
+	if (start > end)
+	{
+		return false;
+	}
+
+	int cell[3]{};
+	int step[3]{};
+	int normal[3]{};
+	float next[3]{};
+	float increment[3]{};
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		cell[axis] = (min)((max)(static_cast<int>(floor(origin[axis] + direction[axis] * start + 0.5f)), 0), size[axis] - 1);
+		if (direction[axis] == 0)
+		{
+			next[axis] = infinity;
+			increment[axis] = infinity;
+			continue;
+		}
+		step[axis] = direction[axis] > 0 ? 1 : -1;
+		next[axis] = (cell[axis] + step[axis] * 0.5f - origin[axis]) / direction[axis];
+		increment[axis] = 1.0f / abs(direction[axis]);
+	}
+	if (entryAxis >= 0)
+	{
+		normal[entryAxis] = -step[entryAxis];
+	}
+
+	auto distance = start;
+	while (!IsSolid(cell[0], cell[1], cell[2]))
+	{
+		const auto axis = next[0] <= next[1] ? (next[0] <= next[2] ? 0 : 2) : (next[1] <= next[2] ? 1 : 2);
+		if (next[axis] > end)
+		{
+			return false;
+		}
+		distance = next[axis];
+		next[axis] += increment[axis];
+		cell[axis] += step[axis];
+		normal[0] = normal[1] = normal[2] = 0;
+		normal[axis] = -step[axis];
+	}
+	pHit = RayHit{ XMINT3(cell[0], cell[1], cell[2]), XMINT3(normal[0], normal[1], normal[2]), distance, true };
+	return true;
+}
+
+/// <summary>
+/// Casts a batch of rays - runs of four rays heading into the same octant are traced together as a SIMD packet, the rest one at a time
+/// </summary>
+/// <param name="pRays"> the rays in grid space </param>
+/// <param name="pHits"> filled with one hit per ray, in the same order </param>
+void VoxelStore::Raycast(const vector<TerrainRay>& pRays, vector<RayHit>& pHits) const
+{
+	pHits.resize(pRays.size());
+	size_t i = 0;
+	for (; i + 4 <= pRays.size(); i += 4)
+	{
+		//rays in the same octant step the same way, so the lanes of a packet stay together for most of the walk
+		auto coherent = true;
+		for (auto lane = 1; lane < 4; ++lane)
+		{
+			const auto& first = pRays[i].mDirection;
+			const auto& other = pRays[i + lane].mDirection;
+			coherent = coherent && (first.x < 0) == (other.x < 0) && (first.y < 0) == (other.y < 0) && (first.z < 0) == (other.z < 0);
+		}
+		if (coherent)
+		{
+			RaycastPacket(&pRays[i], &pHits[i]);
+#ifdef _DEBUG
+			//debug builds walk every packed ray again on its own, the packet must find the same cell through the same face
+			for (auto lane = 0; lane < 4; ++lane)
+			{
+				RayHit scalar{};
+				Raycast(pRays[i + lane], scalar);
+				const auto& packed = pHits[i + lane];
+				assert(packed.mHit == scalar.mHit);
+				assert(!scalar.mHit || (packed.mCell.x == scalar.mCell.x && packed.mCell.y == scalar.mCell.y && packed.mCell.z == scalar.mCell.z &&
+					packed.mNormal.x == scalar.mNormal.x && packed.mNormal.y == scalar.mNormal.y && packed.mNormal.z == scalar.mNormal.z &&
+					fabs(packed.mDistance - scalar.mDistance) <= 1e-3f * (1 + scalar.mDistance)));
+			}
+#endif
+			continue;
+		}
+		for (auto lane = 0; lane < 4; ++lane)
+		{
+			Raycast(pRays[i + lane], pHits[i + lane]);
+		}
+	}
+	for (; i < pRays.size(); ++i)
+	{
+		Raycast(pRays[i], pHits[i]);
+	}
+}
+
+/// <summary>
+/// Casts four rays together, the same walk as Raycast with each lane of a vector holding one ray
+/// Every lane is stepped until the last one finishes, lanes which have finished are stepped but no longer read
+/// </summary>
+/// <param name="pRays"> the four rays in grid space </param>
+/// <param name="pHits"> filled with the four hits </param>
+void VoxelStore::RaycastPacket(const TerrainRay* const pRays, RayHit* const pHits) const
+{
+	XMFLOAT4 originX{};
+	XMFLOAT4 originY{};
+	XMFLOAT4 originZ{};
+	XMFLOAT4 directionX{};
+	XMFLOAT4 directionY{};
+	XMFLOAT4 directionZ{};
+	XMFLOAT4 maxDistance{};
+	float* const lanes[7] = { &originX.x, &originY.x, &originZ.x, &directionX.x, &directionY.x, &directionZ.x, &maxDistance.x };
+	for (auto lane = 0; lane < 4; ++lane)
+	{
+		const auto& ray = pRays[lane];
+		const float values[7] = { ray.mOrigin.x, ray.mOrigin.y, ray.mOrigin.z, ray.mDirection.x, ray.mDirection.y, ray.mDirection.z, ray.mMaxDistance };
+		for (auto field = 0; field < 7; ++field)
+		{
+			lanes[field][lane] = values[field];
+		}
+		pHits[lane] = RayHit{ XMINT3(0, 0, 0), XMINT3(0, 0, 0), 0, false };
+	}
+
+	const XMVECTOR origin[3] = { XMLoadFloat4(&originX), XMLoadFloat4(&originY), XMLoadFloat4(&originZ) };
+	XMVECTOR direction[3] = { XMLoadFloat4(&directionX), XMLoadFloat4(&directionY), XMLoadFloat4(&directionZ) };
+	const auto length = XMVectorSqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+	const auto zero = XMVectorZero();
+	const auto half = XMVectorReplicate(0.5f);
+	const auto infinity = XMVectorReplicate(numeric_limits<float>::infinity());
+	const float size[3] = { static_cast<float>(SizeX()), static_cast<float>(SizeY()), static_cast<float>(SizeZ()) };
+
+	//clip each ray to the box around every cell, an axis the ray does not move along either holds it all or none of it
+	auto start = zero;
+	auto end = XMLoadFloat4(&maxDistance);
+	XMVECTOR enter[3];
+	XMVECTOR step[3];
+	XMVECTOR still[3];
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		direction[axis] = XMVectorSelect(zero, direction[axis] / length, XMVectorGreater(length, zero));
+		still[axis] = XMVectorEqual(direction[axis], zero);
+		const auto positive = XMVectorGreater(direction[axis], zero);
+		step[axis] = XMVectorSelect(XMVectorSelect(XMVectorReplicate(-1.0f), XMVectorReplicate(1.0f), positive), zero, still[axis]);
+		const auto low = XMVectorReplicate(-0.5f);
+		const auto high = XMVectorReplicate(size[axis] - 0.5f);
+		const auto inside = XMVectorAndInt(XMVectorGreaterOrEqual(origin[axis], low), XMVectorLessOrEqual(origin[axis], high));
+		const auto entry = (XMVectorSelect(high, low, positive) - origin[axis]) / direction[axis];
+		const auto exit = (XMVectorSelect(low, high, positive) - origin[axis]) / direction[axis];
+		enter[axis] = XMVectorSelect(entry, XMVectorSelect(infinity, -infinity, inside), still[axis]);
+		start = XMVectorMax(start, enter[axis]);
+		end = XMVectorMin(end, XMVectorSelect(exit, XMVectorSelect(-infinity, infinity, inside), still[axis]));
+	}
+
+	XMVECTOR cell[3];
+	XMVECTOR next[3];
+	XMVECTOR increment[3];
+	XMVECTOR normal[3];
+	for (auto axis = 0; axis < 3; ++axis)
+	{
+		cell[axis] = XMVectorClamp(XMVectorFloor(origin[axis] + direction[axis] * start + half), zero, XMVectorReplicate(size[axis] - 1));
+		next[axis] = XMVectorSelect((cell[axis] + step[axis] * half - origin[axis]) / direction[axis], infinity, still[axis]);
+		increment[axis] = XMVectorSelect(XMVectorAbs(XMVectorReciprocal(direction[axis])), infinity, still[axis]);
+		//the face a ray came in through is on the axis which clipped it last, a ray starting inside the box came through none
+		normal[axis] = XMVectorSelect(zero, -step[axis], XMVectorAndInt(XMVectorEqual(enter[axis], start), XMVectorGreater(start, zero)));
+	}
+	//a ray clipped by two axes at once keeps only the first
+	normal[1] = XMVectorSelect(normal[1], zero, XMVectorEqual(XMVectorAbs(normal[0]), XMVectorReplicate(1.0f)));
+	normal[2] = XMVectorSelect(normal[2], zero, XMVectorOrInt(XMVectorEqual(XMVectorAbs(normal[0]), XMVectorReplicate(1.0f)), XMVectorEqual(XMVectorAbs(normal[1]), XMVectorReplicate(1.0f))));
+
+	XMFLOAT4 startLanes{};
+	XMFLOAT4 endLanes{};
+	XMStoreFloat4(&startLanes, start);
+	XMStoreFloat4(&endLanes, end);
+	bool active[4]{};
+	auto remaining = 0;
+	for (auto lane = 0; lane < 4; ++lane)
+	{
+		active[lane] = (&startLanes.x)[lane] <= (&endLanes.x)[lane] && (&directionX.x)[lane] * (&directionX.x)[lane] + (&directionY.x)[lane] * (&directionY.x)[lane] + (&directionZ.x)[lane] * (&directionZ.x)[lane] > 0;
+		remaining += active[lane] ? 1 : 0;
+	}
+
+	auto distance = start;
+	while (remaining > 0)
+	{
+		XMFLOAT4 cellX{};
+		XMFLOAT4 cellY{};
+		XMFLOAT4 cellZ{};
+		XMStoreFloat4(&cellX, cell[0]);
+		XMStoreFloat4(&cellY, cell[1]);
+		XMStoreFloat4(&cellZ, cell[2]);
+		for (auto lane = 0; lane < 4; ++lane)
+		{
+			if (!active[lane])
+			{
+				continue;
+			}
+			const auto x = static_cast<int>((&cellX.x)[lane]);
+			const auto y = static_cast<int>((&cellY.x)[lane]);
+			const auto z = static_cast<int>((&cellZ.x)[lane]);
+			if (IsSolid(x, y, z))
+			{
+				XMFLOAT4 normalX{};
+				XMFLOAT4 normalY{};
+				XMFLOAT4 normalZ{};
+				XMFLOAT4 distances{};
+				XMStoreFloat4(&normalX, normal[0]);
+				XMStoreFloat4(&normalY, normal[1]);
+				XMStoreFloat4(&normalZ, normal[2]);
+				XMStoreFloat4(&distances, distance);
+				pHits[lane] = RayHit{ XMINT3(x, y, z), XMINT3(static_cast<int>((&normalX.x)[lane]), static_cast<int>((&normalY.x)[lane]), static_cast<int>((&normalZ.x)[lane])), (&distances.x)[lane], true };
+				active[lane] = false;
+				--remaining;
+			}
+		}
+
+		//every lane steps across the nearest of its three cell faces
+		const auto alongX = XMVectorAndInt(XMVectorLessOrEqual(next[0], next[1]), XMVectorLessOrEqual(next[0], next[2]));
+		const auto alongY = XMVectorAndInt(XMVectorLessOrEqual(next[1], next[2]), XMVectorEqual(alongX, zero));
+		const auto alongZ = XMVectorEqual(XMVectorOrInt(alongX, alongY), zero);
+		const XMVECTOR along[3] = { alongX, alongY, alongZ };
+		distance = XMVectorSelect(XMVectorSelect(next[2], next[1], alongY), next[0], alongX);
+		for (auto axis = 0; axis < 3; ++axis)
+		{
+			cell[axis] = XMVectorSelect(cell[axis], cell[axis] + step[axis], along[axis]);
+			next[axis] = XMVectorSelect(next[axis], next[axis] + increment[axis], along[axis]);
+			normal[axis] = XMVectorSelect(zero, -step[axis], along[axis]);
+		}
+
+		XMFLOAT4 distances{};
+		XMStoreFloat4(&distances, distance);
+		for (auto lane = 0; lane < 4; ++lane)
+		{
+			if (active[lane] && (&distances.x)[lane] > (&endLanes.x)[lane])
+			{
+				active[lane] = false;
+				--remaining;
+			}
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include "VoxelHit.h"
+#include "TerrainRay.h"
+#include "RayHit.h"
+
+//Interface for the terrain occupancy stores - cells are indexed by integer coordinates and cells outside the store are always empty
+class VoxelStore
+{
+	void RaycastPacket(const TerrainRay* const pRays, RayHit* const pHits) const;
+
+public:
+	VoxelStore() = default;
+	virtual ~VoxelStore() = default;
+
+	virtual std::unique_ptr<VoxelStore> Clone() const = 0;
+
+	virtual void Resize(const int pSizeX, const int pSizeY, const int pSizeZ) = 0;
+	virtual void Fill(const bool pSolid) = 0;
+
+	virtual const bool IsSolid(const int pX, const int pY, const int pZ) const = 0;
+	virtual void Set(const int pX, const int pY, const int pZ) = 0;
+	virtual void Clear(const int pX, const int pY, const int pZ) = 0;
+
+	virtual const bool OverlapsSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) const = 0;
+	virtual int CarveSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) = 0;
+	virtual void ExposedCells(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax, std::vector<DirectX::XMINT3>& pCells) const = 0;
+
+	virtual const int SizeX() const = 0;
+	virtual const int SizeY() const = 0;
+	virtual const int SizeZ() const = 0;
+	virtual const int Count() const = 0;
+	virtual const size_t MemoryBytes() const = 0;
+
+	const bool SweepSphere(const DirectX::XMFLOAT3& pFrom, const DirectX::XMFLOAT3& pTo, const float pRadius, VoxelHit& pHit) const;
+	const int CountSphere(const DirectX::XMFLOAT3& pCentre, const float pRadius) const;
+	const bool Raycast(const TerrainRay& pRay, RayHit& pHit) const;
+	void Raycast(const std::vector<TerrainRay>& pRays, std::vector<RayHit>& pHits) const;
+
+	//A cell is exposed when it is solid and at least one of its six neighbours is empty
+	const bool IsExposed(const int pX, const int pY, const int pZ) const
+	{
+		return IsSolid(pX, pY, pZ) &&
+			(!IsSolid(pX - 1, pY, pZ) || !IsSolid(pX + 1, pY, pZ) ||
+			!IsSolid(pX, pY - 1, pZ) || !IsSolid(pX, pY + 1, pZ) ||
+			!IsSolid(pX, pY, pZ - 1) || !IsSolid(pX, pY, pZ + 1));
+	}
+};
@@ -0,0 +1,505 @@
+#include "VoxelTerrain.h"
+#include <algorithm>
+#include <cmath>
+#include "ParallelFor.h"
+
+using namespace DirectX;
+using namespace std;
+
+/// <summary>
+/// Fills the terrain as a solid block and instances the cubes on its surface
+/// </summary>
+/// <param name="pSizeX"> the number of cubes in x </param>
+/// <param name="pSizeY"> the number of cubes in y </param>
+/// <param name="pSizeZ"> the number of cubes in z </param>
+void VoxelTerrain::Generate(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	Setup(pSizeX, pSizeY, pSizeZ);
+	mStore->Fill(true);
+	RebuildInstances();
+	MarkAllChunksDirty();
+}
+
+/// <summary>
+/// Fills the terrain using the generator and instances the cubes on its surface
+/// </summary>
+/// <param name="pSizeX"> the number of cubes in x </param>
+/// <param name="pSizeY"> the number of cubes in y </param>
+/// <param name="pSizeZ"> the number of cubes in z </param>
+/// <param name="pGenerator"> the generator which decides which cells are solid </param>
+void VoxelTerrain::Generate(const int pSizeX, const int pSizeY, const int pSizeZ, const TerrainGenerator& pGenerator)
+{
+	Setup(pSizeX, pSizeY, pSizeZ);
+	if (mStorage == VoxelStorage::OCTREE)
+	{
+		pGenerator.Generate(mOctree);
+	}
+	else if (mStorage == VoxelStorage::COLUMNS)
+	{
+		pGenerator.Generate(mColumns);
+	}
+	else
+	{
+		pGenerator.Generate(mGrid);
+	}
+	RebuildInstances();
+	MarkAllChunksDirty();
+}
+
+/// <summary>
+/// Fills the terrain from a mapped snapshot and instances the cubes on its surface
+/// The dense grid copies the mapped words as they are, the sparse stores are built from the mapped bits
+/// </summary>
+/// <param name="pSnapshot"> an open snapshot, its size replaces the size of the terrain </param>
+void VoxelTerrain::Load(const TerrainSnapshot& pSnapshot)
+{
+	const auto& header = pSnapshot.Header();
+	Setup(header.mSizeX, header.mSizeY, header.mSizeZ);
+	if (mStorage == VoxelStorage::OCTREE)
+	{
+		mOctree.Build([](const XMINT3&, const XMINT3&)
+		{
+			return VoxelOctree::RegionState::MIXED;
+		}, [&pSnapshot](const int pX, const int pY, const int pZ)
+		{
+			return pSnapshot.IsSolid(pX, pY, pZ);
+		});
+	}
+	else if (mStorage == VoxelStorage::COLUMNS)
+	{
+		mColumns.Build([&pSnapshot](const int pX, const int pY, const int pZ)
+		{
+			return pSnapshot.IsSolid(pX, pY, pZ);
+		});
+	}
+	else
+	{
+		mGrid.Load(pSnapshot.Occupancy());
+	}
+	RebuildInstances();
+	MarkAllChunksDirty();
+}
+
+/// <summary>
+/// Chooses the occupancy store used from the next call to Generate
+/// </summary>
+/// <param name="pStorage"> the kind of store to keep the terrain in </param>
+void VoxelTerrain::SetStorage(const VoxelStorage pStorage)
+{
+	mStorage = pStorage;
+}
+
+/// <summary>
+/// Resizes the active store and the chunk bookkeeping, leaving the terrain empty - the unused stores are emptied to free their memory
+/// </summary>
+/// <param name="pSizeX"> the number of cubes in x </param>
+/// <param name="pSizeY"> the number of cubes in y </param>
+/// <param name="pSizeZ"> the number of cubes in z </param>
+void VoxelTerrain::Setup(const int pSizeX, const int pSizeY, const int pSizeZ)
+{
+	if (mStorage != VoxelStorage::DENSE)
+	{
+		mGrid = VoxelGrid();
+	}
+	if (mStorage != VoxelStorage::OCTREE)
+	{
+		mOctree = VoxelOctree();
+	}
+	if (mStorage != VoxelStorage::COLUMNS)
+	{
+		mColumns = VoxelColumns();
+	}
+	mStore = mStorage == VoxelStorage::OCTREE ? static_cast<VoxelStore*>(&mOctree) :
+		mStorage == VoxelStorage::COLUMNS ? static_cast<VoxelStore*>(&mColumns) : static_cast<VoxelStore*>(&mGrid);
+	mStore->Resize(pSizeX, pSizeY, pSizeZ);
+	mChunks = XMINT3((pSizeX + CHUNK_SIZE - 1) / CHUNK_SIZE, (pSizeY + CHUNK_SIZE - 1) / CHUNK_SIZE, (pSizeZ + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	mChunkData.assign(mChunks.x * mChunks.y * mChunks.z, nullptr);
+	mPristineChunks.clear();
+	mSpareChunks.clear();
+	mPristine.reset();
+	mChangedChunks.clear();
+	mDamage.clear();
+	mChunkDirty.assign(mChunks.x * mChunks.y * mChunks.z, false);
+	mDirtyChunks.clear();
+}
+
+/// <summary>
+/// Rebuilds the instances of every chunk from the store - chunks are independent so they are shared out between threads,
+/// each chunk gathers its exposed cells first so its instances and slots are reserved exactly
+/// </summary>
+void VoxelTerrain::RebuildInstances()
+{
+	ParallelFor(ChunkCount(), [this](const int pBegin, const int pEnd)
+	{
+		XMINT3 minCell{};
+		XMINT3 maxCell{};
+		vector<XMINT3> cells;
+		for (auto chunk = pBegin; chunk < pEnd; ++chunk)
+		{
+			ChunkBounds(chunk, minCell, maxCell);
+			mStore->ExposedCells(minCell, maxCell, cells);
+
+			auto data = make_shared<Chunk>();
+			data->mInstances.reserve(cells.size());
+			data->mSlots.reserve(cells.size());
+			for (const auto& cell : cells)
+			{
+				data->mSlots.push_back(LocalCell(cell.x, cell.y, cell.z) << 16 | static_cast<uint32_t>(data->mInstances.size()));
+				data->mInstances.emplace_back(Instance{ XMFLOAT3(static_cast<float>(cell.x), static_cast<float>(cell.y), static_cast<float>(cell.z)) });
+			}
+			sort(data->mSlots.begin(), data->mSlots.end());
+			mChunkData[chunk] = move(data);
+		}
+	});
+
+	mInstanceCount = 0;
+	for (const auto& data : mChunkData)
+	{
+		mInstanceCount += static_cast<int>(data->mInstances.size());
+	}
+	KeepPristine();
+}
+
+/// <summary>
+/// Keeps the freshly built terrain as the state a reset returns to - the store is copied once and every chunk is shared rather than copied
+/// </summary>
+void VoxelTerrain::KeepPristine()
+{
+	mPristine = mStore->Clone();
+	mPristineChunks = mChunkData;
+	mChangedChunks.clear();
+	mDamage.clear();
+}
+
+/// <summary>
+/// Gets a chunk ready to be changed - a chunk still shared with the pristine copy is copied first and remembered for the next reset
+/// </summary>
+/// <param name="pChunk"> the index of the chunk </param>
+/// <returns> the chunk, owned by the terrain alone </returns>
+VoxelTerrain::Chunk& VoxelTerrain::OwnChunk(const int pChunk)
+{
+	auto& data = mChunkData[pChunk];
+	if (data.use_count() > 1)
+	{
+		if (mSpareChunks.empty())
+		{
+			data = make_shared<Chunk>(*data);
+		}
+		else
+		{
+			*mSpareChunks.back() = *data;
+			data = move(mSpareChunks.back());
+			mSpareChunks.pop_back();
+		}
+		mChangedChunks.push_back(pChunk);
+	}
+	return *data;
+}
+
+/// <summary>
+/// Returns the terrain to how it was last built - only the cells under each crater are restored and the changed chunks are handed their
+/// pristine copies back, so the cost follows the damage done rather than the size of the terrain
+/// </summary>
+void VoxelTerrain::Reset()
+{
+	if (!mPristine)
+	{
+		return;
+	}
+
+	for (const auto& damage : mDamage)
+	{
+		for (auto z = damage.first.z; z <= damage.second.z; ++z)
+		{
+			for (auto y = damage.first.y; y <= damage.second.y; ++y)
+			{
+				for (auto x = damage.first.x; x <= damage.second.x; ++x)
+				{
+					if (mPristine->IsSolid(x, y, z) && !mStore->IsSolid(x, y, z))
+					{
+						mStore->Set(x, y, z);
+					}
+				}
+			}
+		}
+		//a greedy mesh reads its neighbours across chunk borders, so a chunk next to a crater can hold faces towards it without any instance changing
+		//every chunk the crater and its one cell shell touch is remeshed, just as the carve remeshed them
+		MarkDirty(XMINT3(damage.first.x - 1, damage.first.y - 1, damage.first.z - 1), XMINT3(damage.second.x + 1, damage.second.y + 1, damage.second.z + 1));
+	}
+
+	XMINT3 minCell{};
+	XMINT3 maxCell{};
+	for (const auto chunk : mChangedChunks)
+	{
+		mInstanceCount += static_cast<int>(mPristineChunks[chunk]->mInstances.size()) - static_cast<int>(mChunkData[chunk]->mInstances.size());
+		mSpareChunks.push_back(move(mChunkData[chunk]));
+		mChunkData[chunk] = mPristineChunks[chunk];
+		ChunkBounds(chunk, minCell, maxCell);
+		MarkDirty(minCell, maxCell);
+	}
+
+	mChangedChunks.clear();
+	mDamage.clear();
+}
+
+/// <summary>
+/// Checks if the terrain is unchanged since it was last built
+/// </summary>
+/// <returns> true if there is nothing for a reset to undo </returns>
+const bool VoxelTerrain::IsPristine() const
+{
+	return mDamage.empty() && mChangedChunks.empty();
+}
+
+/// <summary>
+/// Checks if the cell holds a cube which can be seen - a cube is hidden when all six neighbours are solid
+/// </summary>
+/// <returns> true if the cell is solid and at least one face is uncovered </returns>
+const bool VoxelTerrain::IsExposed(const int pX, const int pY, const int pZ) const
+{
+	return mStore->IsExposed(pX, pY, pZ);
+}
+
+/// <summary>
+/// Finds the chunk which contains the cell
+/// </summary>
+/// <returns> the index of the chunk </returns>
+int VoxelTerrain::ChunkOf(const int pX, const int pY, const int pZ) const
+{
+	return ((pZ / CHUNK_SIZE) * mChunks.y + pY / CHUNK_SIZE) * mChunks.x + pX / CHUNK_SIZE;
+}
+
+/// <summary>
+/// Finds the position of a cell within its chunk
+/// </summary>
+/// <returns> the index of the cell among the cells of its chunk </returns>
+uint32_t VoxelTerrain::LocalCell(const int pX, const int pY, const int pZ)
+{
+	return static_cast<uint32_t>(((pZ % CHUNK_SIZE) * CHUNK_SIZE + pY % CHUNK_SIZE) * CHUNK_SIZE + pX % CHUNK_SIZE);
+}
+
+/// <summary>
+/// Finds where the slot of a cell is, or would be, in the sorted slots of a chunk
+/// </summary>
+/// <param name="pChunk"> the chunk to search </param>
+/// <param name="pCell"> the cell within the chunk </param>
+/// <returns> the first slot entry which is not below the cell </returns>
+vector<uint32_t>::iterator VoxelTerrain::FindSlot(Chunk& pChunk, const uint32_t pCell)
+{
+	return lower_bound(pChunk.mSlots.begin(), pChunk.mSlots.end(), pCell << 16);
+}
+
+/// <summary>
+/// Checks if a cell has an instance in a chunk without changing the chunk
+/// </summary>
+/// <param name="pChunk"> the chunk to search </param>
+/// <param name="pCell"> the cell within the chunk </param>
+/// <returns> true if the cell is instanced </returns>
+const bool VoxelTerrain::HasSlot(const Chunk& pChunk, const uint32_t pCell)
+{
+	const auto it = lower_bound(pChunk.mSlots.begin(), pChunk.mSlots.end(), pCell << 16);
+	return it != pChunk.mSlots.end() && (*it >> 16) == pCell;
+}
+
+/// <summary>
+/// Adds an instance for the cell if it does not already have one
+/// </summary>
+void VoxelTerrain::Emit(const int pX, const int pY, const int pZ)
+{
+	const auto chunk = ChunkOf(pX, pY, pZ);
+	const auto cell = LocalCell(pX, pY, pZ);
+	if (HasSlot(*mChunkData[chunk], cell))
+	{
+		return;
+	}
+	auto& data = OwnChunk(chunk);
+	data.mSlots.insert(FindSlot(data, cell), cell << 16 | static_cast<uint32_t>(data.mInstances.size()));
+	data.mInstances.emplace_back(Instance{ XMFLOAT3(static_cast<float>(pX), static_cast<float>(pY), static_cast<float>(pZ)) });
+	++mInstanceCount;
+}
+
+/// <summary>
+/// Removes the instance of the cell if it has one, the last instance is moved into the hole
+/// </summary>
+void VoxelTerrain::Retire(const int pX, const int pY, const int pZ)
+{
+	const auto chunk = ChunkOf(pX, pY, pZ);
+	const auto cell = LocalCell(pX, pY, pZ);
+	if (!HasSlot(*mChunkData[chunk], cell))
+	{
+		return;
+	}
+	auto& data = OwnChunk(chunk);
+	const auto it = FindSlot(data, cell);
+	const auto slot = *it & 0xFFFF;
+	data.mSlots.erase(it);
+	if (slot != data.mInstances.size() - 1)
+	{
+		const auto& moved = data.mInstances.back().mPosition;
+		auto& movedSlot = *FindSlot(data, LocalCell(static_cast<int>(moved.x), static_cast<int>(moved.y), static_cast<int>(moved.z)));
+		movedSlot = (movedSlot & 0xFFFF0000) | slot;
+		data.mInstances[slot] = data.mInstances.back();
+	}
+	data.mInstances.pop_back();
+	--mInstanceCount;
+}
+
+/// <summary>
+/// Re-evaluates the visibility of every cell in the range, emitting newly exposed cubes and retiring removed ones
+/// </summary>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+void VoxelTerrain::Refresh(const XMINT3& pMin, const XMINT3& pMax)
+{
+	for (auto z = max(pMin.z, 0); z <= min(pMax.z, mStore->SizeZ() - 1); ++z)
+	{
+		for (auto y = max(pMin.y, 0); y <= min(pMax.y, mStore->SizeY() - 1); ++y)
+		{
+			for (auto x = max(pMin.x, 0); x <= min(pMax.x, mStore->SizeX() - 1); ++x)
+			{
+				if (IsExposed(x, y, z))
+				{
+					Emit(x, y, z);
+				}
+				else
+				{
+					Retire(x, y, z);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Carves a crater out of the terrain and updates only the instances around it
+/// </summary>
+/// <param name="pCentre"> the centre of the crater in grid space </param>
+/// <param name="pRadius"> the radius of the crater in grid space </param>
+/// <returns> the number of cubes which were destroyed </returns>
+int VoxelTerrain::Carve(const XMFLOAT3& pCentre, const float pRadius)
+{
+	const auto removed = mStore->CarveSphere(pCentre, pRadius);
+	if (removed > 0)
+	{
+		//the crater and a one cell shell around it are the only cells whose visibility can change
+		const auto minCell = XMINT3(static_cast<int>(floor(pCentre.x - pRadius)) - 1, static_cast<int>(floor(pCentre.y - pRadius)) - 1, static_cast<int>(floor(pCentre.z - pRadius)) - 1);
+		const auto maxCell = XMINT3(static_cast<int>(ceil(pCentre.x + pRadius)) + 1, static_cast<int>(ceil(pCentre.y + pRadius)) + 1, static_cast<int>(ceil(pCentre.z + pRadius)) + 1);
+		//only cells whose centres are inside the sphere can have been emptied, so only they need restoring on a reset
+		mDamage.emplace_back(XMINT3(max(static_cast<int>(ceil(pCentre.x - pRadius)), 0), max(static_cast<int>(ceil(pCentre.y - pRadius)), 0), max(static_cast<int>(ceil(pCentre.z - pRadius)), 0)),
+			XMINT3(min(static_cast<int>(floor(pCentre.x + pRadius)), mStore->SizeX() - 1), min(static_cast<int>(floor(pCentre.y + pRadius)), mStore->SizeY() - 1), min(static_cast<int>(floor(pCentre.z + pRadius)), mStore->SizeZ() - 1)));
+		Refresh(minCell, maxCell);
+		MarkDirty(minCell, maxCell);
+	}
+	return removed;
+}
+
+/// <summary>
+/// Marks every chunk overlapping the range of cells as needing to be rebuilt
+/// </summary>
+/// <param name="pMin"> the lowest cell in the range </param>
+/// <param name="pMax"> the highest cell in the range (inclusive) </param>
+void VoxelTerrain::MarkDirty(const XMINT3& pMin, const XMINT3& pMax)
+{
+	const auto minX = max(pMin.x, 0) / CHUNK_SIZE;
+	const auto minY = max(pMin.y, 0) / CHUNK_SIZE;
+	const auto minZ = max(pMin.z, 0) / CHUNK_SIZE;
+	const auto maxX = min(pMax.x / CHUNK_SIZE, mChunks.x - 1);
+	const auto maxY = min(pMax.y / CHUNK_SIZE, mChunks.y - 1);
+	const auto maxZ = min(pMax.z / CHUNK_SIZE, mChunks.z - 1);
+	for (auto z = minZ; z <= maxZ; ++z)
+	{
+		for (auto y = minY; y <= maxY; ++y)
+		{
+			for (auto x = minX; x <= maxX; ++x)
+			{
+				const auto chunk = (z * mChunks.y + y) * mChunks.x + x;
+				if (!mChunkDirty[chunk])
+				{
+					mChunkDirty[chunk] = true;
+					mDirtyChunks.push_back(chunk);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets the number of chunks the terrain is split into
+/// </summary>
+/// <returns> the number of chunks </returns>
+const int VoxelTerrain::ChunkCount() const
+{
+	return static_cast<int>(mChunkDirty.size());
+}
+
+/// <summary>
+/// Gets the range of cells covered by a chunk, chunks on the far edges may be smaller than CHUNK_SIZE
+/// </summary>
+/// <param name="pChunk"> the index of the chunk </param>
+/// <param name="pMin"> receives the lowest cell of the chunk </param>
+/// <param name="pMax"> receives the highest cell of the chunk (inclusive) </param>
+void VoxelTerrain::ChunkBounds(const int pChunk, XMINT3& pMin, XMINT3& pMax) const
+{
+	const auto x = pChunk % mChunks.x;
+	const auto y = (pChunk / mChunks.x) % mChunks.y;
+	const auto z = pChunk / (mChunks.x * mChunks.y);
+	pMin = XMINT3(x * CHUNK_SIZE, y * CHUNK_SIZE, z * CHUNK_SIZE);
+	pMax = XMINT3(min(pMin.x + CHUNK_SIZE, mStore->SizeX()) - 1, min(pMin.y + CHUNK_SIZE, mStore->SizeY()) - 1, min(pMin.z + CHUNK_SIZE, mStore->SizeZ()) - 1);
+}
+
+/// <summary>
+/// Gets the chunks which have changed since the dirty list was last cleared
+/// </summary>
+/// <returns> a list of chunk indices </returns>
+const std::vector<int>& VoxelTerrain::DirtyChunks() const
+{
+	return mDirtyChunks;
+}
+
+/// <summary>
+/// Clears the dirty list once every changed chunk has been rebuilt
+/// </summary>
+void VoxelTerrain::ClearDirtyChunks()
+{
+	for (const auto chunk : mDirtyChunks)
+	{
+		mChunkDirty[chunk] = false;
+	}
+	mDirtyChunks.clear();
+}
+
+/// <summary>
+/// Marks the whole terrain as needing to be rebuilt
+/// </summary>
+void VoxelTerrain::MarkAllChunksDirty()
+{
+	MarkDirty(XMINT3(0, 0, 0), XMINT3(mStore->SizeX() - 1, mStore->SizeY() - 1, mStore->SizeZ() - 1));
+}
+
+/// <summary>
+/// Gets the occupancy store of the terrain
+/// </summary>
+/// <returns> a reference to the active store </returns>
+const VoxelStore& VoxelTerrain::Store() const
+{
+	return *mStore;
+}
+
+/// <summary>
+/// Gets the instances of the visible cubes in a chunk
+/// </summary>
+/// <param name="pChunk"> the index of the chunk </param>
+/// <returns> a list of instances for every exposed cube in the chunk </returns>
+const std::vector<Instance>& VoxelTerrain::ChunkInstances(const int pChunk) const
+{
+	return mChunkData[pChunk]->mInstances;
+}
+
+/// <summary>
+/// Gets the number of visible cubes across every chunk
+/// </summary>
+/// <returns> the number of instanced cubes </returns>
+const int VoxelTerrain::InstanceCount() const
+{
+	return mInstanceCount;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <directxmath.h>
+#include <vector>
+#include <memory>
+#include "VoxelGrid.h"
+#include "VoxelOctree.h"
+#include "VoxelColumns.h"
+#include "VoxelStorage.h"
+#include "TerrainSnapshot.h"
+#include "Instance.h"
+#include "TerrainGenerator.h"
+
+//Destructible terrain - the occupancy store is the source of truth and only cubes with an empty neighbour are instanced
+//The terrain is split into chunks which each keep their own instances so a crater only touches the chunks around it
+//A pristine copy of the store and of every chunk is kept from the last build, chunks are shared with it until they are first changed
+//so a reset only has to undo the craters and hand the changed chunks their pristine instances back
+class VoxelTerrain
+{
+	//The slots are sorted entries of (cell within the chunk << 16 | index into mInstances), two flat lists make a chunk cheap to copy and to drop
+	struct Chunk
+	{
+		std::vector<Instance> mInstances;
+		std::vector<uint32_t> mSlots;
+	};
+
+	VoxelGrid mGrid;
+	VoxelOctree mOctree;
+	VoxelColumns mColumns;
+	VoxelStorage mStorage = VoxelStorage::DENSE;
+	VoxelStore* mStore = &mGrid;
+	std::vector<std::shared_ptr<Chunk>> mChunkData;
+	std::vector<std::shared_ptr<Chunk>> mPristineChunks;
+	std::vector<std::shared_ptr<Chunk>> mSpareChunks;	//copies dropped by a reset, reused so carving after a reset does not allocate
+	std::unique_ptr<const VoxelStore> mPristine;
+	std::vector<int> mChangedChunks;
+	std::vector<std::pair<DirectX::XMINT3, DirectX::XMINT3>> mDamage;
+	int mInstanceCount = 0;
+	DirectX::XMINT3 mChunks{};
+	std::vector<bool> mChunkDirty;
+	std::vector<int> mDirtyChunks;
+
+	int ChunkOf(const int pX, const int pY, const int pZ) const;
+	static uint32_t LocalCell(const int pX, const int pY, const int pZ);
+	static std::vector<uint32_t>::iterator FindSlot(Chunk& pChunk, const uint32_t pCell);
+	static const bool HasSlot(const Chunk& pChunk, const uint32_t pCell);
+	Chunk& OwnChunk(const int pChunk);
+	void KeepPristine();
+	void Emit(const int pX, const int pY, const int pZ);
+	void Retire(const int pX, const int pY, const int pZ);
+	void Refresh(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax);
+	void Setup(const int pSizeX, const int pSizeY, const int pSizeZ);
+	void RebuildInstances();
+	void MarkDirty(const DirectX::XMINT3& pMin, const DirectX::XMINT3& pMax);
+
+public:
+	static const int CHUNK_SIZE = 16;
+
+	VoxelTerrain() = default;
+	~VoxelTerrain() = default;
+
+	VoxelTerrain& operator=(const VoxelTerrain& pVoxelTerrain) = delete;
+	VoxelTerrain(const VoxelTerrain& pVoxelTerrain) = delete;
+
+	void SetStorage(const VoxelStorage pStorage);
+
+	void Generate(const int pSizeX, const int pSizeY, const int pSizeZ);
+	void Generate(const int pSizeX, const int pSizeY, const int pSizeZ, const TerrainGenerator& pGenerator);
+	void Load(const TerrainSnapshot& pSnapshot);
+	const bool IsExposed(const int pX, const int pY, const int pZ) const;
+	int Carve(const DirectX::XMFLOAT3& pCentre, const float pRadius);
+	void Reset();
+	const bool IsPristine() const;
+
+	const VoxelStore& Store() const;
+	const std::vector<Instance>& ChunkInstances(const int pChunk) const;
+	const int InstanceCount() const;
+
+	const int ChunkCount() const;
+	void ChunkBounds(const int pChunk, DirectX::XMINT3& pMin, DirectX::XMINT3& pMax) const;
+	const std::vector<int>& DirtyChunks() const;
+	void ClearDirtyChunks();
+	void MarkAllChunksDirty();
+};
@@ -0,0 +1,126 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+using namespace std;
+
+/// <summary>
+/// Constructor which starts the worker threads, they sleep until there is a job
+/// </summary>
+/// <param name="pThreads"> the number of threads including the caller, 0 uses one per hardware core </param>
+WorkerPool::WorkerPool(int pThreads)
+{
+	if (pThreads <= 0)
+	{
+		pThreads = static_cast<int>((max)(1u, thread::hardware_concurrency()));
+	}
+	mThreads.reserve(pThreads - 1);
+	for (auto i = 1; i < pThreads; ++i)
+	{
+		mThreads.emplace_back(&WorkerPool::Work, this);
+	}
+}
+
+/// <summary>
+/// Destructor which wakes the workers to stop and waits for them
+/// </summary>
+WorkerPool::~WorkerPool()
+{
+	{
+		lock_guard<mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_all();
+	for (auto& thread : mThreads)
+	{
+		thread.join();
+	}
+}
+
+/// <summary>
+/// The loop each worker thread runs - sleeps until a new job is posted, takes blocks from it until none are left, then reports back
+/// </summary>
+void WorkerPool::Work()
+{
+	unsigned int job = 0;
+	for (;;)
+	{
+		{
+			unique_lock<mutex> lock(mMutex);
+			mWake.wait(lock, [this, job]() { return mStopping || mJob != job; });
+			if (mStopping)
+			{
+				return;
+			}
+			job = mJob;
+		}
+		RunBlocks();
+		{
+			lock_guard<mutex> lock(mMutex);
+			if (--mBusy == 0)
+			{
+				mDone.notify_one();
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Takes blocks of the current job until every block has been claimed
+/// </summary>
+void WorkerPool::RunBlocks()
+{
+	for (;;)
+	{
+		const auto begin = mNext.fetch_add(mGrain);
+		if (begin >= mCount)
+		{
+			return;
+		}
+		mInvoke(mBody, begin, (min)(begin + mGrain, mCount));
+	}
+}
+
+/// <summary>
+/// Posts a job to the workers, works on it from this thread as well and waits until every block is done
+/// </summary>
+/// <param name="pCount"> the number of items in the job </param>
+/// <param name="pGrain"> the number of items in each block </param>
+/// <param name="pInvoke"> calls the body with a block </param>
+/// <param name="pBody"> the body to run on each block </param>
+void WorkerPool::Run(const int pCount, const int pGrain, const Invoker pInvoke, void* const pBody)
+{
+	if (pCount <= 0)
+	{
+		return;
+	}
+	if (mThreads.empty() || pCount <= pGrain)
+	{
+		pInvoke(pBody, 0, pCount);
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(mMutex);
+		mInvoke = pInvoke;
+		mBody = pBody;
+		mCount = pCount;
+		mGrain = (max)(pGrain, 1);
+		mNext = 0;
+		mBusy = static_cast<int>(mThreads.size());
+		++mJob;
+	}
+	mWake.notify_all();
+	RunBlocks();
+
+	unique_lock<mutex> lock(mMutex);
+	mDone.wait(lock, [this]() { return mBusy == 0; });
+}
+
+/// <summary>
+/// Gets the number of threads which work on a job
+/// </summary>
+/// <returns> the number of worker threads plus the calling thread </returns>
+const int WorkerPool::Threads() const
+{
+	return static_cast<int>(mThreads.size()) + 1;
+}
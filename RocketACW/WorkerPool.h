@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//A fixed set of threads kept alive between jobs, so work can be shared across cores every frame without creating threads or allocating
+//The calling thread works on the job too and For only returns once every block is done
+class WorkerPool
+{
+	typedef void(*Invoker)(void* const pBody, const int pBegin, const int pEnd);
+
+	std::vector<std::thread> mThreads;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	Invoker mInvoke = nullptr;
+	void* mBody = nullptr;
+	int mCount = 0;
+	int mGrain = 1;
+	std::atomic<int> mNext{ 0 };
+	int mBusy = 0;				//the workers still on the current job
+	unsigned int mJob = 0;		//bumped for every job so a worker never runs the same one twice
+	bool mStopping = false;
+
+	template <typename Body>
+	static void Invoke(void* const pBody, const int pBegin, const int pEnd)
+	{
+		(*static_cast<Body*>(pBody))(pBegin, pEnd);
+	}
+
+	void Work();
+	void RunBlocks();
+	void Run(const int pCount, const int pGrain, const Invoker pInvoke, void* const pBody);
+
+public:
+	explicit WorkerPool(int pThreads = 0);
+	~WorkerPool();
+
+	WorkerPool& operator=(const WorkerPool& pPool) = delete;
+	WorkerPool(const WorkerPool& pPool) = delete;
+
+	//Splits [0, pCount) into blocks of pGrain and runs pBody(begin, end) on each, a job no bigger than one block runs on the calling thread alone
+	template <typename Body>
+	void For(const int pCount, const int pGrain, Body pBody)
+	{
+		Run(pCount, pGrain, &Invoke<Body>, &pBody);
+	}
+
+	const int Threads() const;
+};
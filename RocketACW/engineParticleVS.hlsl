@@ -1 +0,0 @@
-#include "engineParticleShader.fx"
\ No newline at end of file
@@ -1 +0,0 @@
-#include "explosionParticleShader.fx"
\ No newline at end of file
@@ -33,7 +33,11 @@ struct VS_INPUT
 	float3 Tangent : TANGENT;
 	float3 Binormal : BINORMAL;
 	float2 TexCoord : TEXCOORD;
+#ifdef PACKED_INSTANCE
+	uint4 InstancePos : INSTANCEPOS;	//10:10:10:2 grid coordinate
+#else
 	float3 InstancePos : INSTANCEPOS;
+#endif
 };
 
 struct PS_INPUT
@@ -51,9 +55,10 @@ struct PS_INPUT
 PS_INPUT VS(VS_INPUT input)
 {
 	PS_INPUT output = (PS_INPUT)0;
-	input.Pos.x += input.InstancePos.x;
-	input.Pos.y += input.InstancePos.y;
-	input.Pos.z += input.InstancePos.z;
+	const float3 instancePos = (float3)input.InstancePos.xyz;
+	input.Pos.x += instancePos.x;
+	input.Pos.y += instancePos.y;
+	input.Pos.z += instancePos.z;
 	output.Pos = float4(input.Pos, 1.0f);
 	output.Pos = mul(output.Pos, World);
 	output.Pos = mul(output.Pos, View);
@@ -21,6 +21,9 @@ Texture2D txDiffuse : register(t0);
 
 SamplerState txSampler : register(s0);
 
+//the size of a particle with a packed size of 1, matches PARTICLE_MAX_SIZE
+static const float MaxSize = 8;
+
 //--------------------------------------------------------------------------------------
 // Shader Inputs
 //--------------------------------------------------------------------------------------
@@ -32,6 +35,7 @@ struct VS_INPUT
 	float3 Binormal : BINORMAL;
 	float2 TexCoord : TEXCOORD;
 	float3 InstancePos : INSTANCEPOS;
+	float2 InstanceData : INSTANCEDATA;	//x = size / MaxSize, y = fade
 };
 
 struct PS_INPUT
@@ -51,30 +55,20 @@ PS_INPUT VS(VS_INPUT input)
 {
 	PS_INPUT output = (PS_INPUT)0;
 
+	//the particles are simulated on the CPU, so the instance is where the particle is
+	float4 centre = mul(float4(input.InstancePos, 1), World);
+
 	//billboarding
 	matrix viewInv = transpose(View);
 	float3 vx = viewInv[0].xyz;
 	float3 vy = viewInv[1].xyz;
-	output.Pos = float4((input.Pos.x * vx + input.Pos.y * vy), 1);
-
-	//instancing
-	output.Pos = mul(output.Pos, World);
-
-	//Fade over time
-	float lifecycle = 15;
-	float freq = 1;
-	float T = fmod(freq * Time.x + input.InstancePos.z/500, lifecycle);
-	output.FadeRate = 1.0 - T / lifecycle;
-
-	//Explosion
-	float height = 3;
-	float spread = 0.3;
-	output.Pos.xyz += float3(spread * cos(input.InstancePos.z * 300), height * sin(output.FadeRate), spread * sin(input.InstancePos.z * 300))*T;
+	float size = input.InstanceData.x * MaxSize;
+	output.PosWorld = float4(centre.xyz + (input.Pos.x * vx + input.Pos.y * vy) * size, 1);
+	output.FadeRate = input.InstanceData.y;
 
-	output.Pos = mul(output.Pos, View);
+	output.Pos = mul(output.PosWorld, View);
 	output.Pos = mul(output.Pos, Projection);
 	output.Normal = normalize(float4(input.Normal, 1.0f)).xyz;
-	output.PosWorld = mul(output.Pos, World);
 	output.TexCoord = input.TexCoord;
 	return output;
 }
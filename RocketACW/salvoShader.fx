@@ -32,6 +32,7 @@ struct VS_INPUT
 	float3 Binormal : BINORMAL;
 	float2 TexCoord : TEXCOORD;
 	float3 InstancePos : INSTANCEPOS;
+	float InstancePitch : INSTANCEDATA;
 };
 
 struct PS_INPUT
@@ -40,7 +41,6 @@ struct PS_INPUT
 	float3 Normal: NORMAL;
 	float4 PosWorld : TEXCOORD0;
 	float2 TexCoord : TEXCOORD1;
-	float FadeRate : TEXCOORD2;
 };
 
 
@@ -50,34 +50,21 @@ struct PS_INPUT
 PS_INPUT VS(VS_INPUT input)
 {
 	PS_INPUT output = (PS_INPUT)0;
-
-	//billboarding
-	matrix viewInv = transpose(View);
-	float3 vx = viewInv[0].xyz;
-	float3 vy = viewInv[1].xyz;
-	output.Pos = float4((input.Pos.x * vx + input.Pos.y * vy), 1);
-
-	//Fade over time
-	float lifecycle = 15;
-	float freq = 1;
-	float T = fmod(freq * Time + input.InstancePos.z, lifecycle);
-	output.FadeRate = 1.0 - T / lifecycle;
-
-	//Engine
-	float height = 0.5;
-	float spread = 0.1;
-	output.Pos.y -= 3;
-	float3 instancePos = float3(spread * cos(input.InstancePos.z * 300), -height, spread * sin(input.InstancePos.z * 300))*T;
-	output.Pos += float4(instancePos,1);
-
-	output.Pos = mul(output.Pos, World);
+	//turn the rocket about z by its pitch, the same rotation a gameobject applies, before moving it to its place in the salvo
+	float s, c;
+	sincos(input.InstancePitch, s, c);
+	input.Pos.xy = float2(input.Pos.x * c - input.Pos.y * s, input.Pos.x * s + input.Pos.y * c);
+	input.Normal.xy = float2(input.Normal.x * c - input.Normal.y * s, input.Normal.x * s + input.Normal.y * c);
+	input.Pos.x += input.InstancePos.x;
+	input.Pos.y += input.InstancePos.y;
+	input.Pos.z += input.InstancePos.z;
+	output.Pos = mul(float4(input.Pos, 1.0f), World);
 	output.Pos = mul(output.Pos, View);
 	output.Pos = mul(output.Pos, Projection);
 	output.Normal = normalize(float4(input.Normal, 1.0f)).xyz;
-	output.PosWorld = mul(output.Pos, World);
+	output.PosWorld = mul(float4(input.Pos, 1.0f), World);
 	output.TexCoord = input.TexCoord;
 
-
 	return output;
 }
 
@@ -86,10 +73,23 @@ PS_INPUT VS(VS_INPUT input)
 //--------------------------------------------------------------------------------------
 float4 PS(PS_INPUT input) : SV_Target
 {
-	float radius = 0.4;
-	float range = radius * radius - dot(input.TexCoord - 0.5, input.TexCoord - 0.5);
-	float shade = 2 / (1 + exp(12 * range));
+	float4 matDiffuse = float4(0.8, 0.8, 0.8, 1.0);
+	float4 matSpec = float4(1.0, 1.0, 1.0, 1.0);
+	float4 ambient = float4(0.1, 0.1, 0.1, 1.0);
+
 	float4 texColour = txDiffuse.Sample(txSampler, input.TexCoord);
+	float3 n = normalize(input.Normal);
+	float3 viewDirection = normalize(CameraPosition - input.PosWorld);
+	float4 light = ambient;
+
+	for (int i = 0; i < NumberOfLights.x; ++i)
+	{
+		float3 lightDir = normalize(LightPosition[i] - input.PosWorld);
+		float diffuse = max(0.0, dot(lightDir, n));
+		float3 R = normalize(reflect(-lightDir, n));
+		float spec = pow(max(0.0, dot(viewDirection, R)), 50);
+		light += saturate(((matDiffuse*diffuse) + (matSpec*spec)) * LightColour[i]);
+	}
 
-	return texColour * (1-shade) * input.FadeRate;
+	return texColour * light;
 }